@@ -10,8 +10,32 @@
  */
 struct Config
 {
-    //! Equation of state, either "BWRS", "GERG04" or "IdealGas"
+    //! Equation of state, either "BWRS", "GERG04", "IdealGas", or
+    //! "BWRS-Table" or "GERG04-Table" for interpolation in a precomputed table
+    //! (see TabulatedEOS)
     std::string equationOfState = "BWRS";
+    //! Pressure range [Pa] covered by the tables of tabulated equations of state
+    arma::vec eosTablePressureRange = {1e5, 15e6};
+    //! Temperature range [K] covered by the tables of tabulated equations of state
+    arma::vec eosTableTemperatureRange = {243.15, 343.15};
+    //! Number of pressure grid points in the tables of tabulated equations of state
+    arma::uword eosTablePressurePoints = 100;
+    //! Number of temperature grid points in the tables of tabulated equations of state
+    arma::uword eosTableTemperaturePoints = 51;
+    //! Directory where tables of tabulated equations of state are saved, and
+    //! loaded from in later runs. Tables are not saved if empty.
+    std::string eosTableDirectory = "";
+    //! Max number of tables of tabulated equations of state built by the
+    //! process. Compositions without a table after this use the full
+    //! equation of state (see TabulatedEOS::tableBuildLimit()).
+    arma::uword eosTableBuildLimit = 16;
+    //! Relative change in pressure and temperature at a grid point below
+    //! which the previous equation of state result is reused (disabled if 0)
+    double eosCacheTolerance = 0;
+    //! Number of threads used to evaluate the equation of state, friction
+    //! factor and heat transfer of the grid points in Physics (uses the
+    //! number of hardware threads if 0)
+    arma::uword threads = 1;
     //! Type of heat transfer, either "SteadyState", "Unsteady", "FixedUValue" or "FixedQValue"
     std::string heatTransfer = "SteadyState";
     //! Type of energy equation, either "InternalEnergy" or "Enthalpy"
@@ -27,6 +51,30 @@ struct Config
     bool bruteForce = false;
     //! Max number of iterations to use in Solver::solve
     arma::uword maxIterations = 200;
+    //! Linear solver used for the matrix equation, either "Banded" (reuses the
+    //! band structure between solves) or "SuperLU"
+    std::string linearSolver = "Banded";
+    //! Nonlinear solver used by Solver, either "Picard" (fixed-point
+    //! iterations with relaxation) or "Newton" (quasi-Newton steps)
+    std::string nonlinearSolver = "Picard";
+    //! Number of previous iterates used for Anderson acceleration of the
+    //! Picard iterations in Solver. Acceleration is disabled if 0.
+    arma::uword andersonDepth = 0;
+    //! Order of the polynomial extrapolation from previous time steps used as
+    //! initial guess in Solver, either 0 (previous state), 1 (linear) or 2
+    //! (quadratic)
+    arma::uword predictorOrder = 0;
+
+    //! If Simulator::simulate should use adaptive time steps, instead of
+    //! stepping exactly at the timestamps of the boundary conditions
+    bool adaptiveTimeStep = false;
+    //! Smallest time step used with adaptive time steps [s]
+    arma::uword minTimeStep = 10;
+    //! Largest time step used with adaptive time steps [s]
+    arma::uword maxTimeStep = 3600;
+    //! Tolerance of the (relative) local error estimate used to control
+    //! adaptive time steps
+    double timeStepTolerance = 1e-3;
 
     //! Where to put results. Will not output any results if equal to empty
     //! string.
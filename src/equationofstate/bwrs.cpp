@@ -2,12 +2,16 @@
 
 #include <memory>
 #include <cmath>
+#include <map>
+#include <mutex>
+#include <utility>
 
 #include "utilities/utilities.hpp"
 #include "utilities/errors.hpp"
 #include "utilities/physics.hpp"
 #include "utilities/stringbuilder.hpp"
 #include "constants.hpp"
+#include "equationofstate/mixturecache.hpp"
 
 using utils::pow2;
 using utils::pow3;
@@ -96,15 +100,57 @@ void BWRS::loadParametersAndCriticalProperties(const std::string parameterSet)
     }
 }
 
-// TODO: Document the formulas and derivatives below a bit better.
-// Perhaps via an attached document? Think I have the notes somewhere.
 vec BWRS::evaluate(
         const double pressure,
         const double temperature) const
 {
-    const double rho_m = findMolarDensity(pressure, temperature);
+    DensityState state; // no initial guess
+    vec Z_factor(6); // output vector
+    evaluateInto(pressure, temperature, state, Z_factor.memptr(), 1);
+
+    return Z_factor;
+}
+
+vec BWRS::evaluate(
+        const double pressure,
+        const double temperature,
+        DensityState& state) const
+{
+    vec Z_factor(6); // output vector
+    evaluateInto(pressure, temperature, state, Z_factor.memptr(), 1);
+
+    return Z_factor;
+}
+
+void BWRS::evaluateBatch(
+        const vec& pressure,
+        const vec& temperature,
+        const arma::mat& composition,
+        arma::mat& output,
+        std::vector<DensityState>& densityStates)
+{
+    const arma::uword n = prepareBatch(pressure, temperature, composition, output, densityStates);
+    for (arma::uword i = 0; i < n; i++)
+    {
+        setBatchComposition(composition, i);
+        evaluateInto(pressure[i], temperature[i], batchDensityState(densityStates, i), output.colptr(0) + i, n);
+        output.at(i, 6) = m_molarMassOfMixture;
+    }
+}
+
+// TODO: Document the formulas and derivatives below a bit better.
+// Perhaps via an attached document? Think I have the notes somewhere.
+void BWRS::evaluateInto(
+        const double pressure,
+        const double temperature,
+        DensityState& state,
+        double* output,
+        const arma::uword stride) const
+{
+    const double rho_m = findMolarDensity(pressure, temperature, 1e-4, state.extrapolate(pressure, temperature));
 
     const double gasConst = m_R; // gas constant
+    const MixtureCoefficients& mix = *m_coefficients; // independent of pressure and temperature
 
     const double pressure2 = pressure*pressure;
     const double pressure3 = pressure2*pressure;
@@ -133,13 +179,11 @@ vec BWRS::evaluate(
     const double gasConstT5 = gasConstT3*gasConstT*gasConstT;
     const double gasConstT6 = gasConstT5*gasConstT;
 
-    vec Z_factor = zeros<vec>(6); // output vector
-
     // Z factor
-    Z_factor(0) = pressure/(rho_m*gasConst*temperature);
+    output[0] = pressure/(rho_m*gasConst*temperature);
 
     // dzdT (derivative of Z w.r.t. temperature, at constant pressure)
-    const double col = Z_factor(0);
+    const double col = output[0];
     const double col2 = col*col;
     const double col3 = col2*col;
     const double col4 = col3*col;
@@ -147,49 +191,51 @@ vec BWRS::evaluate(
 
     const double colgasConstT2 = pow((col*gasConst*temperature), 2);
 
-    const double expo = exp(-m_GAMMA*rho_m2);
+    const double expo = exp(-mix.GAMMA*rho_m2);
     const double nom1 =
-          (         -m_B0/(gasConst*temperature2) + 2*m_A0/(gasConst2*temperature3)                                         + 4*m_C0/(gasConst2*temperature5) - 5*m_D0/(gasConst2*temperature6) + 6*m_E0/(gasConst2*temperature7)) *col4*pressure
-        + (                                       - 2*m_b/(gasConst2*temperature3) +  3*m_a/(gasConst3*temperature4) +  4*m_d/(gasConst3*temperature5)                                                                                ) *col3*pressure2
-        + m_ALPHA*(-6*m_a/(gasConst6*temperature7) - 7*m_d/(gasConst6*temperature8)) *pressure5
-        + col3*m_c*pressure2/gasConst3 * (-5/temperature6 - 7*m_GAMMA*pressure2/(col2*gasConst2*temperature8)) * expo
-        + col3*m_c*pressure2/gasConst3 * ( 1/temperature5 +   m_GAMMA*pressure2/(col2*gasConst2*temperature7)) * expo*2*m_GAMMA*pressure2/(colgasConstT2*temperature);
+          (         -mix.B0/(gasConst*temperature2) + 2*mix.A0/(gasConst2*temperature3)                                         + 4*mix.C0/(gasConst2*temperature5) - 5*mix.D0/(gasConst2*temperature6) + 6*mix.E0/(gasConst2*temperature7)) *col4*pressure
+        + (                                       - 2*mix.b/(gasConst2*temperature3) +  3*mix.a/(gasConst3*temperature4) +  4*mix.d/(gasConst3*temperature5)                                                                                ) *col3*pressure2
+        + mix.ALPHA*(-6*mix.a/(gasConst6*temperature7) - 7*mix.d/(gasConst6*temperature8)) *pressure5
+        + col3*mix.c*pressure2/gasConst3 * (-5/temperature6 - 7*mix.GAMMA*pressure2/(col2*gasConst2*temperature8)) * expo
+        + col3*mix.c*pressure2/gasConst3 * ( 1/temperature5 +   mix.GAMMA*pressure2/(col2*gasConst2*temperature7)) * expo*2*mix.GAMMA*pressure2/(colgasConstT2*temperature);
 
     const double den1 =
             6*col5
             - 5*col4
-            - ( m_B0/(gasConst*temperature)         - m_A0/(gasConst2*temperature2)                                     - m_C0/(gasConst2*temperature4) + m_D0/(gasConst2*temperature5) - m_E0/(gasConst2*temperature6) )*4*col3*pressure
-            - (                                m_b/(gasConst2*temperature2) - m_a/(gasConst3*temperature3) - m_d/(gasConst3*temperature4)                                                                                                            )*3*col2*pressure2
-            - 3*col2*m_c*pressure2/(gasConst3*temperature5)*expo
-            - m_GAMMA*pressure4*m_c/(gasConst5*temperature7)*expo
-            - col3*m_c*pressure2/gasConst3*(1/temperature5 + m_GAMMA*pressure2/(col2*gasConst2*temperature7))*expo*2*m_GAMMA*pressure2/(colgasConstT2*col);
-    Z_factor(1) = nom1/den1;
+            - ( mix.B0/(gasConst*temperature)         - mix.A0/(gasConst2*temperature2)                                     - mix.C0/(gasConst2*temperature4) + mix.D0/(gasConst2*temperature5) - mix.E0/(gasConst2*temperature6) )*4*col3*pressure
+            - (                                mix.b/(gasConst2*temperature2) - mix.a/(gasConst3*temperature3) - mix.d/(gasConst3*temperature4)                                                                                                            )*3*col2*pressure2
+            - 3*col2*mix.c*pressure2/(gasConst3*temperature5)*expo
+            - mix.GAMMA*pressure4*mix.c/(gasConst5*temperature7)*expo
+            - col3*mix.c*pressure2/gasConst3*(1/temperature5 + mix.GAMMA*pressure2/(col2*gasConst2*temperature7))*expo*2*mix.GAMMA*pressure2/(colgasConstT2*col);
+    output[stride] = nom1/den1;
 
     // dzdp_T (derivative of Z w.r.t. pressure, at constant temperature)
-    const double nom2 = (m_B0*gasConst*temperature - m_A0 - m_C0/temperature2 + m_D0/temperature3 - m_E0/temperature4) * col4/gasConstT2 + (m_b*gasConst*temperature - m_a - m_d/temperature)*col3*2*pressure/gasConstT3
-            + m_ALPHA*(m_a + m_d/temperature)*5*pressure4/gasConstT6 + expo*(m_c*2*pressure*col3/(temperature2*gasConstT3) + 4*pressure3*m_c*col*m_GAMMA/(temperature2*gasConstT5))
-            - m_GAMMA*2*pressure/colgasConstT2*expo*(m_c*pressure2*col3/(temperature2*gasConstT3) + m_c*pressure4*col*m_GAMMA/(temperature2*gasConstT5));
-    const double den2 = 6*col5 - 5*col4 - (m_B0*gasConst*temperature - m_A0 - m_C0/temperature2 + m_D0/temperature3 - m_E0/temperature4)*4*col3*pressure/gasConstT2
-            - (m_b*gasConst*temperature - m_a - m_d/temperature)*3*col2*pressure2/gasConstT3 - expo*(3*col2*m_c*pressure2/(temperature2*gasConstT3) + m_c*pressure4*m_GAMMA/(temperature2*gasConstT5))
-            - expo*2*m_GAMMA*pressure2/(col3*gasConstT2)*(m_c*pressure2*col3/(temperature2*gasConstT3) + m_c*pressure4*col*m_GAMMA/(temperature2*gasConstT5));
-    Z_factor(2) = nom2/den2;
+    const double nom2 = (mix.B0*gasConst*temperature - mix.A0 - mix.C0/temperature2 + mix.D0/temperature3 - mix.E0/temperature4) * col4/gasConstT2 + (mix.b*gasConst*temperature - mix.a - mix.d/temperature)*col3*2*pressure/gasConstT3
+            + mix.ALPHA*(mix.a + mix.d/temperature)*5*pressure4/gasConstT6 + expo*(mix.c*2*pressure*col3/(temperature2*gasConstT3) + 4*pressure3*mix.c*col*mix.GAMMA/(temperature2*gasConstT5))
+            - mix.GAMMA*2*pressure/colgasConstT2*expo*(mix.c*pressure2*col3/(temperature2*gasConstT3) + mix.c*pressure4*col*mix.GAMMA/(temperature2*gasConstT5));
+    const double den2 = 6*col5 - 5*col4 - (mix.B0*gasConst*temperature - mix.A0 - mix.C0/temperature2 + mix.D0/temperature3 - mix.E0/temperature4)*4*col3*pressure/gasConstT2
+            - (mix.b*gasConst*temperature - mix.a - mix.d/temperature)*3*col2*pressure2/gasConstT3 - expo*(3*col2*mix.c*pressure2/(temperature2*gasConstT3) + mix.c*pressure4*mix.GAMMA/(temperature2*gasConstT5))
+            - expo*2*mix.GAMMA*pressure2/(col3*gasConstT2)*(mix.c*pressure2*col3/(temperature2*gasConstT3) + mix.c*pressure4*col*mix.GAMMA/(temperature2*gasConstT5));
+    output[2*stride] = nom2/den2;
+
+    state.update(pressure, temperature, rho_m*m_molarMassOfMixture/1000.0, output[0], output[2*stride], output[stride]);
 
     // dzdT_rho (derivative of Z w.r.t. temperature, at constant density)
-    Z_factor(3) = m_A0*rho_m/(gasConst*temperature2)
-            + 3*m_C0*rho_m/(gasConst*temperature4)
-            - 4*m_D0*rho_m/(gasConst*temperature5)
-            + 5*m_E0*rho_m/(gasConst*temperature6)
-            + m_a*rho_m2/(gasConst*temperature2)
-            + 2*m_d*rho_m2/(gasConst*temperature3)
-            - m_ALPHA*m_a*rho_m5/(gasConst*temperature2)
-            - 2*m_ALPHA*m_d*rho_m5/(gasConst*temperature3)
-            - 3*m_c*rho_m2/(gasConst*temperature4)*(1 + m_GAMMA*rho_m2)*(exp( - m_GAMMA*rho_m2));
+    output[3*stride] = mix.A0*rho_m/(gasConst*temperature2)
+            + 3*mix.C0*rho_m/(gasConst*temperature4)
+            - 4*mix.D0*rho_m/(gasConst*temperature5)
+            + 5*mix.E0*rho_m/(gasConst*temperature6)
+            + mix.a*rho_m2/(gasConst*temperature2)
+            + 2*mix.d*rho_m2/(gasConst*temperature3)
+            - mix.ALPHA*mix.a*rho_m5/(gasConst*temperature2)
+            - 2*mix.ALPHA*mix.d*rho_m5/(gasConst*temperature3)
+            - 3*mix.c*rho_m2/(gasConst*temperature4)*(1 + mix.GAMMA*rho_m2)*(exp( - mix.GAMMA*rho_m2));
 
     if (m_useConstantHeatCapacities)
     {
-        Z_factor(4) = 3000; // cp
-        Z_factor(5) = 1750; // cv
-//        Z_factor(5) = this->calculateHeatCapacityConstantPressureTGNet(m_molarMassOfMixture, pressure, temperature);
+        output[4*stride] = 3000; // cp
+        output[5*stride] = 1750; // cv
+//        output[5*stride] = this->calculateHeatCapacityConstantPressureTGNet(m_molarMassOfMixture, pressure, temperature);
     }
     else
     {
@@ -201,11 +247,9 @@ vec BWRS::evaluate(
         const double cv = utils::calculateHeatCapacityConstantVolumeJFH(pressure);
 //        const double cv = utils::calculateHeatCapacityConstantVolumeTGNet(m_molarMassOfMixture, pressure, temperature);
 
-        Z_factor(4) = cp;
-        Z_factor(5) = cv;
+        output[4*stride] = cp;
+        output[5*stride] = cv;
     }
-
-    return Z_factor;
 }
 
 double BWRS::calculateCompressibility(
@@ -250,6 +294,9 @@ void BWRS::loadJFHCriticalProperties()
     m_expW = exp(-3.8*m_w);
     m_R = constants::gasConstant; // gas constant [m3 Pa / K mol]
 
+    m_criticalProperties = "JFH";
+    updateCacheTag();
+
     setComposition(m_composition); // to update m_molarMassOfMixture if m_molarMass has changed, also updates m_criticalPressureOfMixture and m_criticalTemperatureOfMixture
 
     std::cout << "WARNING: Using Calsep critical parameters, these have been shown to give bad results with the new molar-density based solver." << std::endl;
@@ -268,6 +315,9 @@ void BWRS::loadCalsepCriticalProperties()
     m_expW = exp(-3.8*m_w);
     m_R = constants::gasConstant; // gas constant [m3 Pa / K mol]
 
+    m_criticalProperties = "Calsep";
+    updateCacheTag();
+
     setComposition(m_composition); // to update m_molarMassOfMixture if m_molarMass has changed, also updates m_criticalPressureOfMixture and m_criticalTemperatureOfMixture
 
     std::cout << "WARNING: Using Calsep critical parameters, these have been shown to give bad results with the new molar-density based solver." << std::endl;
@@ -287,6 +337,9 @@ void BWRS::loadStarlingCriticalProperties()
     m_expW = exp(-3.8*m_w);
     m_R = 8.3160; // gas constant from Starling [m3 Pa / K mol]
 
+    m_criticalProperties = "Starling";
+    updateCacheTag();
+
     setComposition(m_composition); // to update m_molarMassOfMixture if m_molarMass has changed, also updates m_criticalPressureOfMixture and m_criticalTemperatureOfMixture
 }
 
@@ -318,15 +371,27 @@ void BWRS::loadStarlingParameters()
 }
 
 void BWRS::calculateCoefficients()
+{
+    // all these coefficients only depend on the gas composition, so they are
+    // calculated once and shared (via MixtureCache) with all other instances
+    // with the same composition, parameters and critical properties, for use
+    // when evaluating BWRS at different temperatures and pressures
+    m_coefficients = MixtureCache<MixtureCoefficients>::get(
+                m_cacheTag,
+                m_composition,
+                [this](const vec&) { return calculateMixtureCoefficients(); });
+}
+
+BWRS::MixtureCoefficients BWRS::calculateMixtureCoefficients() const
 {
     const vec& x = m_composition;
     const vec& w = m_w;
     const double R = m_R; // gas constant [m3 Pa / K mol]
     const vec& Tc = m_Tc;
     const vec& rhoc = m_rhoc;
-    const vec& Ai = m_Ai;
-    const vec& Bi = m_Bi;
-    const mat& k = m_binaryInteractionParameterTable;
+    const vec& Ai = m_parameters->Ai;
+    const vec& Bi = m_parameters->Bi;
+    const mat& k = m_parameters->binaryInteraction;
 
     double A0 = 0;
     double C0 = 0;
@@ -386,35 +451,67 @@ void BWRS::calculateCoefficients()
     alpha = pow3(alpha);
     gamma = pow2(gamma);
 
-    // all these coefficients only depend on the gas composition, so they are
-    // calculated once here and store for later use when evaluating BWRS at
-    // different temperatures and pressures
-    m_A0 = A0;
-    m_B0 = B0;
-    m_C0 = C0;
-    m_D0 = D0;
-    m_E0 = E0;
-    m_a = a;
-    m_b = b;
-    m_c = c;
-    m_d = d;
-    m_ALPHA = alpha;
-    m_GAMMA = gamma;
+    MixtureCoefficients coefficients;
+    coefficients.A0 = A0;
+    coefficients.B0 = B0;
+    coefficients.C0 = C0;
+    coefficients.D0 = D0;
+    coefficients.E0 = E0;
+    coefficients.a = a;
+    coefficients.b = b;
+    coefficients.c = c;
+    coefficients.d = d;
+    coefficients.ALPHA = alpha;
+    coefficients.GAMMA = gamma;
+
+    return coefficients;
 }
 
 void BWRS::loadParameterFiles(
         const string& ABparameterFile,
         const string& binaryInteractionTableFile)
 {
+    m_parameters = loadParameters(ABparameterFile, binaryInteractionTableFile);
+    updateCacheTag();
+}
+
+std::shared_ptr<const BWRS::Parameters> BWRS::loadParameters(
+        const string& ABparameterFile,
+        const string& binaryInteractionTableFile)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<string, string>, std::shared_ptr<const Parameters>> registry;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto key = std::make_pair(ABparameterFile, binaryInteractionTableFile);
+    const auto it = registry.find(key);
+    if (it != registry.end())
+    {
+        return it->second;
+    }
+
     // load binary interaction parameters and Ai, Bi
+    std::shared_ptr<Parameters> parameters = std::make_shared<Parameters>();
     mat loading;
 
     loading.load(ABparameterFile, arma::file_type::csv_ascii);
-    m_Ai = loading.col(0);
-    m_Bi = loading.col(1);
+    parameters->Ai = loading.col(0);
+    parameters->Bi = loading.col(1);
 
     loading.load(binaryInteractionTableFile, arma::file_type::csv_ascii);
-    m_binaryInteractionParameterTable = loading;
+    parameters->binaryInteraction = loading;
+
+    parameters->id = registry.size();
+    registry.emplace(key, parameters);
+
+    return parameters;
+}
+
+void BWRS::updateCacheTag()
+{
+    const string parameters = m_parameters ? std::to_string(m_parameters->id) : "none";
+    m_cacheTag = "BWRS/" + parameters + "/" + m_criticalProperties;
 }
 
 void BWRS::findNonZeroComponents()
@@ -445,8 +542,6 @@ double BWRS::findDensity(
     // molar mass of mixture has unit [g/mol]
     const double density = rho_m*m_molarMassOfMixture/1000.0;
 
-    m_density = density; // cache density (mutable)
-
     return density;
 }
 
@@ -454,7 +549,8 @@ double BWRS::findDensity(
 double BWRS::findMolarDensity(
         const double pressure,
         const double temperature,
-        const double tolerance) const
+        const double tolerance,
+        const double initialDensity) const
 {
     // use Newtons method to find the density of the gas
 
@@ -469,27 +565,29 @@ double BWRS::findMolarDensity(
         return 0;
     }
 
-    double initialDensity;
-    if (m_density == 0)
+    double densityGuess;
+    if (initialDensity <= 0)
     {
         // use density of ideal gas as starting point
         const double specificGasConstant = constants::gasConstant/(m_molarMassOfMixture/1000.0 /*g->kg*/); // J/(kg*K)
         const double idealGasDensity = pressure/(specificGasConstant*temperature);
-        initialDensity = idealGasDensity;
+        densityGuess = idealGasDensity;
     }
     else
     {
-        // use cached density
-        initialDensity = m_density;
+        // use given (e.g. extrapolated) density
+        densityGuess = initialDensity;
     }
 
     // convert density guess from actual density [kg / m3] to reduced density [mol / m3]
     // (molar mass of mixture has unit [g/mol])
-    const double molarDensityGuess = initialDensity/(m_molarMassOfMixture/1000.0);
+    const double molarDensityGuess = densityGuess/(m_molarMassOfMixture/1000.0);
 
     double current = molarDensityGuess;
     double previous;
 
+    const MixtureCoefficients& mix = *m_coefficients; // independent of pressure and temperature
+
     uword counter = 0;
     uword nMax = 1000;
     while (counter < nMax)
@@ -505,19 +603,19 @@ double BWRS::findMolarDensity(
         double current5 = current2*current3;
         double current6 = current3*current3;
 
-        double expGammaCurrent2 = exp(-m_GAMMA*current2);
+        double expGammaCurrent2 = exp(-mix.GAMMA*current2);
 
         double f = - pressure + current*m_R*temp
-                + ( m_B0*m_R*temperature - m_A0 - m_C0/temp2 + m_D0/temp3 - m_E0/temp4 )*current2
-                + ( m_b*m_R*temp - m_a - m_d/temp )*current3
-                + m_ALPHA*( m_a + m_d/temp )*current6
-                + ( (m_c*current3)/temp2 )*( 1 + m_GAMMA*current2 )*( expGammaCurrent2 );
+                + ( mix.B0*m_R*temperature - mix.A0 - mix.C0/temp2 + mix.D0/temp3 - mix.E0/temp4 )*current2
+                + ( mix.b*m_R*temp - mix.a - mix.d/temp )*current3
+                + mix.ALPHA*( mix.a + mix.d/temp )*current6
+                + ( (mix.c*current3)/temp2 )*( 1 + mix.GAMMA*current2 )*( expGammaCurrent2 );
 
         double fdiv = m_R*temp
-                + (m_B0*m_R*temp - m_A0 - m_C0/temp2 + m_D0/temp3 - m_E0/temp4)*2.0*current
-                + (m_b*m_R*temp - m_a - m_d/temp)*3.0*current2
-                + m_ALPHA*(m_a + m_d/temp)*6.0*current5
-                + m_c*current2/temp2*(3.0 + 3.0*m_GAMMA*current2 - 2.0*m_GAMMA*m_GAMMA*current4)*exp(-m_GAMMA*current2);
+                + (mix.B0*m_R*temp - mix.A0 - mix.C0/temp2 + mix.D0/temp3 - mix.E0/temp4)*2.0*current
+                + (mix.b*m_R*temp - mix.a - mix.d/temp)*3.0*current2
+                + mix.ALPHA*(mix.a + mix.d/temp)*6.0*current5
+                + mix.c*current2/temp2*(3.0 + 3.0*mix.GAMMA*current2 - 2.0*mix.GAMMA*mix.GAMMA*current4)*exp(-mix.GAMMA*current2);
 
         previous = current;
         double change = f/fdiv;
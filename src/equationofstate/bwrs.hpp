@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <memory>
 #include <armadillo>
 
 #include "equationofstate/equationofstatebase.hpp"
@@ -26,6 +27,46 @@
 class BWRS : public EquationOfStateBase
 {
 public:
+    /*!
+     * \brief Pure component parameters \f$A_{0i}\f$ and \f$B_{0i}\f$, and
+     * binary interaction coefficients \f$k_{ij}\f$, loaded from file.
+     *
+     * These are immutable once loaded, and shared by all BWRS instances using
+     * the same files. \see loadParameters()
+     */
+    struct Parameters
+    {
+        /*!
+         * \brief Pure component parameters Ai.
+         *
+         * From Table 1 at page 221 of <i>Fluid Properties for Light Petroleum Systems</i>.
+         */
+        arma::vec Ai;
+
+        /*!
+         * \brief Pure component parameters Bi.
+         *
+         * From Table 1 at page 221 of <i>Fluid Properties for Light Petroleum Systems</i>.
+         */
+        arma::vec Bi;
+
+        /*!
+         * \brief Binary interaction coefficients \f$k_{ij}\f$.
+         *
+         * The binary interaction coefficients are stored in matrix of size 10x10,
+         * where the binary interactions between component i and j are stored at
+         * location \f$(i, j)\f$ in the matrix. The matrix is symmetric, so
+         * \f$k(i, j) == k(j, i)\f$. The components are in the usual order
+         * (C1, C2, C3, iC4, nC4, iC5, nC5, C6, N2, CO2).
+         *
+         * These can be found in Table 1 at page 227 of <i>Fluid Properties for Light Petroleum Systems</i>.
+         */
+        arma::mat binaryInteraction;
+
+        //! Unique number for each set of parameter files, used in MixtureCache
+        arma::uword id;
+    };
+
     /*!
      * \brief Constructor that uses a string to select which mixture parameters
      * \f$A_0\f$ and \f$B_0\f$, binary interaction coefficients \f$k_{ij}\f$,
@@ -85,6 +126,28 @@ public:
             const double pressure,
             const double temperature) const override;
 
+    /*!
+     * \brief Evaluate the BWRS equation of state, with the initial guess for
+     * the density extrapolated from state.
+     * \see EquationOfStateBase::evaluate(const double, const double, DensityState&) const
+     */
+    virtual arma::vec evaluate(
+            const double pressure,
+            const double temperature,
+            DensityState& state) const override;
+
+    /*!
+     * \brief Evaluate the BWRS equation of state at several states, writing
+     * directly into output.
+     * \see EquationOfStateBase::evaluateBatch()
+     */
+    virtual void evaluateBatch(
+            const arma::vec& pressure,
+            const arma::vec& temperature,
+            const arma::mat& composition,
+            arma::mat& output,
+            std::vector<DensityState>& densityStates) override;
+
     /*!
      * \brief Calculate the compressibility factor (Z) of the gas at a given pressure and temperature.
      *
@@ -111,7 +174,7 @@ public:
      * This calls EquationOfStateBase::setComposition(), then updates the non-zero
      * component indices BWRS::m_indices, calculates the new critical pressure
      * and temperature of the gas mixture, before finally updating all the
-     * coefficients `m_A0`, `m_B0`, through `m_GAMMA`.
+     * coefficients BWRS::m_coefficients.
      *
      * \param composition New gas composition.
      * \param force If the composition should be changed even if it's within machine precision of the previous composition.
@@ -200,6 +263,25 @@ public:
             const std::string& ABparameterFile,
             const std::string& binaryInteractionTableFile);
 
+    /*!
+     * \brief Get the parameters loaded from the given files.
+     *
+     * The files are only parsed the first time a combination of files is
+     * requested, later calls (from any instance or thread) return the same
+     * immutable Parameters. This way a pipeline with thousands of grid points
+     * (and BWRS instances) only reads the parameter files once.
+     *
+     * \param ABparameterFile Path to AB parameter file.
+     * \param binaryInteractionTableFile Path to binary interaction coefficients file.
+     * \return Shared parameters
+     */
+    static std::shared_ptr<const Parameters> loadParameters(
+            const std::string& ABparameterFile,
+            const std::string& binaryInteractionTableFile);
+
+    //! Get the parameters used by this instance
+    const Parameters& parameters() const { return *m_parameters; }
+
     //! Enable constant heat capacity \f$c_p\f$ and \f$c_v\f$
     void enableConstantHeatCapacities();
 
@@ -258,43 +340,14 @@ protected:
     double m_R = 8.3160; // gas constant from Starling [m3 Pa / K mol]
 
     /*!
-     * \brief Binary interaction coefficients \f$k_{ij}\f$.
-     *
-     * The binary interaction coefficients are stored in matrix of size 10x10,
-     * where the binary interactions between component i and j are stored at
-     * location \f$(i, j)\f$ in the matrix. The matrix is symmetric, so
-     * \f$k(i, j) == k(j, i)\f$. The components are in the usual order
-     * (C1, C2, C3, iC4, nC4, iC5, nC5, C6, N2, CO2).
-     *
-     * These can be found in Table 1 at page 227 of <i>Fluid Properties for Light Petroleum Systems</i>.
-     */
-    arma::mat m_binaryInteractionParameterTable;
-
-    /*!
-     * \brief Pure component parameters Bi.
-     *
-     * From Table 1 at page 221 of <i>Fluid Properties for Light Petroleum Systems</i>.
+     * \brief Pure component parameters and binary interaction coefficients,
+     * shared with all other instances using the same parameter files.
+     * \see loadParameters()
      */
-    arma::vec m_Bi;
+    std::shared_ptr<const Parameters> m_parameters;
 
-    /*!
-     * \brief Pure component parameters Ai.
-     *
-     * From Table 1 at page 221 of <i>Fluid Properties for Light Petroleum Systems</i>.
-     */
-    arma::vec m_Ai;
-
-    double m_A0; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_B0; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_C0; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_D0; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_E0; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_a; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_b; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_c; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_d; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_ALPHA; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
-    double m_GAMMA; //!< A coefficient used when evaluating the BWRS-equation. Independent of pressure and temperature.
+    //! Name of the critical properties ("JFH", "Calsep" or "Starling")
+    std::string m_criticalProperties;
 
     double m_criticalPressureOfMixture; //!< Critical pressure of the gas mixture.
     double m_criticalTemperatureOfMixture; //!< Critical temperature of the gas mixture.
@@ -310,10 +363,52 @@ protected:
      * tabulated for the current gas composition.
      *
      * This optimization is most effective if we use constant composition, but
-     * should also improve the evaluation of the formulas otherwise.
+     * should also improve the evaluation of the formulas otherwise. The
+     * coefficients are also shared between instances with the same
+     * composition, parameters and critical properties, via MixtureCache.
      */
     void calculateCoefficients();
 
+    //! The composition dependent coefficients set by calculateCoefficients()
+    struct MixtureCoefficients
+    {
+        double A0; //!< \f$A_0\f$
+        double B0; //!< \f$B_0\f$
+        double C0; //!< \f$C_0\f$
+        double D0; //!< \f$D_0\f$
+        double E0; //!< \f$E_0\f$
+        double a; //!< \f$a\f$
+        double b; //!< \f$b\f$
+        double c; //!< \f$c\f$
+        double d; //!< \f$d\f$
+        double ALPHA; //!< \f$\alpha\f$
+        double GAMMA; //!< \f$\gamma\f$
+    };
+
+    /*!
+     * \brief Coefficients used when evaluating the BWRS-equation, independent
+     * of pressure and temperature. Shared with all other instances with the
+     * same composition, parameters and critical properties.
+     */
+    std::shared_ptr<const MixtureCoefficients> m_coefficients;
+
+    /*!
+     * \brief Calculate the mixture coefficients from the current composition,
+     * parameters and critical properties.
+     *
+     * calculateCoefficients() calls this via MixtureCache.
+     */
+    MixtureCoefficients calculateMixtureCoefficients() const;
+
+    /*!
+     * \brief Tag identifying the parameters and critical properties in
+     * MixtureCache, updated by updateCacheTag().
+     */
+    std::string m_cacheTag;
+
+    //! Update m_cacheTag after loading new parameters or critical properties
+    void updateCacheTag();
+
     /*!
      * \brief Set up BWRS::m_indices to reflect which gas fractions are non-zero.
      *
@@ -325,6 +420,24 @@ protected:
      */
     void findNonZeroComponents();
 
+    /*!
+     * \brief Evaluate the BWRS equation at a single state, writing the
+     * six properties of evaluate() to output[0], output[stride], ...,
+     * output[5*stride].
+     *
+     * This lets evaluate() write to a vector, and evaluateBatch() write
+     * straight into a column-major matrix, without any temporaries.
+     *
+     * The initial guess for the density is extrapolated from state, which is
+     * then updated with the converged density.
+     */
+    void evaluateInto(
+            const double pressure,
+            const double temperature,
+            DensityState& state,
+            double* output,
+            const arma::uword stride) const;
+
     arma::uvec m_indices; //!< The indices of the non-zero gas fractions (components).
 
     /*!
@@ -342,10 +455,13 @@ protected:
      * \param pressure Gas pressure [Pa].
      * \param temperature Gas temperature [K].
      * \param tolerance Convergence criterion for the Newton-Raphson method.
+     * \param initialDensity Initial guess for the density [kg/m3]. The
+     * density of an ideal gas is used if 0.
      * \return Molar density [mol/m3]
      */
     double findMolarDensity(
             const double pressure,
             const double temperature,
-            const double tolerance = 1e-4) const;
+            const double tolerance = 1e-4,
+            const double initialDensity = 0) const;
 };
@@ -1,10 +1,16 @@
 #include "equationofstate.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "pipeline.hpp"
+#include "config.hpp"
 #include "equationofstate/bwrs.hpp"
 #include "equationofstate/gerg04.hpp"
 #include "equationofstate/idealgas.hpp"
 #include "equationofstate/dummygas.hpp"
+#include "equationofstate/tabulatedeos.hpp"
+#include "utilities/threadpool.hpp"
 
 using std::cout;
 using std::endl;
@@ -15,6 +21,63 @@ using arma::uword;
 using arma::mat;
 using arma::vec;
 
+namespace
+{
+
+//! Check if the composition is exactly the same at all grid points
+bool hasUniformComposition(const Pipeline& state)
+{
+    const vec& first = state.composition().front().vec();
+    for (const Composition& composition : state.composition())
+    {
+        const vec& x = composition.vec();
+        if (!std::equal(x.begin(), x.end(), first.begin(), first.end()))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//! Create an equation of state instance of the given type
+unique_ptr<EquationOfStateBase> makeEquationOfState(
+        const std::string& eos,
+        const Composition& composition,
+        const TabulatedEOS::Grid& grid,
+        const std::string& tableDirectory)
+{
+    const std::string tableSuffix = "-Table";
+    if (eos == "BWRS")
+    {
+        return make_unique<BWRS>(composition);
+    }
+    else if (eos == "GERG04")
+    {
+        return make_unique<GERG04>(composition);
+    }
+    else if (eos == "IdealGas")
+    {
+        return make_unique<IdealGas>(composition);
+    }
+    else if (eos == "DummyGas")
+    {
+        return make_unique<DummyGas>(composition);
+    }
+    else if (eos == "BWRS" + tableSuffix || eos == "GERG04" + tableSuffix)
+    {
+        const std::string model = eos.substr(0, eos.size() - tableSuffix.size());
+        return make_unique<TabulatedEOS>(model, composition, grid, tableDirectory);
+    }
+    else
+    {
+        std::string what = "invalid EOS type \"" + eos + "\"";
+        throw std::invalid_argument(what);
+    }
+}
+
+} // end anonymous namespace
+
 EquationOfState::~EquationOfState()
 {}
 
@@ -25,49 +88,213 @@ EquationOfState::EquationOfState(
 {
     for (uword i = 0; i < state.size(); i++)
     {
-        if (eos == "BWRS")
+        m_eos->push_back(makeEquationOfState(eos, state.composition().at(i), TabulatedEOS::Grid(), ""));
+    }
+}
+
+EquationOfState::EquationOfState(
+        const Pipeline& state,
+        const Config& config):
+    m_eos(make_unique<vector<unique_ptr<EquationOfStateBase>>>())
+{
+    if (config.eosTablePressureRange.n_elem != 2)
+        throw std::invalid_argument("eosTablePressureRange");
+    if (config.eosTableTemperatureRange.n_elem != 2)
+        throw std::invalid_argument("eosTableTemperatureRange");
+
+    TabulatedEOS::Grid grid;
+    grid.minPressure = config.eosTablePressureRange(0);
+    grid.maxPressure = config.eosTablePressureRange(1);
+    grid.pressurePoints = config.eosTablePressurePoints;
+    grid.minTemperature = config.eosTableTemperatureRange(0);
+    grid.maxTemperature = config.eosTableTemperatureRange(1);
+    grid.temperaturePoints = config.eosTableTemperaturePoints;
+    TabulatedEOS::setTableBuildLimit(config.eosTableBuildLimit);
+
+    for (uword i = 0; i < state.size(); i++)
+    {
+        m_eos->push_back(makeEquationOfState(config.equationOfState, state.composition().at(i), grid, config.eosTableDirectory));
+    }
+
+    setCacheTolerance(config.eosCacheTolerance);
+}
+
+arma::mat EquationOfState::evaluate(const Pipeline& state)
+{
+    mat output;
+    evaluate(state, output);
+
+    return output;
+}
+
+void EquationOfState::evaluate(const Pipeline& state, arma::mat& output)
+{
+    if (state.size() != m_eos->size())
+    {
+        throw std::invalid_argument("state.size() != m_eos->size()");
+    }
+
+    const uword n = state.size();
+    if (m_cacheTolerance <= 0)
+    {
+        evaluateGridPoints(state, m_indices, n, output); // all grid points
+        return;
+    }
+
+    // find the grid points where the state has changed too much to reuse the
+    // previous result (all of them on the first call)
+    const bool initialized = m_cachedOutput.n_rows == n;
+    if (!initialized)
+    {
+        m_cachedPressure.set_size(n);
+        m_cachedTemperature.set_size(n);
+        m_cachedComposition.set_size(10, n);
+        m_cachedOutput.set_size(n, 7);
+    }
+
+    m_indices.set_size(n);
+    uword nChanged = 0;
+    for (uword i = 0; i < n; i++)
+    {
+        const double* composition = state.composition()[i].vec().memptr();
+        const bool reuse = initialized
+                && std::abs(state.pressure()[i] - m_cachedPressure[i]) <= m_cacheTolerance*std::abs(m_cachedPressure[i])
+                && std::abs(state.temperature()[i] - m_cachedTemperature[i]) <= m_cacheTolerance*std::abs(m_cachedTemperature[i])
+                && std::equal(composition, composition + 10, m_cachedComposition.colptr(i));
+
+        if (!reuse)
         {
-            m_eos->push_back(make_unique<BWRS>(state.composition().at(i)));
+            m_indices[nChanged] = i;
+            nChanged++;
+
+            m_cachedPressure[i] = state.pressure()[i];
+            m_cachedTemperature[i] = state.temperature()[i];
+            std::copy(composition, composition + 10, m_cachedComposition.colptr(i));
         }
-        else if (eos == "GERG04")
+    }
+    m_cacheLookups += n;
+    m_cacheHits += n - nChanged;
+
+    evaluateGridPoints(state, m_indices, nChanged, m_cachedOutput);
+
+    // first order correction of Z from the last full evaluation (zero for the
+    // grid points that were just evaluated)
+    output = m_cachedOutput;
+    for (uword i = 0; i < n; i++)
+    {
+        output.at(i, 0) +=
+                m_cachedOutput.at(i, 1)*(state.temperature()[i] - m_cachedTemperature[i])
+                + m_cachedOutput.at(i, 2)*(state.pressure()[i] - m_cachedPressure[i]);
+    }
+}
+
+void EquationOfState::setCacheTolerance(const double tolerance)
+{
+    if (tolerance < 0)
+        throw std::invalid_argument("tolerance");
+
+    m_cacheTolerance = tolerance;
+
+    // make sure results from before the tolerance changed are not reused
+    m_cachedOutput.reset();
+}
+
+void EquationOfState::setThreadPool(std::shared_ptr<utils::ThreadPool> threadPool)
+{
+    m_threadPool = std::move(threadPool);
+}
+
+double EquationOfState::cacheHitRate() const
+{
+    return m_cacheLookups > 0 ? double(m_cacheHits)/m_cacheLookups : 0;
+}
+
+void EquationOfState::resetCacheStatistics()
+{
+    m_cacheHits = 0;
+    m_cacheLookups = 0;
+}
+
+void EquationOfState::evaluateGridPoints(
+        const Pipeline& state,
+        const arma::uvec& indices,
+        const uword n,
+        arma::mat& output)
+{
+    output.set_size(state.size(), 7); // no-op if already the right size
+    if (m_densityStates.size() != state.size())
+    {
+        m_densityStates.assign(state.size(), EquationOfStateBase::DensityState());
+    }
+
+    if (n == 0)
+    {
+        return;
+    }
+
+    const bool parallel = m_threadPool && m_threadPool->size() > 1;
+    if (!parallel && hasUniformComposition(state))
+    {
+        // evaluate all the grid points with a single call (the composition is
+        // copied to a single column, small enough for armadillo to keep it
+        // without a heap allocation)
+        const mat x(state.composition().at(0).vec());
+
+        if (n == state.size())
         {
-            m_eos->push_back(make_unique<GERG04>(state.composition().at(i)));
+            // all grid points, write directly to the output
+            m_eos->at(0)->evaluateBatch(state.pressure(), state.temperature(), x, output, m_densityStates);
+            return;
         }
-        else if (eos == "IdealGas")
+
+        m_batchPressure.set_size(n);
+        m_batchTemperature.set_size(n);
+        m_batchDensityStates.resize(n);
+        for (uword k = 0; k < n; k++)
         {
-            m_eos->push_back(make_unique<IdealGas>(state.composition().at(i)));
+            m_batchPressure[k] = state.pressure()[indices[k]];
+            m_batchTemperature[k] = state.temperature()[indices[k]];
+            m_batchDensityStates[k] = m_densityStates[indices[k]];
         }
-        else if (eos == "DummyGas")
+
+        m_eos->at(0)->evaluateBatch(m_batchPressure, m_batchTemperature, x, m_batchOutput, m_batchDensityStates);
+
+        for (uword k = 0; k < n; k++)
         {
-            m_eos->push_back(make_unique<DummyGas>(state.composition().at(i)));
+            for (uword j = 0; j < 7; j++)
+                output.at(indices[k], j) = m_batchOutput.at(k, j);
+
+            m_densityStates[indices[k]] = m_batchDensityStates[k];
         }
-        else
+        return;
+    }
+
+    // each grid point only touches its own instance, density state and
+    // output row, so ranges of grid points can be evaluated in parallel
+    const bool all = n == state.size();
+    const auto evaluateRange = [&](const uword begin, const uword end)
+    {
+        for (uword k = begin; k < end; k++)
         {
-            std::string what = "invalid EOS type \"" + eos + "\"";
-            throw std::invalid_argument(what);
+            const uword i = all ? k : indices[k];
+
+            // we don't know if composition of Pipeline has changed since previous
+            // iteration, so set it (only changes anything if it has)
+            m_eos->at(i)->setComposition(state.composition().at(i), false);
+            const vec out = m_eos->at(i)->evaluate(state.pressure()(i), state.temperature()(i), m_densityStates[i]);
+            for (uword j = 0; j < 6; j++)
+                output.at(i, j) = out(j);
+
+            output.at(i, 6) = m_eos->at(i)->getMolarMassOfMixture();
         }
-    }
-}
+    };
 
-arma::mat EquationOfState::evaluate(const Pipeline& state)
-{
-    if (state.size() != m_eos->size())
+    if (parallel)
     {
-        throw std::invalid_argument("state.size() != m_eos->size()");
+        m_threadPool->parallelFor(n, evaluateRange);
     }
-
-    mat output(state.size(), 7); // memory is not initialized
-    for (uword i = 0; i < m_eos->size(); i++)
+    else
     {
-        // using the simpler evaluate (without composition argument) can be
-        // faster, but since we don't know if composition of Pipeline has
-        // changed since previous iteration we just use this version to be sure
-        // we get the correct answer
-        const vec out = m_eos->at(i)->evaluate(state.pressure()(i), state.temperature()(i), state.composition().at(i));
-        output.row(i).cols(0, 5) = out.t();
-
-        output(i, 6) = m_eos->at(i)->getMolarMassOfMixture();
+        evaluateRange(0, n);
     }
-
-    return output;
 }
@@ -4,8 +4,11 @@
 #include <memory>
 #include <armadillo>
 
+#include "equationofstate/equationofstatebase.hpp"
+
 class Pipeline;
-class EquationOfStateBase;
+struct Config;
+namespace utils { class ThreadPool; }
 
 /*!
  * \brief The EquationOfState class is a wrapper around EquationOfStateBase that
@@ -22,10 +25,20 @@ public:
      * \brief Construct from pipeline and string to determine the type of
      * equation of state.
      * \param pipeline Pipeline instance
-     * \param type Type of equation of state ("BWRS", "GERG04" or "IdealGas")
+     * \param type Type of equation of state ("BWRS", "GERG04", "IdealGas",
+     * "BWRS-Table" or "GERG04-Table")
      */
     EquationOfState(const Pipeline& pipeline, const std::string& type);
 
+    /*!
+     * \brief Construct from pipeline and Config, which also sets the cache
+     * tolerance and the table settings of tabulated equations of state (see
+     * TabulatedEOS).
+     * \param pipeline Pipeline instance
+     * \param config Config instance
+     */
+    EquationOfState(const Pipeline& pipeline, const Config& config);
+
     /*!
      * \brief This is a wrapper around EquationOfStateBase::evaluate() that
      * calls that function for each grid point.
@@ -36,6 +49,69 @@ public:
      */
     arma::mat evaluate(const Pipeline& state);
 
+    /*!
+     * \brief Evaluate the equation of state at each grid point, writing into
+     * a caller-owned buffer.
+     *
+     * If the composition is the same at all grid points, all grid points are evaluated
+     * with a single call to EquationOfStateBase::evaluateBatch(). Otherwise
+     * each grid point is evaluated by its own EquationOfStateBase instance, so
+     * composition-dependent coefficients are only recalculated when the
+     * composition at that grid point changes.
+     *
+     * With a thread pool of more than one thread (see setThreadPool()), each
+     * grid point is always evaluated by its own instance, and the grid points
+     * are split between the threads.
+     *
+     * \param state Pipeline instance
+     * \param output Output matrix (see evaluate()), resized only if needed.
+     */
+    void evaluate(const Pipeline& state, arma::mat& output);
+
+    /*!
+     * \brief Enable reuse of previous results at grid points where the state
+     * has barely changed.
+     *
+     * With a non-zero tolerance, the inputs (pressure, temperature and
+     * composition) and outputs of the last evaluation at each grid point are
+     * stored. If the relative change in pressure and temperature since then is
+     * below the tolerance at a grid point, and the composition is unchanged,
+     * the stored result is reused instead of evaluating the equation of state
+     * again. The compressibility factor is then updated to first order using
+     * the stored \f$\frac{\partial Z}{\partial p}|_T\f$ and
+     * \f$\frac{\partial Z}{\partial T}|_p\f$.
+     *
+     * The stored results always come from a full evaluation, so the error does
+     * not accumulate over several calls.
+     *
+     * \param tolerance Relative change in pressure and temperature below which
+     * results are reused. Reuse is disabled if 0 (default).
+     */
+    void setCacheTolerance(const double tolerance);
+
+    //! Get the tolerance used for reusing previous results
+    double cacheTolerance() const { return m_cacheTolerance; }
+
+    //! Number of grid point evaluations where the previous result was reused
+    arma::uword cacheHits() const { return m_cacheHits; }
+
+    //! Number of grid point evaluations done while reuse was enabled
+    arma::uword cacheLookups() const { return m_cacheLookups; }
+
+    //! Fraction of grid point evaluations where the previous result was reused
+    double cacheHitRate() const;
+
+    //! Reset cacheHits() and cacheLookups()
+    void resetCacheStatistics();
+
+    /*!
+     * \brief Set the thread pool used to evaluate the grid points in
+     * parallel.
+     * \param threadPool Thread pool, shared with the owner (e.g. Physics).
+     * Grid points are evaluated serially if nullptr (default).
+     */
+    void setThreadPool(std::shared_ptr<utils::ThreadPool> threadPool);
+
     //! std::vector-like at(i) getter
     const EquationOfStateBase& at(std::size_t pos) const { return *m_eos->at(pos); }
 
@@ -45,4 +121,42 @@ public:
 private:
     //! Vector of EquationOfStateBase instances, one for each grid point.
     std::unique_ptr<std::vector<std::unique_ptr<EquationOfStateBase>>> m_eos;
+
+    /*!
+     * \brief Evaluate the equation of state at the given grid points.
+     * \param state Pipeline instance
+     * \param indices Grid points to evaluate
+     * \param n Evaluate only the first n elements of indices. If n is the
+     * number of grid points, indices is not used, and all grid points are
+     * evaluated.
+     * \param output Output matrix with one row per grid point in the
+     * Pipeline. Only the rows in indices are changed.
+     */
+    void evaluateGridPoints(
+            const Pipeline& state,
+            const arma::uvec& indices,
+            const arma::uword n,
+            arma::mat& output);
+
+    double m_cacheTolerance = 0; //!< Relative tolerance for reusing results
+    arma::uword m_cacheHits = 0; //!< Number of reused results
+    arma::uword m_cacheLookups = 0; //!< Number of grid point evaluations with reuse enabled
+
+    arma::vec m_cachedPressure; //!< Pressure at the last full evaluation at each grid point
+    arma::vec m_cachedTemperature; //!< Temperature at the last full evaluation at each grid point
+    arma::mat m_cachedComposition; //!< Composition at the last full evaluation at each grid point (one column per grid point)
+    arma::mat m_cachedOutput; //!< Output of the last full evaluation at each grid point
+
+    arma::uvec m_indices; //!< Buffer for the grid points to evaluate
+    arma::vec m_batchPressure; //!< Buffer for the pressure of the grid points to evaluate
+    arma::vec m_batchTemperature; //!< Buffer for the temperature of the grid points to evaluate
+    arma::mat m_batchOutput; //!< Buffer for the output of the grid points to evaluate
+
+    //! Last converged density at each grid point, used for the initial guess
+    //! of the next evaluation
+    std::vector<EquationOfStateBase::DensityState> m_densityStates;
+    //! Buffer for the density states of the grid points to evaluate
+    std::vector<EquationOfStateBase::DensityState> m_batchDensityStates;
+
+    std::shared_ptr<utils::ThreadPool> m_threadPool; //!< Thread pool used to evaluate grid points in parallel
 };
@@ -15,12 +15,118 @@ EquationOfStateBase::EquationOfStateBase(const vec& composition)
     this->setComposition(composition);
 }
 
+double EquationOfStateBase::DensityState::extrapolate(const double pressure, const double temperature) const
+{
+    if (!valid())
+    {
+        return 0;
+    }
+
+    return density*std::exp(
+                dLogDensitydp*(pressure - this->pressure)
+                + dLogDensitydT*(temperature - this->temperature));
+}
+
+void EquationOfStateBase::DensityState::update(
+        const double pressure,
+        const double temperature,
+        const double density,
+        const double Z,
+        const double dZdp,
+        const double dZdT)
+{
+    this->pressure = pressure;
+    this->temperature = temperature;
+    this->density = density;
+
+    // rho = p/(Z R T)
+    dLogDensitydp = 1/pressure - dZdp/Z;
+    dLogDensitydT = -1/temperature - dZdT/Z;
+}
+
 vec EquationOfStateBase::evaluate(const double pressure, const double temperature, const vec& composition)
 {
     this->setComposition(composition, false);
     return this->evaluate(pressure, temperature);
 }
 
+vec EquationOfStateBase::evaluate(const double pressure, const double temperature, DensityState&) const
+{
+    return this->evaluate(pressure, temperature);
+}
+
+void EquationOfStateBase::evaluateBatch(
+        const vec& pressure,
+        const vec& temperature,
+        const arma::mat& composition,
+        arma::mat& output)
+{
+    std::vector<DensityState> densityStates;
+    this->evaluateBatch(pressure, temperature, composition, output, densityStates);
+}
+
+void EquationOfStateBase::evaluateBatch(
+        const vec& pressure,
+        const vec& temperature,
+        const arma::mat& composition,
+        arma::mat& output,
+        std::vector<DensityState>& densityStates)
+{
+    const arma::uword n = prepareBatch(pressure, temperature, composition, output, densityStates);
+    for (arma::uword i = 0; i < n; i++)
+    {
+        setBatchComposition(composition, i);
+        const vec out = this->evaluate(pressure(i), temperature(i), batchDensityState(densityStates, i));
+        for (arma::uword j = 0; j < 6; j++)
+            output.at(i, j) = out(j);
+        output.at(i, 6) = m_molarMassOfMixture;
+    }
+}
+
+arma::uword EquationOfStateBase::prepareBatch(
+        const vec& pressure,
+        const vec& temperature,
+        const arma::mat& composition,
+        arma::mat& output,
+        std::vector<DensityState>& densityStates)
+{
+    const arma::uword n = pressure.n_elem;
+    if (temperature.n_elem != n)
+        throw std::invalid_argument("pressure and temperature must have the same size");
+    if (composition.n_rows != 10 || (composition.n_cols != 1 && composition.n_cols != n))
+        throw std::invalid_argument("composition must have 10 rows, and one column or one column per state");
+
+    output.set_size(n, 7); // no-op if already the right size
+
+    if (densityStates.size() != n)
+    {
+        densityStates.assign(n, DensityState());
+    }
+
+    return n;
+}
+
+EquationOfStateBase::DensityState& EquationOfStateBase::batchDensityState(
+        std::vector<DensityState>& densityStates,
+        const arma::uword i)
+{
+    if (i > 0 && !densityStates[i].valid())
+    {
+        densityStates[i] = densityStates[i - 1];
+    }
+
+    return densityStates[i];
+}
+
+void EquationOfStateBase::setBatchComposition(const arma::mat& composition, const arma::uword i)
+{
+    const arma::uword col = composition.n_cols == 1 ? 0 : i;
+
+    // small enough for armadillo to copy without a heap allocation
+    const vec x = composition.col(col);
+    this->setComposition(x, false);
+}
+
 double EquationOfStateBase::calculateStandardDensity() const
 {
     // [kg/Sm3] density of ideal gas at standard conditions
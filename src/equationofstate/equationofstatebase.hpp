@@ -1,5 +1,6 @@
 #pragma once
 
+#include <vector>
 #include <armadillo>
 
 #include "composition.hpp"
@@ -20,6 +21,61 @@
 class EquationOfStateBase
 {
 public:
+    /*!
+     * \brief The last converged density at a state (e.g. a grid point), used
+     * to extrapolate the initial guess when the density is solved for again.
+     *
+     * The state is stored with the logarithmic derivatives of the density,
+     * \f$\frac{\partial \ln \rho}{\partial p}|_T = \frac{1}{p} - \frac{1}{Z}\frac{\partial Z}{\partial p}|_T\f$ and
+     * \f$\frac{\partial \ln \rho}{\partial T}|_p = -\frac{1}{T} - \frac{1}{Z}\frac{\partial Z}{\partial T}|_p\f$,
+     * which the equations of state calculate anyway. The initial guess at a
+     * new pressure and temperature is then
+     * \f$\rho_0 \exp\left(\frac{\partial \ln \rho}{\partial p}\Delta p + \frac{\partial \ln \rho}{\partial T}\Delta T\right)\f$,
+     * which is accurate to first order (and always positive), so Newton's
+     * method usually converges in one or two iterations.
+     *
+     * The state is owned by the caller (see EquationOfState), so the
+     * equation of state instances have no hidden state, and can be used from
+     * several threads at once.
+     */
+    struct DensityState
+    {
+        double pressure = 0; //!< Pressure of the last converged density [Pa]
+        double temperature = 0; //!< Temperature of the last converged density [K]
+        double density = 0; //!< Last converged density [kg/m3], 0 if not set
+        double dLogDensitydp = 0; //!< \f$\frac{\partial \ln \rho}{\partial p}|_T\f$ [1/Pa]
+        double dLogDensitydT = 0; //!< \f$\frac{\partial \ln \rho}{\partial T}|_p\f$ [1/K]
+
+        //! Check if a converged density has been stored
+        bool valid() const { return density > 0; }
+
+        /*!
+         * \brief Extrapolate the stored density to a new state.
+         * \param pressure Gas pressure [Pa].
+         * \param temperature Gas temperature [K].
+         * \return Initial guess for the density [kg/m3], or 0 if no density
+         * has been stored.
+         */
+        double extrapolate(const double pressure, const double temperature) const;
+
+        /*!
+         * \brief Store a converged density with the derivatives of Z.
+         * \param pressure Gas pressure [Pa].
+         * \param temperature Gas temperature [K].
+         * \param density Gas density [kg/m3].
+         * \param Z Compressibility factor.
+         * \param dZdp \f$\frac{\partial Z}{\partial p}|_T\f$
+         * \param dZdT \f$\frac{\partial Z}{\partial T}|_p\f$
+         */
+        void update(
+                const double pressure,
+                const double temperature,
+                const double density,
+                const double Z,
+                const double dZdp,
+                const double dZdT);
+    };
+
     //! Have to declare virtual destructor to avoid compiler warnings.
     //! Only declared here, to avoid the inline compiler-generated default destructor.
     virtual ~EquationOfStateBase();
@@ -44,6 +100,21 @@ public:
      */
     virtual arma::vec evaluate(const double pressure, const double temperature) const = 0;
 
+    /*!
+     * \brief Evaluate the EOS at constant composition, using and updating the
+     * last converged density at this state.
+     *
+     * The default implementation ignores state, and calls evaluate().
+     * Equations of state that solve for the density override this, and
+     * extrapolate the initial guess from state (see DensityState).
+     *
+     * \param pressure Gas pressure [Pa].
+     * \param temperature Gas temperature [K].
+     * \param state Last converged density, updated with the new density.
+     * \return See evaluate().
+     */
+    virtual arma::vec evaluate(const double pressure, const double temperature, DensityState& state) const;
+
     /*!
      * \brief Virtual function for evaluating the EOS at a new composition.
      *
@@ -65,6 +136,49 @@ public:
      */
     virtual arma::vec evaluate(const double pressure, const double temperature, const arma::vec& composition);
 
+    /*!
+     * \brief Evaluate the EOS at several states (e.g. all grid points) at once.
+     *
+     * The inputs and output are stored as structure-of-arrays, so each
+     * property is contiguous in memory, and the output is written into a
+     * caller-owned buffer, which is only reallocated if it does not have the
+     * right size.
+     *
+     * The default implementation calls setComposition() and evaluate() for
+     * each state. Subclasses override this to avoid the per-state
+     * allocations.
+     *
+     * \param pressure Gas pressure at each state [Pa].
+     * \param temperature Gas temperature at each state [K].
+     * \param composition Gas composition fractions [-], either one column per
+     * state, or a single column used for all states.
+     * \param output Matrix with one row per state, and the columns
+     * \f$Z\f$, \f$\frac{\partial Z}{\partial T}|_p\f$,
+     * \f$\frac{\partial Z}{\partial p}|_T\f$, \f$\frac{\partial Z}{\partial T}|_\rho\f$,
+     * \f$c_p\f$, \f$c_v\f$ and the molar mass of the mixture [g/mol].
+     * \param densityStates Last converged density at each state (see
+     * DensityState), updated with the new densities. Reset if it doesn't
+     * have one element per state. States without a converged density start
+     * from the (just updated) state before it.
+     */
+    virtual void evaluateBatch(
+            const arma::vec& pressure,
+            const arma::vec& temperature,
+            const arma::mat& composition,
+            arma::mat& output,
+            std::vector<DensityState>& densityStates);
+
+    /*!
+     * \brief Evaluate the EOS at several states, without keeping the
+     * converged densities.
+     * \see evaluateBatch()
+     */
+    void evaluateBatch(
+            const arma::vec& pressure,
+            const arma::vec& temperature,
+            const arma::mat& composition,
+            arma::mat& output);
+
     /*!
      * \brief Method for calculating just the compressibility factor Z at a given pressure and temperature.
      * \param pressure Gas pressure [Pa].
@@ -96,6 +210,31 @@ protected:
     //! The molar mass of the gas mixture [g/mol]
     double m_molarMassOfMixture;
 
-    //! Cache density for optimization [kg/m3]
-    mutable double m_density = 0;
+    /*!
+     * \brief Check the sizes of the input to evaluateBatch(), and set the
+     * size of the output.
+     * \return Number of states
+     */
+    static arma::uword prepareBatch(
+            const arma::vec& pressure,
+            const arma::vec& temperature,
+            const arma::mat& composition,
+            arma::mat& output,
+            std::vector<DensityState>& densityStates);
+
+    /*!
+     * \brief Get the density state of state i in evaluateBatch(), starting
+     * from the state before it if it has no converged density.
+     * \param densityStates Density states passed to evaluateBatch()
+     * \param i State index
+     */
+    static DensityState& batchDensityState(std::vector<DensityState>& densityStates, const arma::uword i);
+
+    /*!
+     * \brief Set composition to column i of composition (or the only column)
+     * without copying it to a temporary.
+     * \param composition Compositions passed to evaluateBatch()
+     * \param i State index
+     */
+    void setBatchComposition(const arma::mat& composition, const arma::uword i);
 };
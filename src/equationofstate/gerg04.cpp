@@ -1,12 +1,16 @@
 #include "equationofstate/gerg04.hpp"
 
+#include <array>
 #include <cmath>
+#include <memory>
 
 #include "utilities/utilities.hpp"
 #include "utilities/errors.hpp"
 #include "utilities/physics.hpp"
 #include "utilities/stringbuilder.hpp"
 #include "constants.hpp"
+#include "equationofstate/mixturecache.hpp"
+#include "equationofstate/gerg04coefficients.hpp"
 
 using utils::pow2;
 using utils::pow3;
@@ -15,23 +19,19 @@ using utils::pow5;
 using arma::vec;
 using arma::uvec;
 using arma::mat;
-using arma::cube;
 using arma::zeros;
 using arma::uword;
 using std::string;
 
-const string path = string(TRANSFLOW_RESOURCE_PATH) + "/equationofstate/gerg04/";
-const arma::file_type fileType = arma::hdf5_binary;
-
-mat GERG04::betav = utils::loadMatFromFile(path + "betav.h5", fileType); // beta density interaction coefficient
-mat GERG04::betat = utils::loadMatFromFile(path + "betat.h5", fileType); // beta temperature coefficient
-mat GERG04::gammav = utils::loadMatFromFile(path + "gammav.h5", fileType); // gamma density interaction coefficient
-mat GERG04::gammat = utils::loadMatFromFile(path + "gammat.h5", fileType); //gamma temperature interaction coefficient
+using gerg04::betav;
+using gerg04::betat;
+using gerg04::gammav;
+using gerg04::gammat;
 
 // Kpol coefficients
-mat GERG04::noipol = utils::loadMatFromFile(path + "noipol.h5", fileType);
-mat GERG04::doipol = utils::loadMatFromFile(path + "doipol.h5", fileType);
-mat GERG04::toipol = utils::loadMatFromFile(path + "toipol.h5", fileType);
+using gerg04::noipol;
+using gerg04::doipol;
+using gerg04::toipol;
 
 // noipol, doipol, toipol (1, 1:6) -- C1 methane
 // noipol, doipol, toipol (2, 1:6) -- nitrogen
@@ -45,10 +45,10 @@ mat GERG04::toipol = utils::loadMatFromFile(path + "toipol.h5", fileType);
 // noipol, doipol, toipol (10, 1:6) -- nC6 n-hexane
 
 //// Kexp coefficient
-mat GERG04::noiexp = utils::loadMatFromFile(path + "noiexp.h5", fileType);
-mat GERG04::doiexp = utils::loadMatFromFile(path + "doiexp.h5", fileType);
-mat GERG04::coiexp = utils::loadMatFromFile(path + "coiexp.h5", fileType);
-mat GERG04::toiexp = utils::loadMatFromFile(path + "toiexp.h5", fileType);
+using gerg04::noiexp;
+using gerg04::doiexp;
+using gerg04::coiexp;
+using gerg04::toiexp;
 
 // noiexp, doiexp, coiexp, toiexp (1, 7:24) -- C1 methane
 // noiexp, doiexp, coiexp, toiexp (2, 7:24) -- nitrogen
@@ -61,39 +61,55 @@ mat GERG04::toiexp = utils::loadMatFromFile(path + "toiexp.h5", fileType);
 // noiexp, doiexp, coiexp, toiexp (9, 7:12) -- iC5 i-pentane
 // noiexp, doiexp, coiexp, toiexp (10, 7:12) -- nC6 n-hexane
 
-mat GERG04::Fij = utils::loadMatFromFile(path + "Fij.h5", fileType); // Fij interaction coefficient
+using gerg04::Fij; // Fij interaction coefficient
 
-cube GERG04::nijpol = utils::loadCubeFromFile(path + "nijpol.h5", fileType);
-cube GERG04::nijexp = utils::loadCubeFromFile(path + "nijexp.h5", fileType);
-cube GERG04::dijpol = utils::loadCubeFromFile(path + "dijpol.h5", fileType);
-cube GERG04::dijexp = utils::loadCubeFromFile(path + "dijexp.h5", fileType);
-cube GERG04::tijpol = utils::loadCubeFromFile(path + "tijpol.h5", fileType);
-cube GERG04::tijexp = utils::loadCubeFromFile(path + "tijexp.h5", fileType);
+using gerg04::nijpol;
+using gerg04::nijexp;
+using gerg04::dijpol;
+using gerg04::dijexp;
+using gerg04::tijpol;
+using gerg04::tijexp;
 
-cube GERG04::nuijexp = utils::loadCubeFromFile(path + "nuijexp.h5", fileType);
-cube GERG04::epijexp = utils::loadCubeFromFile(path + "epijexp.h5", fileType);
-cube GERG04::beijexp = utils::loadCubeFromFile(path + "beijexp.h5", fileType);
-cube GERG04::gaijexp = utils::loadCubeFromFile(path + "gaijexp.h5", fileType);
+using gerg04::nuijexp;
+using gerg04::epijexp;
+using gerg04::beijexp;
+using gerg04::gaijexp;
 
 // other coefficients
-mat GERG04::noik = utils::loadMatFromFile(path + "noik.h5", fileType);
-mat GERG04::voik = utils::loadMatFromFile(path + "voik.h5", fileType);
+using gerg04::noik;
+using gerg04::voik;
 
-// constant terms
-cube GERG04::nijpol_times_tijpol = GERG04::nijpol % GERG04::tijpol;
-cube GERG04::nijpol_times_tijpol_times_tijpol_minus_one =
-        (GERG04::nijpol % GERG04::tijpol) % (GERG04::tijpol - 1.0);
+namespace
+{
 
-cube GERG04::nijexp_times_tijexp = GERG04::nijexp % GERG04::tijexp;
-cube GERG04::nijexp_times_tijexp_times_tijexp_minus_one =
-        GERG04::nijexp % GERG04::tijexp % (GERG04::tijexp - 1.0);
+//! Number of non-zero coefficients in table, i.e. the number of pure
+//! component terms if all components are present
+template <std::size_t Rows, std::size_t Cols>
+constexpr std::size_t countTerms(const gerg04::Table2<Rows, Cols>& table)
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < Rows; i++)
+        for (std::size_t k = 0; k < Cols; k++)
+            count += table(i, k) != 0;
 
-cube GERG04::nijpol_times_dijpol =
-        GERG04::nijpol % GERG04::dijpol;
-cube GERG04::nijpol_times_dijpol_times_tijpol =
-        GERG04::nijpol % GERG04::dijpol % GERG04::tijpol;
-cube GERG04::nijpol_times_dijpol_times_dijpol_minus_one =
-        GERG04::nijpol % GERG04::dijpol % (GERG04::dijpol - 1.0);
+    return count;
+}
+
+//! Number of non-zero coefficients in table of the pairs with non-zero Fij,
+//! i.e. the number of binary mixture terms if all components are present
+template <std::size_t Rows, std::size_t Cols, std::size_t Slices>
+constexpr std::size_t countTerms(const gerg04::Table3<Rows, Cols, Slices>& table)
+{
+    std::size_t count = 0;
+    for (std::size_t i = 0; i < Rows; i++)
+        for (std::size_t j = 0; j < Cols; j++)
+            for (std::size_t k = 0; k < Slices && Fij(i, j) != 0; k++)
+                count += table(i, j, k) != 0;
+
+    return count;
+}
+
+} // end anonymous namespace
 
 GERG04::GERG04(const vec& composition):
     EquationOfStateBase(composition)
@@ -113,10 +129,29 @@ void GERG04::calculateCoefficients()
     const double R = 8.314472; // [J/mol K] gas constant from TM15 page XII
     Ra = R*1000/m_molarMassOfMixture; // gas constant of mixture
 
+    // the reducing functions only depend on composition, so they are shared
+    // with all other instances with the same composition
+    const std::shared_ptr<const ReducingFunctions> reducing =
+            MixtureCache<ReducingFunctions>::get(
+                "GERG04",
+                m_composition,
+                [this](const vec&) { return calculateReducingFunctions(); });
+
+    rhored = reducing->rhored;
+    tred = reducing->tred;
+
+    m_terms = MixtureCache<ResidualTerms>::get(
+                "GERG04",
+                m_composition,
+                [this](const vec&) { return calculateResidualTerms(); });
+}
+
+GERG04::ReducingFunctions GERG04::calculateReducingFunctions() const
+{
     // find reducing function for mixture density and temperature
     // using eq. (7.9) and eq. (7.10)
-    rhored = 0; // (inverse) reducing function for mixture density == 1/\rho_r(\bar x)
-    tred = 0; // reducing function for mixture temperature == T_r(\bar x)
+    double rhored = 0; // (inverse) reducing function for mixture density == 1/\rho_r(\bar x)
+    double tred = 0; // reducing function for mixture temperature == T_r(\bar x)
     for (uword i : m_indices)
     {
         rhored += pow2(X(i))/rhoc(i);
@@ -132,6 +167,139 @@ void GERG04::calculateCoefficients()
                 2.0*X(i)*X(j)*betat(i,j)*gammat(i,j)*(X(i) + X(j))/(pow2(betat(i,j))*X(i) + X(j))*sqrt(Tc(i)*Tc(j));
         }
     }
+
+    ReducingFunctions reducing;
+    reducing.rhored = rhored;
+    reducing.tred = tred;
+
+    return reducing;
+}
+
+GERG04::PowerLadder::PowerLadder(const double x):
+    x(x)
+{
+    powers[0] = 1;
+    for (int i = 1; i <= maxExponent; i++)
+    {
+        powers[i] = powers[i - 1]*x;
+    }
+}
+
+int GERG04::PowerLadder::index(const double exponent)
+{
+    if (exponent >= 0 && exponent <= maxExponent && exponent == std::floor(exponent))
+    {
+        return static_cast<int>(exponent);
+    }
+
+    return -1; // use std::pow
+}
+
+void GERG04::PolynomialTerms::add(const double n, const double d, const double t, const double tRho)
+{
+    this->n.push_back(n);
+    this->d.push_back(d);
+    this->dIndex.push_back(PowerLadder::index(d));
+    this->t.push_back(t);
+    this->tRho.push_back(tRho);
+}
+
+void GERG04::PureExponentialTerms::add(const double n, const double d, const double c, const double t)
+{
+    this->n.push_back(n);
+    this->d.push_back(d);
+    this->dIndex.push_back(PowerLadder::index(d));
+    this->c.push_back(c);
+    this->cIndex.push_back(PowerLadder::index(c));
+    this->t.push_back(t);
+}
+
+void GERG04::BinaryExponentialTerms::add(
+        const double n,
+        const double d,
+        const double t,
+        const double eta,
+        const double epsilon,
+        const double beta,
+        const double gamma)
+{
+    this->n.push_back(n);
+    this->d.push_back(d);
+    this->dIndex.push_back(PowerLadder::index(d));
+    this->t.push_back(t);
+    this->eta.push_back(eta);
+    this->epsilon.push_back(epsilon);
+    this->beta.push_back(beta);
+    this->gamma.push_back(gamma);
+}
+
+GERG04::ResidualTerms GERG04::calculateResidualTerms() const
+{
+    // each term is either polynomial or exponential, so only one of
+    // noipol/noiexp (and nijpol/nijexp) is non-zero
+    ResidualTerms terms;
+    for (uword i : m_indices)
+    {
+        for (uword k = 0; k < 24; k++)
+        {
+            if (noipol(i,k) != 0)
+            {
+                terms.purePolynomial.add(X(i)*noipol(i,k), doipol(i,k), toipol(i,k), toipol(i,k));
+            }
+            if (noiexp(i,k) != 0)
+            {
+                terms.pureExponential.add(X(i)*noiexp(i,k), doiexp(i,k), coiexp(i,k), toiexp(i,k));
+            }
+        }
+    }
+
+    // Fij is zero unless i < j
+    for (uword i : m_indices)
+    {
+        for (uword j : m_indices)
+        {
+            const double XiXjFij = X(i)*X(j)*Fij(i,j);
+            if (XiXjFij == 0)
+                continue;
+
+            for (uword k = 0; k < 20; k++)
+            {
+                if (nijpol(i,j,k) != 0)
+                {
+                    terms.binaryPolynomial.add(XiXjFij*nijpol(i,j,k), dijpol(i,j,k), tijpol(i,j,k), toipol(i,j));
+                }
+                if (nijexp(i,j,k) != 0)
+                {
+                    terms.binaryExponential.add(
+                                XiXjFij*nijexp(i,j,k), dijexp(i,j,k), tijexp(i,j,k),
+                                nuijexp(i,j,k), epijexp(i,j,k), beijexp(i,j,k), gaijexp(i,j,k));
+                }
+            }
+        }
+    }
+
+    return terms;
+}
+
+void GERG04::evaluateTauPowers(const double tau, TauPowers& tauPowers) const
+{
+    static_assert(TauPowers::maxPurePolynomial == countTerms(noipol), "TauPowers::maxPurePolynomial");
+    static_assert(TauPowers::maxPureExponential == countTerms(noiexp), "TauPowers::maxPureExponential");
+    static_assert(TauPowers::maxBinaryPolynomial == countTerms(nijpol), "TauPowers::maxBinaryPolynomial");
+    static_assert(TauPowers::maxBinaryExponential == countTerms(nijexp), "TauPowers::maxBinaryExponential");
+
+    const auto evaluatePowers = [tau](const std::vector<double>& exponents, double* powers)
+    {
+        for (std::size_t k = 0; k < exponents.size(); k++)
+        {
+            powers[k] = pow(tau, exponents[k]);
+        }
+    };
+
+    evaluatePowers(m_terms->purePolynomial.t, tauPowers.purePolynomial.data());
+    evaluatePowers(m_terms->pureExponential.t, tauPowers.pureExponential.data());
+    evaluatePowers(m_terms->binaryPolynomial.t, tauPowers.binaryPolynomial.data());
+    evaluatePowers(m_terms->binaryExponential.t, tauPowers.binaryExponential.data());
 }
 
 bool GERG04::setComposition(const vec& composition, const bool force)
@@ -157,12 +325,19 @@ bool GERG04::setComposition(const vec& composition, const bool force)
 
 vec GERG04::evaluate(const double pressure, const double temperature) const
 {
-    vec Z_all = evaluateAllProperties(pressure, temperature);
+    DensityState state; // no initial guess
+    return evaluate(pressure, temperature, state);
+}
+
+vec GERG04::evaluate(const double pressure, const double temperature, DensityState& state) const
+{
+    std::array<double, 15> Z_all;
+    evaluateAllPropertiesInto(pressure, temperature, state, Z_all.data());
     vec Z_factor = zeros<vec>(6);
-    Z_factor(0) = Z_all(0); // Z
-    Z_factor(1) = Z_all(1);
-    Z_factor(2) = Z_all(2);
-    Z_factor(3) = Z_all(3);
+    Z_factor(0) = Z_all[0]; // Z
+    Z_factor(1) = Z_all[1];
+    Z_factor(2) = Z_all[2];
+    Z_factor(3) = Z_all[3];
     if (false)
     {
         Z_factor(4) = utils::calculateHeatCapacityConstantPressureTGNet(m_molarMassOfMixture, pressure, temperature); // c_p
@@ -170,13 +345,36 @@ vec GERG04::evaluate(const double pressure, const double temperature) const
     }
     else
     {
-        Z_factor(4) = Z_all(8); // c_p
-        Z_factor(5) = Z_all(6); // c_v
+        Z_factor(4) = Z_all[8]; // c_p
+        Z_factor(5) = Z_all[6]; // c_v
     }
 
     return Z_factor;
 }
 
+void GERG04::evaluateBatch(
+        const vec& pressure,
+        const vec& temperature,
+        const arma::mat& composition,
+        arma::mat& output,
+        std::vector<DensityState>& densityStates)
+{
+    const arma::uword n = prepareBatch(pressure, temperature, composition, output, densityStates);
+    std::array<double, 15> Z_all; // scratch, on the stack
+    for (arma::uword i = 0; i < n; i++)
+    {
+        setBatchComposition(composition, i);
+        evaluateAllPropertiesInto(pressure[i], temperature[i], batchDensityState(densityStates, i), Z_all.data());
+        output.at(i, 0) = Z_all[0]; // Z
+        output.at(i, 1) = Z_all[1];
+        output.at(i, 2) = Z_all[2];
+        output.at(i, 3) = Z_all[3];
+        output.at(i, 4) = Z_all[8]; // c_p
+        output.at(i, 5) = Z_all[6]; // c_v
+        output.at(i, 6) = m_molarMassOfMixture;
+    }
+}
+
 double GERG04::calculateCompressibility(const double pressure, const double temperature) const
 {
     double density = findDensity(pressure, temperature);
@@ -193,12 +391,17 @@ double GERG04::findDensity(const double pressure, const double temperature) cons
     double aroideltadelta = 0;
     double arijdeltadelta = 0;
 
-    return findDensity(pressure, temperature, density, aroidelta, arijdelta, aroideltadelta, arijdeltadelta);
+    TauPowers tauPowers;
+    evaluateTauPowers(tred/temperature, tauPowers);
+
+    return findDensity(pressure, temperature, 0, tauPowers, density, aroidelta, arijdelta, aroideltadelta, arijdeltadelta);
 }
 
 double GERG04::findDensity(
         const double pressure,
         const double temperature,
+        const double initialDensity,
+        const TauPowers& tauPowers,
         double& density, // output
         double& aroidelta, // output
         double& arijdelta, // output
@@ -218,24 +421,24 @@ double GERG04::findDensity(
 
     const double tred_temperature = tred/temperature;
 
-    double initialDensity;
-    if (m_density <= 0)
+    double densityGuess;
+    if (initialDensity <= 0)
     {
         // use density of ideal gas as starting point
         const double specificGasConstant = constants::gasConstant/(m_molarMassOfMixture/1000.0 /*g->kg*/); // J/(kg*K)
         const double idealGasDensity = pressure/(specificGasConstant*temperature);
         if (idealGasDensity <= 0)
             throw std::runtime_error("ideal gas density <= 0");
-        initialDensity = idealGasDensity;
+        densityGuess = idealGasDensity;
     }
     else
     {
-        // use cached density
-        initialDensity = m_density;
+        // use given (e.g. extrapolated) density
+        densityGuess = initialDensity;
     }
 
-    const bool noInitialDensity = true;
-    double previousDensity = initialDensity;
+    const bool noInitialDensity = initialDensity <= 0;
+    double previousDensity = densityGuess;
     double pow2_density = previousDensity*previousDensity;
     double density_rhored = previousDensity*rhored;
     double density_rhored_pow_minusOne = 1.0/density_rhored;
@@ -255,7 +458,7 @@ double GERG04::findDensity(
     uword counter = 0;
     while (run)
     {
-        this->evaluateAlpha_roi_deltas(tred_temperature, density_rhored, density_rhored_pow_minusOne, density_rhored_pow_minusTwo, aroidelta, arijdelta, aroideltadelta, arijdeltadelta);
+        this->evaluateAlpha_roi_deltas(tred_temperature, density_rhored, density_rhored_pow_minusOne, density_rhored_pow_minusTwo, tauPowers, aroidelta, arijdelta, aroideltadelta, arijdeltadelta);
         const double diff = (previousDensity + pow2_density*rhored*(aroidelta + arijdelta) - pressure/(Ra*temperature))/(1 + 2*density_rhored*(aroidelta + arijdelta) + pow2_density*rhored*(aroideltadelta + arijdeltadelta));
 
         if (counter > firstSORlimit)
@@ -299,8 +502,6 @@ double GERG04::findDensity(
         }
     }
 
-    m_density = density; // cache density (mutable)
-
     return density;
 }
 
@@ -309,79 +510,212 @@ void GERG04::evaluateAlpha_roi_deltas(
         const double start_rhored,
         const double start_rhored_pow_minusOne,
         const double start_rhored_pow_minusTwo,
+        const TauPowers& tauPowers,
         double& aroidelta, // output
         double& arijdelta, // output
         double& aroideltadelta, // output
         double& arijdeltadelta // output
         ) const
 {
-    aroidelta=0;
-    arijdelta=0;
-    aroideltadelta=0;
-    arijdeltadelta=0;
-    for (uword i : m_indices)
+    const double tau = tred_temperature;
+    const PowerLadder delta(start_rhored);
+
+    // the factors delta^-1 and delta^-2 common to all terms are applied after
+    // the sums
+    double aroidelta_sum = 0;
+    double aroideltadelta_sum = 0;
+    const PolynomialTerms& purePolynomial = m_terms->purePolynomial;
+    for (std::size_t k = 0; k < purePolynomial.size(); k++)
     {
-        double aroidelta_part = 0;
-        double aroideltadelta_part = 0;
-        for (uword k = 0; k < 24; k++)
-        {
-            const double pow_t_toipol = pow(tred_temperature, toipol(i,k));
-            const double noipoldoipol = noipol(i,k)*doipol(i,k);
-            const double powstartrhoredcoiexp = pow(start_rhored, coiexp(i,k));
-            const double doiexcoiexppow = doiexp(i,k)-coiexp(i,k)*powstartrhoredcoiexp;
-            const double pow_start_rhored_doipol = pow(start_rhored, doipol(i,k));
-            const double pow_start_rhored_doiexp = pow(start_rhored, doiexp(i,k));
-
-            aroidelta_part +=
-                    +(noipoldoipol*pow_start_rhored_doipol*start_rhored_pow_minusOne*pow_t_toipol)
-                    +(noiexp(i,k)*pow_start_rhored_doiexp*start_rhored_pow_minusOne*(doiexcoiexppow)*pow(tred_temperature, toiexp(i,k))*exp(-(start_rhored)*coiexp(i,k)));
-            aroideltadelta_part +=
-                    +noipoldoipol*(doipol(i,k)-1)*pow_start_rhored_doipol*start_rhored_pow_minusTwo*pow_t_toipol
-                    +noiexp(i,k)*pow_start_rhored_doiexp*start_rhored_pow_minusTwo*
-                    (
-                        (doiexcoiexppow)
-                        *(doiexp(i,k)-1-coiexp(i,k)*powstartrhoredcoiexp)-pow2(coiexp(i,k))*powstartrhoredcoiexp
-                    // this line contains an error when comparing to the
-                    // expression in Table 7.7 in TM15 --
-                    // (tred_temperature) should be replaced by
-                    // pow(tred_temperature, toiexp(i,k))
-                    // but testing this leads to very bad results, so I'm
-                    // not sure what is going on
-                    )*(tred_temperature)*exp(-powstartrhoredcoiexp);
-        }
-        aroidelta += aroidelta_part*X(i);
-        aroideltadelta += aroideltadelta_part*X(i);
+        const double d = purePolynomial.d[k];
+        const double term = purePolynomial.n[k]*delta(purePolynomial.dIndex[k], d)*tauPowers.purePolynomial[k];
+
+        aroidelta_sum += d*term;
+        aroideltadelta_sum += d*(d - 1)*term;
     }
-    for (uword i : m_firstIndices)
+
+    const PureExponentialTerms& pureExponential = m_terms->pureExponential;
+    for (std::size_t k = 0; k < pureExponential.size(); k++)
     {
-        for (uword j : m_lastIndices)
-        {
-            double arijdelta_part = 0;
-            double arijdeltadelta_part = 0;
-            for (uword k = 0; k < 20; k++)
-            {
-                const double powtredtijpol = pow(tred_temperature, tijpol(i,j,k));
-                const double powtredtijexp = pow(tred_temperature, tijexp(i,j,k));
-                const double pow_start_rhored_dijexp = pow(start_rhored, dijexp(i,j,k));
-                const double pow_start_rhored_dijpol = pow(start_rhored, dijpol(i,j,k));
-                const double WHAT = exp(-nuijexp(i,j,k)*pow2(start_rhored - epijexp(i,j,k)) - beijexp(i,j,k)*(start_rhored - gaijexp(i,j,k)));
-                const double HEI = dijexp(i,j,k)/(start_rhored) - 2*nuijexp(i,j,k)*(start_rhored - epijexp(i,j,k)) - beijexp(i,j,k);
-
-                arijdelta_part +=
-                        nijpol_times_dijpol(i,j,k)*pow_start_rhored_dijpol*start_rhored_pow_minusOne*powtredtijpol
-                        +nijexp(i,j,k)*pow_start_rhored_dijexp*powtredtijexp*WHAT*HEI;
-
-                arijdeltadelta_part +=
-                        nijpol_times_dijpol_times_dijpol_minus_one(i,j,k)*pow_start_rhored_dijpol*start_rhored_pow_minusTwo*powtredtijpol
-                        +nijexp(i,j,k)*pow_start_rhored_dijexp*powtredtijexp*WHAT*(HEI*HEI-dijexp(i,j,k)/pow2(start_rhored)-2*nuijexp(i,j,k));
-            }
-            arijdelta += arijdelta_part*X(i)*X(j)*Fij(i,j);
-            arijdeltadelta += arijdeltadelta_part*X(i)*X(j)*Fij(i,j);
-        }
+        const double d = pureExponential.d[k];
+        const double c = pureExponential.c[k];
+        const double n_pow_delta_d = pureExponential.n[k]*delta(pureExponential.dIndex[k], d);
+        const double pow_delta_c = delta(pureExponential.cIndex[k], c);
+        const double d_minus_c_pow_delta_c = d - c*pow_delta_c;
+
+        aroidelta_sum +=
+                n_pow_delta_d*d_minus_c_pow_delta_c*tauPowers.pureExponential[k]*exp(-start_rhored*c);
+        aroideltadelta_sum +=
+                n_pow_delta_d
+                *(
+                    d_minus_c_pow_delta_c*(d - 1 - c*pow_delta_c) - pow2(c)*pow_delta_c
+                // this line contains an error when comparing to the
+                // expression in Table 7.7 in TM15 --
+                // (tau) should be replaced by
+                // pow(tau, t)
+                // but testing this leads to very bad results, so I'm
+                // not sure what is going on
+                )*tau*exp(-pow_delta_c);
+    }
+
+    aroidelta = aroidelta_sum*start_rhored_pow_minusOne;
+    aroideltadelta = aroideltadelta_sum*start_rhored_pow_minusTwo;
+
+    double arijdelta_sum = 0; // multiplied by delta^-1 after the sum
+    double arijdeltadelta_sum = 0; // multiplied by delta^-2 after the sum
+    const PolynomialTerms& binaryPolynomial = m_terms->binaryPolynomial;
+    for (std::size_t k = 0; k < binaryPolynomial.size(); k++)
+    {
+        const double d = binaryPolynomial.d[k];
+        const double term = binaryPolynomial.n[k]*delta(binaryPolynomial.dIndex[k], d)*tauPowers.binaryPolynomial[k];
+
+        arijdelta_sum += d*term;
+        arijdeltadelta_sum += d*(d - 1)*term;
+    }
+
+    arijdelta = arijdelta_sum*start_rhored_pow_minusOne;
+    arijdeltadelta = arijdeltadelta_sum*start_rhored_pow_minusTwo;
+
+    const BinaryExponentialTerms& binaryExponential = m_terms->binaryExponential;
+    for (std::size_t k = 0; k < binaryExponential.size(); k++)
+    {
+        const double d = binaryExponential.d[k];
+        const double eta = binaryExponential.eta[k];
+        const double delta_minus_epsilon = start_rhored - binaryExponential.epsilon[k];
+        const double term =
+                binaryExponential.n[k]*delta(binaryExponential.dIndex[k], d)*tauPowers.binaryExponential[k]
+                *exp(-eta*pow2(delta_minus_epsilon) - binaryExponential.beta[k]*(start_rhored - binaryExponential.gamma[k]));
+        const double HEI = d*start_rhored_pow_minusOne - 2*eta*delta_minus_epsilon - binaryExponential.beta[k];
+
+        arijdelta += term*HEI;
+        arijdeltadelta += term*(HEI*HEI - d*start_rhored_pow_minusTwo - 2*eta);
     }
 }
 
+GERG04::ResidualSums GERG04::evaluateResidualSums(
+        const double delta,
+        const double tau,
+        const double temperature,
+        const TauPowers& tauPowers) const
+{
+    const PowerLadder pow_delta(delta);
+    const double delta_pow_minusOne = 1.0/delta;
+    const double delta_pow_minusTwo = pow2(delta_pow_minusOne);
+    const double tau_pow_minusOne = 1.0/tau;
+    const double tau_pow_minusTwo = pow2(tau_pow_minusOne);
+
+    ResidualSums sums;
+
+    const PolynomialTerms& purePolynomial = m_terms->purePolynomial;
+    for (std::size_t k = 0; k < purePolynomial.size(); k++)
+    {
+        const double d = purePolynomial.d[k];
+        const double t = purePolynomial.t[k];
+        const double term = purePolynomial.n[k]*pow_delta(purePolynomial.dIndex[k], d)*tauPowers.purePolynomial[k];
+
+        sums.dzdTp += d*(d - 1)*term*delta_pow_minusOne;
+        sums.dzdTp2 -= d*(d + t - 1)*term*delta_pow_minusOne;
+        sums.dzdT_rho -= d*purePolynomial.tRho[k]*term*delta_pow_minusOne/temperature;
+        sums.ar1 += t*term*tau_pow_minusOne;
+        sums.ar2 += term;
+        sums.cv2 += t*(t - 1)*term*tau_pow_minusTwo;
+        sums.cp11 += d*t*term*delta_pow_minusOne*tau_pow_minusOne;
+        sums.cp111 += d*(d - 1)*term*delta_pow_minusTwo;
+    }
+
+    const PureExponentialTerms& pureExponential = m_terms->pureExponential;
+    for (std::size_t k = 0; k < pureExponential.size(); k++)
+    {
+        const double d = pureExponential.d[k];
+        const double c = pureExponential.c[k];
+        const double t = pureExponential.t[k];
+        const double pow_delta_c = pow_delta(pureExponential.cIndex[k], c);
+        const double c_pow_delta_c = c*pow_delta_c;
+        const double d_minus_c_pow_delta_c = d - c_pow_delta_c;
+        const double n_pow_delta_d_pow_tau_t = pureExponential.n[k]*pow_delta(pureExponential.dIndex[k], d)*tauPowers.pureExponential[k];
+        const double term = n_pow_delta_d_pow_tau_t*exp(-pow_delta_c);
+
+        sums.dzdTp +=
+                (d*(d - 1) - c_pow_delta_c*(d + c - 1) - c_pow_delta_c*d_minus_c_pow_delta_c)
+                *term*delta_pow_minusOne;
+        sums.dzdTp2 +=
+                (-d*(d + t - 1) + c_pow_delta_c*(d + c + t - 1) + c_pow_delta_c*d_minus_c_pow_delta_c)
+                *term*delta_pow_minusOne;
+        sums.dzdT_rho -=
+                t*d_minus_c_pow_delta_c*n_pow_delta_d_pow_tau_t*exp(-delta*c)
+                *delta_pow_minusOne/temperature;
+        sums.ar1 += t*term*tau_pow_minusOne;
+        sums.ar2 += term;
+        sums.cv2 += t*(t - 1)*term*tau_pow_minusTwo;
+        sums.cp11 += t*d_minus_c_pow_delta_c*term*delta_pow_minusOne*tau_pow_minusOne;
+        sums.cp111 +=
+                (d_minus_c_pow_delta_c*(d - 1 - c_pow_delta_c) - pow2(c)*pow_delta_c)
+                *term*delta_pow_minusTwo;
+    }
+
+    const PolynomialTerms& binaryPolynomial = m_terms->binaryPolynomial;
+    for (std::size_t k = 0; k < binaryPolynomial.size(); k++)
+    {
+        const double d = binaryPolynomial.d[k];
+        const double t = binaryPolynomial.t[k];
+        const double n_pow_delta_d = binaryPolynomial.n[k]*pow_delta(binaryPolynomial.dIndex[k], d);
+        const double term = n_pow_delta_d*tauPowers.binaryPolynomial[k];
+
+        sums.dzdTpij += d*(d - 1)*term*delta_pow_minusOne;
+        sums.dzdTpij2 -= d*(d + t - 1)*term*delta_pow_minusOne;
+        sums.dzdT_rho2 -= d*binaryPolynomial.tRho[k]*term*delta_pow_minusOne/temperature;
+        sums.ar11 += t*term*tau_pow_minusOne;
+        sums.ar22 += term;
+        sums.cv3 += t*(t - 1)*term*tau_pow_minusTwo;
+        sums.cp22 += d*t*n_pow_delta_d*delta_pow_minusOne; // without tau^t/tau, as it has always been evaluated
+        sums.cp222 += d*(d - 1)*term*delta_pow_minusTwo;
+    }
+
+    const BinaryExponentialTerms& binaryExponential = m_terms->binaryExponential;
+    for (std::size_t k = 0; k < binaryExponential.size(); k++)
+    {
+        const double d = binaryExponential.d[k];
+        const double t = binaryExponential.t[k];
+        const double eta = binaryExponential.eta[k];
+        const double epsilon = binaryExponential.epsilon[k];
+        const double delta_minus_epsilon = delta - epsilon;
+        const double term =
+                binaryExponential.n[k]*pow_delta(binaryExponential.dIndex[k], d)*tauPowers.binaryExponential[k]
+                *exp(-eta*pow2(delta_minus_epsilon) - binaryExponential.beta[k]*(delta - binaryExponential.gamma[k]));
+        const double HEI = d*delta_pow_minusOne - 2*eta*delta_minus_epsilon - binaryExponential.beta[k];
+
+        sums.dzdTpij += (d*(d - 1)*delta_pow_minusOne - 2*eta*(d + 1)*delta + 2*eta*d*epsilon)*term;
+        sums.dzdTpij2 += t*(-d*delta_pow_minusOne + 2*eta*delta - 2*eta*epsilon)*term;
+        sums.dzdT_rho2 -= t*term*HEI/temperature;
+        sums.ar11 += t*term*tau_pow_minusOne;
+        sums.ar22 += term;
+        sums.cv3 += t*(t - 1)*term*tau_pow_minusTwo;
+        sums.cp22 += t*term*HEI*tau_pow_minusOne;
+        sums.cp222 += term*(HEI*HEI - d*delta_pow_minusTwo - 2*eta);
+    }
+
+    return sums;
+}
+
 vec GERG04::evaluateAllProperties(const double pressure, const double temperature) const
+{
+    DensityState state; // no initial guess
+    return evaluateAllProperties(pressure, temperature, state);
+}
+
+vec GERG04::evaluateAllProperties(const double pressure, const double temperature, DensityState& state) const
+{
+    vec output(15);
+    evaluateAllPropertiesInto(pressure, temperature, state, output.memptr());
+
+    return output;
+}
+
+void GERG04::evaluateAllPropertiesInto(
+        const double pressure,
+        const double temperature,
+        DensityState& state,
+        double* output) const
 {
     // final alpha coefficient
     double value = 0;
@@ -390,130 +724,27 @@ vec GERG04::evaluateAllProperties(const double pressure, const double temperatur
     double aroideltadelta = 0;
     double arijdeltadelta = 0;
 
-    findDensity(pressure, temperature,
+    const double tred_temperature = tred/temperature;
+    TauPowers tauPowers;
+    evaluateTauPowers(tred_temperature, tauPowers);
+
+    findDensity(pressure, temperature, state.extrapolate(pressure, temperature), tauPowers,
                 value, aroidelta, arijdelta, aroideltadelta, arijdeltadelta // output parameters
                 );
 
     const double value_rhored = value*rhored;
-    const double tred_temperature = tred/temperature;
-    const double value_rhored_pow_minusOne = pow(value_rhored,-1);
-    const double value_rhored_pow_minusTwo = pow(value_rhored,-2);
-//    const double value_rhored_pow_plusOne = pow(value_rhored,+1);
-    const double value_rhored_pow_plusOne = value_rhored;
-    const double tred_temperatured_pow_minusOne = pow(tred_temperature,-1);
-    const double tred_temperatured_pow_minusTwo = pow(tred_temperature,-2);
-
-
-    // calculating partial derivatives
-    double dzdTp=0;
-    double dzdTp2=0;
-    double dzdTpij=0;
-    double dzdTpij2=0;
-    double dzdp=0;
-    double dzdT_rho=0;
-    double dzdT_rho2=0;
-    for (uword i : m_indices)
-    {
-        for (uword k = 0; k < 24; k++)
-        {
-            const double pow_value_rhored_minusOne = pow(value_rhored, doipol(i,k))*value_rhored_pow_minusOne;
-            const double pow_tred_temperature_toipol = pow(tred_temperature, toipol(i,k));
-            const double pow_value_rhored_doiexp_minusOne = pow(value_rhored, doiexp(i,k))*value_rhored_pow_minusOne;
-            const double pow_tred_temperature_toiexp = pow(tred_temperature, toiexp(i,k));
-            const double pow_value_rhored_coiexp = pow(value_rhored, coiexp(i,k));
-            const double pow_value_rhored_doiexp_coiexp = pow(value_rhored, doiexp(i,k)+coiexp(i,k)-1);
-
-            //dzdT terms
-            dzdTp=
-                    dzdTp+X(i)*(noipol(i,k)*doipol(i,k)*(doipol(i,k)-1)*pow_value_rhored_minusOne*pow_tred_temperature_toipol)+X(i)*noiexp(i,k)
-                    *(doiexp(i,k)-1)*pow_value_rhored_doiexp_minusOne*doiexp(i,k)*pow_tred_temperature_toiexp*exp(-pow_value_rhored_coiexp)
-                    -X(i)*noiexp(i,k)*coiexp(i,k)*(doiexp(i,k)+coiexp(i,k)-1)*pow_value_rhored_doiexp_coiexp*pow_tred_temperature_toiexp
-                    *exp(-pow_value_rhored_coiexp)-X(i)*noiexp(i,k)*pow_value_rhored_doiexp_minusOne*(doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)
-                    *pow_tred_temperature_toiexp*coiexp(i,k)*pow_value_rhored_coiexp*exp(-pow_value_rhored_coiexp);
-            //right hand side terms
-            dzdTp2=
-                    dzdTp2-X(i)*noipol(i,k)*doipol(i,k)*pow_value_rhored_minusOne*(doipol(i,k)+toipol(i,k)-1)*pow_tred_temperature_toipol-X(i)*noiexp(i,k)
-                    *doiexp(i,k)*(doiexp(i,k)+toiexp(i,k)-1)*pow_value_rhored_doiexp_minusOne*pow_tred_temperature_toiexp
-                    *exp(-pow_value_rhored_coiexp)+X(i)*noiexp(i,k)*coiexp(i,k)*(doiexp(i,k)+coiexp(i,k)+toiexp(i,k)-1)*pow_value_rhored_doiexp_coiexp
-                    *pow_tred_temperature_toiexp*(exp(-pow_value_rhored_coiexp))+X(i)*noiexp(i,k)*pow_value_rhored_doiexp_minusOne
-                    *(doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)*pow_tred_temperature_toiexp*coiexp(i,k)*pow_value_rhored_coiexp
-                    *exp(-pow_value_rhored_coiexp);
-            //dzdp terms
-            dzdp=
-                    dzdp+X(i)*noipol(i,k)*doipol(i,k)*(doipol(i,k)-1)*pow_value_rhored_minusOne*pow_tred_temperature_toipol+X(i)*noiexp(i,k)
-                    *(doiexp(i,k)-1)*pow_value_rhored_doiexp_minusOne*doiexp(i,k)*pow_tred_temperature_toiexp*exp(-pow_value_rhored_coiexp)
-                    -X(i)*noiexp(i,k)*coiexp(i,k)*(doiexp(i,k)+coiexp(i,k)-1)*pow_value_rhored_doiexp_coiexp*pow_tred_temperature_toiexp
-                    *exp(-pow_value_rhored_coiexp)-X(i)*noiexp(i,k)*pow_value_rhored_doiexp_coiexp
-                    *(doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)*pow_tred_temperature_toiexp*coiexp(i,k)*exp(-pow_value_rhored_coiexp);
-            //dzdT_rho terms
-            dzdT_rho=
-                    dzdT_rho+X(i)*(-noipol(i,k)*doipol(i,k)*toipol(i,k)*pow_value_rhored_minusOne*pow_tred_temperature_toipol)/temperature
-                    -X(i)*(noiexp(i,k)*toiexp(i,k)*pow_value_rhored_doiexp_minusOne*(doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)
-                           *pow_tred_temperature_toiexp/temperature*exp(-(value_rhored)*coiexp(i,k)));
-        }
-    }
 
-    const cube pow2_value_rhored_epijexp = (value_rhored - epijexp) % (value_rhored - epijexp);
-    const cube exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp_cube = exp(-nuijexp % pow2_value_rhored_epijexp - beijexp % (value_rhored - gaijexp));
-    for (uword i : m_firstIndices)
-    {
-        for (uword j : m_lastIndices)
-        {
-            const double XXFij = X(i)*X(j)*Fij(i,j);
-            for (uword k = 0; k < 20; k++)
-            {
-                const double pow_value_rhored_dijpol = pow(value_rhored, dijpol(i,j,k)-1);
-                const double pow_tred_temperature_dijpol = pow(tred_temperature, tijpol(i,j,k));
-                const double pow_tred_temperature_tijexp = pow(tred_temperature, tijexp(i,j,k));
-
-                const double pow_value_rhored_dijexp = pow(value_rhored, dijexp(i,j,k));
-                const double pow_value_rhored_dijexp_minusOne = pow_value_rhored_dijexp*value_rhored_pow_minusOne;
-                const double pow_value_rhored_dijexp_plusOne = pow_value_rhored_dijexp*value_rhored_pow_plusOne;
-//                double exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp = exp(-nuijexp(w,k,l)*pow2(value_rhored-epijexp(w,k,l))-beijexp(w,k,l)*(value_rhored-gaijexp(w,k,l)));
-
-                //dzdT_p terms
-                dzdTpij +=
-                        +XXFij
-                            *nijpol(i,j,k)*dijpol(i,j,k)*(dijpol(i,j,k)-1)*pow_value_rhored_dijpol*pow_tred_temperature_dijpol
-                        +XXFij
-                            *nijexp(i,j,k)*pow_value_rhored_dijexp_minusOne*(dijexp(i,j,k)-1)*pow_tred_temperature_tijexp*dijexp(i,j,k)
-                            *exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp_cube(i,j,k)
-                        -XXFij
-                            *2*nijexp(i,j,k)
-                            *nuijexp(i,j,k)*pow_value_rhored_dijexp_plusOne*(dijexp(i,j,k)+1)*pow_tred_temperature_tijexp
-                            *exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp_cube(i,j,k)
-                        +XXFij
-                            *2*nijexp(i,j,k)
-                            *nuijexp(i,j,k)*dijexp(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp*epijexp(i,j,k)
-                            *exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp_cube(i,j,k);
-                //right hand side terms
-                dzdTpij2 +=
-                        -XXFij
-                            *nijpol(i,j,k)*dijpol(i,j,k)*(dijpol(i,j,k)+tijpol(i,j,k)-1)*pow_value_rhored_dijpol
-                            *pow_tred_temperature_dijpol
-                        -XXFij
-                            *nijexp(i,j,k)*pow_value_rhored_dijexp_minusOne*tijexp(i,j,k)
-                            *pow_tred_temperature_tijexp*dijexp(i,j,k)
-                            *exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp_cube(i,j,k)
-                        +XXFij
-                            *2*nijexp(i,j,k)*nuijexp(i,j,k)*pow_value_rhored_dijexp_plusOne*tijexp(i,j,k)
-                            *pow_tred_temperature_tijexp
-                            *exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp_cube(i,j,k)
-                        -XXFij
-                            *2*nijexp(i,j,k)*nuijexp(i,j,k)*pow_value_rhored_dijexp*tijexp(i,j,k)*pow_tred_temperature_tijexp
-                            *epijexp(i,j,k)*exp_nijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp_cube(i,j,k);
-                //dzdT_rho terms;
-                dzdT_rho2 +=
-                        +XXFij
-                        *(
-                            -nijpol(i,j,k)*toipol(i,j)*dijpol(i,j,k)*pow_value_rhored_dijpol*pow_tred_temperature_dijpol/temperature-nijexp(i,j,k)
-                            *tijexp(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp/temperature
-                            *exp(-nuijexp(i,j,k)*pow2((value_rhored)-epijexp(i,j,k))-beijexp(i,j,k)*(value_rhored-gaijexp(i,j,k)))
-                            *(dijexp(i,j,k)/(value_rhored)-2*nuijexp(i,j,k)*(value_rhored-epijexp(i,j,k))-beijexp(i,j,k))
-                        );
-            }
-        }
-    }
+    // calculating partial derivatives, and the other sums over the residual
+    // terms
+    const ResidualSums sums = evaluateResidualSums(value_rhored, tred_temperature, temperature, tauPowers);
+    const double dzdTp = sums.dzdTp;
+    const double dzdTp2 = sums.dzdTp2;
+    const double dzdTpij = sums.dzdTpij;
+    const double dzdTpij2 = sums.dzdTpij2;
+    const double dzdp = sums.dzdTp; // the pure component sums of dZ/dp_T and dZ/dT_p are identical
+    const double dzdT_rho = sums.dzdT_rho;
+    const double dzdT_rho2 = sums.dzdT_rho2;
+
     double a01=0;
     double a0=0;
     double cv1=0;
@@ -559,118 +790,16 @@ vec GERG04::evaluateAllProperties(const double pressure, const double temperatur
                 );
     }
 
-    double ar1=0;
-    double ar2=0;
-    double cv2=0;
-    double cp11=0;
-    double cp111=0;
-    for (uword i : m_indices)
-    {
-        for (uword k = 0; k < 24; k++)
-        {
-            const double pow_value_rhored_doipol = pow(value_rhored, doipol(i,k));
-            const double pow_tred_temperature_toipol = pow(tred_temperature, toipol(i,k));
-            const double pow_value_rhored_doiexp = pow(value_rhored, doiexp(i,k));
-            const double pow_value_rhored_coiexp = pow(value_rhored, coiexp(i,k));
-            const double pow_tred_temperature_toiexp = pow(tred_temperature, toiexp(i,k));
-            ar1 +=
-                    X(i)
-                    *(
-                        noipol(i,k)*toipol(i,k)*pow_value_rhored_doipol*pow_tred_temperature_toipol*tred_temperatured_pow_minusOne
-                        +noiexp(i,k)*toiexp(i,k)*pow_value_rhored_doiexp*pow_tred_temperature_toiexp*tred_temperatured_pow_minusOne*exp(-pow_value_rhored_coiexp)
-                    );
-            ar2 +=
-                    X(i)
-                    *(
-                        noipol(i,k)*pow_value_rhored_doipol*pow_tred_temperature_toipol
-                        +noiexp(i,k)*pow_value_rhored_doiexp*pow_tred_temperature_toiexp*exp(-pow_value_rhored_coiexp)
-                    );
-            cv2 +=
-                    +X(i)
-                    *(
-                        noipol(i,k)*toipol(i,k)*(toipol(i,k)-1)*pow_value_rhored_doipol*pow_tred_temperature_toipol*tred_temperatured_pow_minusTwo
-                        +noiexp(i,k)*toiexp(i,k)*(toiexp(i,k)-1)*pow_value_rhored_doiexp*pow_tred_temperature_toiexp*tred_temperatured_pow_minusTwo
-                            *exp(-pow_value_rhored_coiexp)
-                    );
-            cp11 +=
-                    +X(i)
-                    *(
-                        noipol(i,k)*doipol(i,k)*toipol(i,k)*pow_value_rhored_doipol*value_rhored_pow_minusOne*pow_tred_temperature_toipol*tred_temperatured_pow_minusOne
-                        +noiexp(i,k)*toiexp(i,k)*pow_value_rhored_doiexp*value_rhored_pow_minusOne*(doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)
-                            *pow_tred_temperature_toiexp*tred_temperatured_pow_minusOne*exp(-pow_value_rhored_coiexp)
-                    );
-            cp111 +=
-                    +X(i)
-                    *(
-                        noipol(i,k)*doipol(i,k)*(doipol(i,k)-1)*pow_value_rhored_doipol*value_rhored_pow_minusTwo*pow_tred_temperature_toipol
-                        +noiexp(i,k)*pow_value_rhored_doiexp*value_rhored_pow_minusTwo
-                            *(
-                                (doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)*(doiexp(i,k)-1-coiexp(i,k)*pow_value_rhored_coiexp)
-                                -pow2(coiexp(i,k))*pow_value_rhored_coiexp
-                            )*pow_tred_temperature_toiexp*exp(-pow_value_rhored_coiexp)
-                    );
-        }
-    }
-
-    double ar11=0;
-    double ar22=0;
-    double cv3=0;
-    double cp22=0;
-    double cp222=0;
-    for (uword i : m_firstIndices)
-    {
-        for (uword j : m_lastIndices)
-        {
-            for (uword k = 0; k < 20; k++)
-            {
-                const double pow_value_rhored_dijpol = pow(value_rhored, dijpol(i,j,k));
-                const double pow_value_rhored_dijexp = pow(value_rhored, dijexp(i,j,k));
-
-                const double pow_tred_temperature_tijpol = pow(tred_temperature, tijpol(i,j,k));
-                const double pow_tred_temperature_tijexp = pow(tred_temperature, tijexp(i,j,k));
-                const double pow_tred_temperature_tijexp_minusOne = pow_tred_temperature_tijexp*tred_temperatured_pow_minusOne;
-
-                const double exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp = exp(-nuijexp(i,j,k)*pow2(value_rhored-epijexp(i,j,k))-beijexp(i,j,k)*(value_rhored-gaijexp(i,j,k)));
-                const double XiXjFij = X(i)*X(j)*Fij(i,j);
-
-                ar11 += XiXjFij*
-                        (
-                            nijpol_times_tijpol(i,j,k)*pow_value_rhored_dijpol*pow_tred_temperature_tijpol*tred_temperatured_pow_minusOne
-                            + nijexp_times_tijexp(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp_minusOne
-                            *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                        );
-                ar22 += XiXjFij*
-                        (
-                            nijpol(i,j,k)*pow_value_rhored_dijpol*pow_tred_temperature_tijpol
-                            +nijexp(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp
-                            *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                        );
-                cv3 += XiXjFij*
-                        (
-                            nijpol_times_tijpol_times_tijpol_minus_one(i,j,k)*pow_value_rhored_dijpol*pow_tred_temperature_tijpol*tred_temperatured_pow_minusTwo
-                            +nijexp_times_tijexp_times_tijexp_minus_one(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp*tred_temperatured_pow_minusTwo
-                            *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                        );
-                cp22 += XiXjFij*
-                        (
-                            +nijpol_times_dijpol_times_tijpol(i,j,k)*pow_value_rhored_dijpol*value_rhored_pow_minusOne
-                            +nijexp_times_tijexp(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp_minusOne
-                                *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                                *(dijexp(i,j,k)/(value_rhored)-2*nuijexp(i,j,k)*(value_rhored-epijexp(i,j,k))-beijexp(i,j,k))
-                        );
-                cp222 += XiXjFij*
-                        (
-                            +nijpol_times_dijpol_times_dijpol_minus_one(i,j,k)*pow_value_rhored_dijpol*value_rhored_pow_minusTwo*pow_tred_temperature_tijpol
-                            +nijexp(i,j,k)*pow_value_rhored_dijexp
-                                *pow_tred_temperature_tijexp
-                                *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                                *(pow2(dijexp(i,j,k)/(value_rhored)-2*nuijexp(i,j,k)*(value_rhored-epijexp(i,j,k))-beijexp(i,j,k))-dijexp(i,j,k)/pow2(value_rhored)-2*nuijexp(i,j,k))
-                        );
-            }
-        }
-    }
-
-    vec output = zeros<vec>(15);
+    const double ar1 = sums.ar1;
+    const double ar2 = sums.ar2;
+    const double cv2 = sums.cv2;
+    const double cp11 = sums.cp11;
+    const double cp111 = sums.cp111;
+    const double ar11 = sums.ar11;
+    const double ar22 = sums.ar22;
+    const double cv3 = sums.cv3;
+    const double cp22 = sums.cp22;
+    const double cp222 = sums.cp222;
 
     double adeltar = aroidelta + arijdelta;
     double rho = value;
@@ -680,49 +809,49 @@ vec GERG04::evaluateAllProperties(const double pressure, const double temperatur
     double ataur = ar1+ar11;
 
     //Z factor
-    output(0)=
+    output[0]=
             1+delta*adeltar;
     //dzdT_p
-    output(1)=
+    output[1]=
             (-delta*adeltar/temperature+delta*(dzdTp2+dzdTpij2)/temperature)
-            /(1+delta*adeltar/output(0)+delta*(dzdTp+dzdTpij)/output(0));
+            /(1+delta*adeltar/output[0]+delta*(dzdTp+dzdTpij)/output[0]);
     //dzdp_T
-    output(2)=
+    output[2]=
             (adeltar*delta/pressure+delta*dzdp/pressure)
-            /(1+delta*adeltar/output(0)+delta*dzdp/output(0));
+            /(1+delta*adeltar/output[0]+delta*dzdp/output[0]);
     //dzdpT_rho
-    output(3)=
+    output[3]=
             delta*(dzdT_rho+dzdT_rho2);
     //entropy s
     double ar = (ar2+ar22);
-    output(4)=
+    output[4]=
             Ra*(tau*(a01+ataur) - a0 - ar);
     //internal energy
-    output(5)=
+    output[5]=
             Ra*temperature*tau*(a01+ataur);
     //heat capacity constant volume cv
-    output(6)=
+    output[6]=
             -Ra*pow2(tau)*(cv1+cv2+cv3);
     //enthalpy
-    output(7)=
+    output[7]=
             Ra*temperature*(1 + tau*(a01 + ataur) + delta*adeltar);
     //heat capacity constant pressure cp
-    output(8)=
+    output[8]=
             -Ra*pow2(tau)*(cv1+cv2+cv3)
             +Ra*pow2(1+delta*adeltar-delta*tau*(cp11+cp22))
             /(1+2*delta*adeltar+pow2(delta)*(cp111+cp222));
     //gibbs free energi
-    output(9)=
+    output[9]=
             Ra*temperature*(1+a0+ar1+ar11+delta*adeltar); // THIS MIGHT BE WRONG, should be a^r, not a_tau^r (== ar1+ar11)
     //joule thomson coefficient
-    output(10)=
+    output[10]=
             -(1.0/(Ra*rho))*(delta*adeltar+pow2(delta)*(cp111+cp222)+delta*tau*(cp11+cp22))
             /(
                 pow2(1+delta*adeltar-delta*tau*(cp11+cp22))
                 -pow2(tau)*(cv1+cv2+cv3)*(1+2*delta*adeltar+pow2(delta)*(cp111+cp222))
             );
     //speed of sound
-    output(11)=
+    output[11]=
             sqrt(
                 Ra*temperature
                 *(
@@ -732,16 +861,16 @@ vec GERG04::evaluateAllProperties(const double pressure, const double temperatur
                 )
             );
     //isothermal throttling coefficient
-    output(12)=
+    output[12]=
             (
                 1-(1+delta*adeltar-delta*tau*(cp11+cp22))
                 /(1+2*delta*adeltar+pow2(delta)*(cp111+cp222))
             )/rho;
     //density
-    output(13)=
+    output[13]=
             rho;
     //isentropic exponent
-    output(14)=
+    output[14]=
             (1+2*delta*adeltar+pow2(delta)*(cp111+cp222))/(1+delta*adeltar)
             *(
                 1
@@ -749,7 +878,8 @@ vec GERG04::evaluateAllProperties(const double pressure, const double temperatur
                 /(pow2(tau)*(cv1+cv2+cv3)*(1+2*delta*adeltar+pow2(delta)*(cp111+cp222)))
             );
 
-    return output;
+    state.update(pressure, temperature, rho, output[0], output[2], output[1]);
+
 }
 
 double GERG04::findSpeedOfSound(const double temperature, const double density) const
@@ -767,14 +897,11 @@ double GERG04::findSpeedOfSound(const double temperature, const double density)
     double start_rhored_pow_minusOne = 1.0/start_rhored;
     double start_rhored_pow_minusTwo = 1.0/pow2(start_rhored);
 
-    const double value_rhored = value*rhored;
     const double tred_temperature = tred/temperature;
-    const double value_rhored_pow_minusOne = pow(value_rhored,-1);
-    const double value_rhored_pow_minusTwo = pow(value_rhored,-2);
-    const double tred_temperatured_pow_minusOne = pow(tred_temperature,-1);
-    const double tred_temperatured_pow_minusTwo = pow(tred_temperature,-2);
+    TauPowers tauPowers;
+    evaluateTauPowers(tred_temperature, tauPowers);
 
-    evaluateAlpha_roi_deltas(tred_temperature, start_rhored, start_rhored_pow_minusOne, start_rhored_pow_minusTwo, aroidelta, arijdelta, aroideltadelta, arijdeltadelta);
+    evaluateAlpha_roi_deltas(tred_temperature, start_rhored, start_rhored_pow_minusOne, start_rhored_pow_minusTwo, tauPowers, aroidelta, arijdelta, aroideltadelta, arijdeltadelta);
 
     double cv1=0;
     for (uword i : m_indices)
@@ -787,96 +914,13 @@ double GERG04::findSpeedOfSound(const double temperature, const double density)
                 );
     }
 
-    double cv2=0;
-    double cp11=0;
-    double cp111=0;
-    for (uword i : m_indices)
-    {
-        for (uword k = 0; k < 24; k++)
-        {
-            const double pow_value_rhored_doipol = pow(value_rhored, doipol(i,k));
-            const double pow_tred_temperature_toipol = pow(tred_temperature, toipol(i,k));
-            const double pow_value_rhored_doiexp = pow(value_rhored, doiexp(i,k));
-            const double pow_value_rhored_coiexp = pow(value_rhored, coiexp(i,k));
-            const double pow_tred_temperature_toiexp = pow(tred_temperature, toiexp(i,k));
-
-            cv2 +=
-                    +X(i)
-                    *(
-                        noipol(i,k)*toipol(i,k)*(toipol(i,k)-1)*pow_value_rhored_doipol*pow_tred_temperature_toipol*tred_temperatured_pow_minusTwo
-                        +noiexp(i,k)*toiexp(i,k)*(toiexp(i,k)-1)*pow_value_rhored_doiexp*pow_tred_temperature_toiexp*tred_temperatured_pow_minusTwo
-                            *exp(-pow_value_rhored_coiexp)
-                    );
-            cp11 +=
-                    +X(i)
-                    *(
-                        noipol(i,k)*doipol(i,k)*toipol(i,k)*pow_value_rhored_doipol*value_rhored_pow_minusOne*pow_tred_temperature_toipol*tred_temperatured_pow_minusOne
-                        +noiexp(i,k)*toiexp(i,k)*pow_value_rhored_doiexp*value_rhored_pow_minusOne*(doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)
-                            *pow_tred_temperature_toiexp*tred_temperatured_pow_minusOne*exp(-pow_value_rhored_coiexp)
-                    );
-            cp111 +=
-                    +X(i)
-                    *(
-                        noipol(i,k)*doipol(i,k)*(doipol(i,k)-1)*pow_value_rhored_doipol*value_rhored_pow_minusTwo*pow_tred_temperature_toipol
-                        +noiexp(i,k)*pow_value_rhored_doiexp*value_rhored_pow_minusTwo
-                            *(
-                                (doiexp(i,k)-coiexp(i,k)*pow_value_rhored_coiexp)*(doiexp(i,k)-1-coiexp(i,k)*pow_value_rhored_coiexp)
-                                -pow2(coiexp(i,k))*pow_value_rhored_coiexp
-                            )*pow_tred_temperature_toiexp*exp(-pow_value_rhored_coiexp)
-                    );
-        }
-    }
-
-    double ar22=0;
-    double cv3=0;
-    double cp22=0;
-    double cp222=0;
-    for (uword i : m_firstIndices)
-    {
-        for (uword j : m_lastIndices)
-        {
-            for (uword k = 0; k < 20; k++)
-            {
-                const double pow_value_rhored_dijpol = pow(value_rhored, dijpol(i,j,k));
-                const double pow_value_rhored_dijexp = pow(value_rhored, dijexp(i,j,k));
-
-                const double pow_tred_temperature_tijpol = pow(tred_temperature, tijpol(i,j,k));
-                const double pow_tred_temperature_tijexp = pow(tred_temperature, tijexp(i,j,k));
-                const double pow_tred_temperature_tijexp_minusOne = pow_tred_temperature_tijexp*tred_temperatured_pow_minusOne;
-
-                const double exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp = exp(-nuijexp(i,j,k)*pow2(value_rhored-epijexp(i,j,k))-beijexp(i,j,k)*(value_rhored-gaijexp(i,j,k)));
-                const double XiXjFij = X(i)*X(j)*Fij(i,j);
-
-                ar22 += XiXjFij*
-                        (
-                            nijpol(i,j,k)*pow_value_rhored_dijpol*pow_tred_temperature_tijpol
-                            +nijexp(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp
-                            *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                        );
-                cv3 += XiXjFij*
-                        (
-                            nijpol_times_tijpol_times_tijpol_minus_one(i,j,k)*pow_value_rhored_dijpol*pow_tred_temperature_tijpol*tred_temperatured_pow_minusTwo
-                            +nijexp_times_tijexp_times_tijexp_minus_one(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp*tred_temperatured_pow_minusTwo
-                            *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                        );
-                cp22 += XiXjFij*
-                        (
-                            +nijpol_times_dijpol_times_tijpol(i,j,k)*pow_value_rhored_dijpol*value_rhored_pow_minusOne
-                            +nijexp_times_tijexp(i,j,k)*pow_value_rhored_dijexp*pow_tred_temperature_tijexp_minusOne
-                                *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                                *(dijexp(i,j,k)/(value_rhored)-2*nuijexp(i,j,k)*(value_rhored-epijexp(i,j,k))-beijexp(i,j,k))
-                        );
-                cp222 += XiXjFij*
-                        (
-                            +nijpol_times_dijpol_times_dijpol_minus_one(i,j,k)*pow_value_rhored_dijpol*value_rhored_pow_minusTwo*pow_tred_temperature_tijpol
-                            +nijexp(i,j,k)*pow_value_rhored_dijexp
-                                *pow_tred_temperature_tijexp
-                                *exp_nuijexp_pow2_value_rhored_epijexp_beijexp_value_rhored_gaijexp
-                                *(pow2(dijexp(i,j,k)/(value_rhored)-2*nuijexp(i,j,k)*(value_rhored-epijexp(i,j,k))-beijexp(i,j,k))-dijexp(i,j,k)/pow2(value_rhored)-2*nuijexp(i,j,k))
-                        );
-            }
-        }
-    }
+    const ResidualSums sums = evaluateResidualSums(start_rhored, tred_temperature, temperature, tauPowers);
+    const double cv2 = sums.cv2;
+    const double cp11 = sums.cp11;
+    const double cp111 = sums.cp111;
+    const double cv3 = sums.cv3;
+    const double cp22 = sums.cp22;
+    const double cp222 = sums.cp222;
 
     double adeltar = aroidelta + arijdelta;
     double rho = value;
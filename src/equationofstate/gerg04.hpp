@@ -1,7 +1,11 @@
 #pragma once
 
+#include <array>
 #include <armadillo>
+#include <cmath>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include "equationofstate/equationofstatebase.hpp"
 
@@ -46,6 +50,25 @@ public:
      */
     virtual arma::vec evaluate(const double pressure, const double temperature) const override;
 
+    /*!
+     * \brief Evaluate the GERG 2004 equation of state, with the initial guess
+     * for the density extrapolated from state.
+     * \see EquationOfStateBase::evaluate(const double, const double, DensityState&) const
+     */
+    virtual arma::vec evaluate(const double pressure, const double temperature, DensityState& state) const override;
+
+    /*!
+     * \brief Evaluate the GERG 2004 equation of state at several states,
+     * writing directly into output.
+     * \see EquationOfStateBase::evaluateBatch()
+     */
+    virtual void evaluateBatch(
+            const arma::vec& pressure,
+            const arma::vec& temperature,
+            const arma::mat& composition,
+            arma::mat& output,
+            std::vector<DensityState>& densityStates) override;
+
     /*!
      * \brief Evaluate all available gas properties at a given pressure and temperature.
      *
@@ -79,6 +102,16 @@ public:
      */
     arma::vec evaluateAllProperties(const double pressure, const double temperature) const;
 
+    /*!
+     * \brief Evaluate all available gas properties, with the initial guess
+     * for the density extrapolated from state.
+     * \param pressure Gas pressure [Pa].
+     * \param temperature Gas temperature [K].
+     * \param state Last converged density, updated with the new density.
+     * \return See evaluateAllProperties(const double, const double) const
+     */
+    arma::vec evaluateAllProperties(const double pressure, const double temperature, DensityState& state) const;
+
     /*!
      * \brief Calculate compressibility Z at given pressure and temperature.
      * \param pressure Gas pressure [Pa].
@@ -132,7 +165,168 @@ public:
      */
     const arma::uvec& indicesOfNonZeroComponents() const { return m_indices; }
 
+    /*!
+     * \brief Powers \f$\delta^0, \delta^1, \ldots, \delta^{maxExponent}\f$,
+     * calculated by repeated multiplication.
+     *
+     * All exponents of \f$\delta\f$ in GERG-2004 are small integers, so the
+     * powers of each term are looked up here instead of calling std::pow.
+     * When the terms are collected, each exponent is classified by
+     * PowerLadder::index(), and exponents that are not small non-negative
+     * integers fall back to std::pow.
+     */
+    struct PowerLadder
+    {
+        static constexpr int maxExponent = 8; //!< Largest exponent looked up
+
+        //! Calculate the powers of x
+        explicit PowerLadder(const double x);
+
+        //! Index of exponent in the powers, or -1 if not an integer in [0, maxExponent]
+        static int index(const double exponent);
+
+        //! x^exponent, looked up if index >= 0 (see PowerLadder::index())
+        double operator()(const int index, const double exponent) const
+        {
+            return index >= 0 ? powers[index] : std::pow(x, exponent);
+        }
+
+        double x; //!< Base
+        double powers[maxExponent + 1]; //!< x^0, x^1, ..., x^maxExponent
+    };
+
 private:
+    //! Polynomial terms \f$n \delta^d \tau^t\f$ of the residual part of the
+    //! reduced Helmholtz energy, one element per term
+    struct PolynomialTerms
+    {
+        std::vector<double> n; //!< Coefficient, including the composition weight
+        std::vector<double> d; //!< Exponent of \f$\delta\f$
+        std::vector<int> dIndex; //!< Index of d in the powers of \f$\delta\f$ (see GERG04::PowerLadder)
+        std::vector<double> t; //!< Exponent of \f$\tau\f$
+
+        /*!
+         * Used instead of t in \f$\frac{\partial Z}{\partial T}|_\rho\f$.
+         * This is t for the pure components, but \f$t_{oi,j}\f$ (indexed by
+         * the component pair) for the binary mixtures, which is how it has
+         * always been evaluated, although TM15 uses \f$t_{ij,k}\f$.
+         */
+        std::vector<double> tRho;
+
+        //! Add a term
+        void add(const double n, const double d, const double t, const double tRho);
+
+        //! Number of terms
+        std::size_t size() const { return n.size(); }
+    };
+
+    //! Exponential terms \f$n \delta^d \tau^t \exp(-\delta^c)\f$ of the pure
+    //! components, one element per term
+    struct PureExponentialTerms
+    {
+        std::vector<double> n; //!< Coefficient, including the composition weight
+        std::vector<double> d; //!< Exponent of \f$\delta\f$
+        std::vector<int> dIndex; //!< Index of d in the powers of \f$\delta\f$ (see GERG04::PowerLadder)
+        std::vector<double> c; //!< Exponent of \f$\delta\f$ in the exponential
+        std::vector<int> cIndex; //!< Index of c in the powers of \f$\delta\f$ (see GERG04::PowerLadder)
+        std::vector<double> t; //!< Exponent of \f$\tau\f$
+
+        //! Add a term
+        void add(const double n, const double d, const double c, const double t);
+
+        //! Number of terms
+        std::size_t size() const { return n.size(); }
+    };
+
+    //! Exponential terms \f$n \delta^d \tau^t \exp(-\eta (\delta - \varepsilon)^2 - \beta (\delta - \gamma))\f$
+    //! of the binary mixtures, one element per term
+    struct BinaryExponentialTerms
+    {
+        std::vector<double> n; //!< Coefficient, including the composition weight
+        std::vector<double> d; //!< Exponent of \f$\delta\f$
+        std::vector<int> dIndex; //!< Index of d in the powers of \f$\delta\f$ (see GERG04::PowerLadder)
+        std::vector<double> t; //!< Exponent of \f$\tau\f$
+        std::vector<double> eta; //!< \f$\eta\f$
+        std::vector<double> epsilon; //!< \f$\varepsilon\f$
+        std::vector<double> beta; //!< \f$\beta\f$
+        std::vector<double> gamma; //!< \f$\gamma\f$
+
+        //! Add a term
+        void add(const double n, const double d, const double t, const double eta, const double epsilon, const double beta, const double gamma);
+
+        //! Number of terms
+        std::size_t size() const { return n.size(); }
+    };
+
+    /*!
+     * \brief The terms of the residual part of the reduced Helmholtz energy
+     * for the current composition.
+     *
+     * Only the terms with non-zero coefficients of the non-zero components,
+     * and of the pairs of non-zero components with non-zero \f$F_{ij}\f$, are
+     * included, and the coefficients include the composition weights
+     * \f$x_i\f$ and \f$x_i x_j F_{ij}\f$. Each sum over the terms is then
+     * a single loop over contiguous arrays, instead of nested loops over
+     * components and coefficient tables that are mostly zero.
+     *
+     * The loops over the terms are plain scalar C++. There are no SIMD
+     * (AVX2/AVX-512) kernels and no runtime dispatch. Each exponential term
+     * calls std::exp, and the non-integer powers call std::pow, so results
+     * do not depend on the instruction set. The arrays have the layout a
+     * vector kernel would need, but no such kernel exists.
+     */
+    struct ResidualTerms
+    {
+        PolynomialTerms purePolynomial; //!< Polynomial terms of \f$\alpha^r_{oi}\f$
+        PureExponentialTerms pureExponential; //!< Exponential terms of \f$\alpha^r_{oi}\f$
+        PolynomialTerms binaryPolynomial; //!< Polynomial terms of \f$\alpha^r_{ij}\f$
+        BinaryExponentialTerms binaryExponential; //!< Exponential terms of \f$\alpha^r_{ij}\f$
+    };
+
+    /*!
+     * \brief Powers \f$\tau^t\f$ of each residual term, one array per kind
+     * of term in GERG04::ResidualTerms.
+     *
+     * These only depend on temperature, so they are calculated once per
+     * evaluation, instead of in each iteration of findDensity(). The arrays
+     * are sized for the terms of all components, so they live on the stack
+     * instead of being allocated in each evaluation. Only the first
+     * ResidualTerms::purePolynomial.size() (etc.) elements are used.
+     */
+    struct TauPowers
+    {
+        static constexpr std::size_t maxPurePolynomial = 58; //!< Pure polynomial terms of all components
+        static constexpr std::size_t maxPureExponential = 108; //!< Pure exponential terms of all components
+        static constexpr std::size_t maxBinaryPolynomial = 97; //!< Binary polynomial terms of all pairs with non-zero \f$F_{ij}\f$
+        static constexpr std::size_t maxBinaryExponential = 31; //!< Binary exponential terms of all pairs with non-zero \f$F_{ij}\f$
+
+        std::array<double, maxPurePolynomial> purePolynomial; //!< \f$\tau^t\f$ of ResidualTerms::purePolynomial
+        std::array<double, maxPureExponential> pureExponential; //!< \f$\tau^t\f$ of ResidualTerms::pureExponential
+        std::array<double, maxBinaryPolynomial> binaryPolynomial; //!< \f$\tau^t\f$ of ResidualTerms::binaryPolynomial
+        std::array<double, maxBinaryExponential> binaryExponential; //!< \f$\tau^t\f$ of ResidualTerms::binaryExponential
+    };
+
+    /*!
+     * \brief Calculate the powers of tau of the residual terms for the current
+     * composition.
+     * \param tau Inverse reduced mixture temperature.
+     * \param tauPowers Output argument -- the powers.
+     */
+    void evaluateTauPowers(const double tau, TauPowers& tauPowers) const;
+
+    /*!
+     * \brief Evaluate all available gas properties, writing the 15 values
+     * returned by evaluateAllProperties() to output[0], ..., output[14].
+     *
+     * This lets evaluate() and evaluateBatch() use scratch space on the
+     * stack, instead of allocating a vector for each state.
+     */
+    void evaluateAllPropertiesInto(
+            const double pressure,
+            const double temperature,
+            DensityState& state,
+            double* output) const;
+
     /*!
      * \brief Internal (private) function used in the process of evaluating the GERG 2004 equations.
      *
@@ -141,6 +335,10 @@ private:
      *
      * \param pressure Gas pressure [P].
      * \param temperature Gas Temperature [K].
+     * \param initialDensity Initial guess for the density [kg/m3]. The
+     * density of an ideal gas is used if 0.
+     * \param tauPowers Powers of the inverse reduced temperature, see
+     * evaluateTauPowers().
      * \param density Gas density [kg/m3].
      * \param aroidelta Output argument - left sum in eq. (7.21b) in TM15 (also appears in other equations).
      * \param arijdelta Output argument - the right (double) sum in eq. (7.21b) in TM15 (also appears in other equations).
@@ -151,6 +349,8 @@ private:
     double findDensity(
             const double pressure,
             const double temperature,
+            const double initialDensity,
+            const TauPowers& tauPowers,
             double& density, // output
             double& aroidelta, // output
             double& arijdelta, // output
@@ -164,6 +364,7 @@ private:
      * \param start_rhored Reduced mixture density.
      * \param start_rhored_pow_minusOne pow(reduced mixture density, -1)
      * \param start_rhored_pow_minusTwo pow(reduced mixture density, -2)
+     * \param tauPowers Powers of tred_temperature, see evaluateTauPowers().
      * \param aroidelta Output argument -- left sum in eq. (7.21b) in TM15 (also appears in other equations).
      * \param arijdelta Output argument -- the right (double) sum in eq. (7.21b) in TM15 (also appears in other equations).
      * \param aroideltadelta Output argument -- the left sum in eq. (7.21c) in TM15 (also appears in other equations).
@@ -174,12 +375,51 @@ private:
             const double start_rhored,
             const double start_rhored_pow_minusOne,
             const double start_rhored_pow_minusTwo,
+            const TauPowers& tauPowers,
             double& aroidelta, // output
             double& arijdelta, // output
             double& aroideltadelta, // output
             double& arijdeltadelta // output
             ) const;
 
+    //! Sums over the residual terms used by evaluateAllProperties() and
+    //! findSpeedOfSound(), named as in evaluateAllProperties()
+    struct ResidualSums
+    {
+        double dzdTp = 0; //!< Pure component part of the denominator of \f$\frac{\partial Z}{\partial T}|_p\f$
+        double dzdTp2 = 0; //!< Pure component part of the numerator of \f$\frac{\partial Z}{\partial T}|_p\f$
+        double dzdT_rho = 0; //!< Pure component part of \f$\frac{\partial Z}{\partial T}|_\rho\f$
+        double dzdTpij = 0; //!< Binary mixture part of the denominator of \f$\frac{\partial Z}{\partial T}|_p\f$
+        double dzdTpij2 = 0; //!< Binary mixture part of the numerator of \f$\frac{\partial Z}{\partial T}|_p\f$
+        double dzdT_rho2 = 0; //!< Binary mixture part of \f$\frac{\partial Z}{\partial T}|_\rho\f$
+        double ar1 = 0; //!< \f$\alpha^r_{oi,\tau}\f$
+        double ar2 = 0; //!< \f$\alpha^r_{oi}\f$
+        double cv2 = 0; //!< \f$\alpha^r_{oi,\tau\tau}\f$
+        double cp11 = 0; //!< \f$\alpha^r_{oi,\delta\tau}\f$
+        double cp111 = 0; //!< \f$\alpha^r_{oi,\delta\delta}\f$
+        double ar11 = 0; //!< \f$\alpha^r_{ij,\tau}\f$
+        double ar22 = 0; //!< \f$\alpha^r_{ij}\f$
+        double cv3 = 0; //!< \f$\alpha^r_{ij,\tau\tau}\f$
+        double cp22 = 0; //!< \f$\alpha^r_{ij,\delta\tau}\f$
+        double cp222 = 0; //!< \f$\alpha^r_{ij,\delta\delta}\f$
+    };
+
+    /*!
+     * \brief Evaluate the sums over the residual terms at the given reduced
+     * density and inverse reduced temperature, with a single pass over each
+     * kind of term in GERG04::m_terms.
+     * \param delta Reduced mixture density.
+     * \param tau Inverse reduced mixture temperature.
+     * \param temperature Gas temperature [K].
+     * \param tauPowers Powers of tau, see evaluateTauPowers().
+     * \return The sums.
+     */
+    ResidualSums evaluateResidualSums(
+            const double delta,
+            const double tau,
+            const double temperature,
+            const TauPowers& tauPowers) const;
+
     /*!
      * \brief Internal (private) function that updates the non-zero components.
      *
@@ -193,11 +433,37 @@ private:
      * \brief Set the pressure and temperature independent coefficients.
      *
      * This calculates and sets the pressure and temperature independent factors
-     * GERG04::rhored and GERG04::tred, which are stored for efficient'
-     * computation.
+     * GERG04::rhored and GERG04::tred, and the residual terms
+     * GERG04::m_terms, which are stored for efficient computation.
      */
     void calculateCoefficients();
 
+    //! The reducing functions set by calculateCoefficients()
+    struct ReducingFunctions
+    {
+        double rhored; //!< See GERG04::rhored
+        double tred; //!< See GERG04::tred
+    };
+
+    /*!
+     * \brief Calculate the reducing functions for the current composition.
+     *
+     * calculateCoefficients() calls this via MixtureCache, so the result is
+     * shared by all instances with the same composition.
+     */
+    ReducingFunctions calculateReducingFunctions() const;
+
+    /*!
+     * \brief Collect the residual terms for the current composition.
+     *
+     * calculateCoefficients() calls this via MixtureCache, so the result is
+     * shared by all instances with the same composition.
+     */
+    ResidualTerms calculateResidualTerms() const;
+
+    //! Residual terms for the current composition, set by calculateCoefficients()
+    std::shared_ptr<const ResidualTerms> m_terms;
+
     const arma::uword N = 10; //!< Number of components
     arma::vec X; //!< Composition in order CH4, N2, CO2, C2H6, C3H8, nC4H10, iC4H10, nC5H12, iC5H12, nC6H14
 
@@ -234,50 +500,6 @@ private:
      */
     arma::uvec m_lastIndices;
 
-    static arma::mat betav; //!< \f$\beta_{v, ij}\f$ density interaction coefficient, from table A3.8
-    static arma::mat betat; //!< \f$\beta_{T, ij}\f$ temperature coefficient, from table A3.8
-    static arma::mat gammav; //!< \f$\gamma_{v, ij}\f$ density interaction coefficient, from table A3.8
-    static arma::mat gammat; //!< \f$\gamma_{T, ij}\f$ temperature interaction coefficient, from table A3.8
-
-    // Kpol coefficients - used in the first sum in alpha^r_{oi} and derivatives
-    static arma::mat noipol; //!< \f$n_{oi, k}\f$, from Table A3.2 in TM15, used in the first sum of alpha^r_{oi}
-    static arma::mat doipol; //!< \f$d_{oi, k}\f$, from Table A3.2 in TM15, used in the first sum of alpha^r_{oi}
-    static arma::mat toipol; //!< \f$t_{oi, k}\f$, from Table A3.2 in TM15, used in the first sum of alpha^r_{oi}
-
-    // Kexp coefficient - used in the second sum in alpha^r_{oi} and derivatives
-    static arma::mat noiexp; //!< \f$n_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}
-    static arma::mat doiexp; //!< \f$d_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}
-    static arma::mat coiexp; //!< \f$c_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}
-    static arma::mat toiexp; //!< \f$t_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}
-
-    static arma::mat Fij; //!< \f$F_{ij}\f$ interaction coefficient
-
-    static arma::cube nijpol; //!< \f$n_{ij, k}\f$, from Table A3.7 in TM15, used in the first sum of alpha^r_{ij}
-    static arma::cube dijpol; //!< \f$d_{ij, k}\f$, from Table A3.7 in TM15, used in the first sum of alpha^r_{ij}
-    static arma::cube tijpol; //!< \f$t_{ij, k}\f$, from Table A3.7 in TM15, used in the first sum of alpha^r_{ij}
-
-    static arma::cube nijexp; //!< \f$n_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}
-    static arma::cube dijexp; //!< \f$d_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}
-    static arma::cube tijexp; //!< \f$t_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}
-
-    static arma::cube nuijexp; //!< \f$\nu_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}
-    static arma::cube epijexp; //!< \f$\epsilon_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}
-    static arma::cube beijexp; //!< \f$\beta_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}
-    static arma::cube gaijexp; //!< \f$\gamma_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}
-
-    // other coefficients
-    static arma::mat noik; //!< \f$n^o_{oi, k}\f$, from Table A3.1 in TM15, used in alpha^o_{oi}
-    static arma::mat voik; //!< \f$n^o_{oi, k}\f$, from Table A3.1 in TM15, used in alpha^o_{oi}
-
-    // constant terms
-    static arma::cube nijpol_times_tijpol; //!< \f$n_{ij, k} \times t_{ij, k}\f$ (GERG04::nijpol x GERG04::tijpol)
-    static arma::cube nijpol_times_tijpol_times_tijpol_minus_one; //!<  \f$(n_{ij, k} \times t_{ij, k}) \times (t_{ij, k} - 1)\f$ ((GERG04::nijpol x GERG04::tijpol) x (GERG04::tijpol - 1.0))
-    static arma::cube nijexp_times_tijexp; //!< \f$n_{ij, k} \times t_{ij, k}\f$ (GERG04::nijexp x GERG04::tijexp)
-    static arma::cube nijexp_times_tijexp_times_tijexp_minus_one; //!< \f$(n_{ij, k} \times t_{ij, k}) \times (t_{ij, k} - 1)\f$ ((GERG04::nijpol x GERG04::tijpol) x (GERG04::tijpol - 1.0))
-    static arma::cube nijpol_times_dijpol; //!< \f$n_{ij, k} \times d_{ij, k}\f$ (GERG04::nijpol x GERG04::dijpol)
-    static arma::cube nijpol_times_dijpol_times_tijpol; //!< \f$n_{ij, k} \times d_{ij, k} \times t_{ij, k}\f$ (GERG04::nijpol x GERG04::dijpol x GERG04::tijpol)
-    static arma::cube nijpol_times_dijpol_times_dijpol_minus_one; //!< \f$n_{ij, k} \times d_{ij, k} \times(d_{ij, k} - 1) \f$ (GERG04::nijpol x GERG04::dijpol x (GERG04::dijpol - 1.0))
-
     double rhored; //!< Inverse reducing function for mixture density \f$1/\rho_r(\bar x)\f$.
     double tred; //!< Reducing function for mixture temperature \f$T_r(\bar x)\f$.
 
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <armadillo>
+
+/*!
+ * \brief Process-wide cache of composition dependent mixture coefficients,
+ * shared between all equation of state instances.
+ *
+ * The mixture coefficients of BWRS and GERG04 only depend on the gas
+ * composition (and the parameter set used), and with batch tracking most grid
+ * points share one of a handful of compositions. Instead of each instance
+ * calculating the same coefficients, they are calculated once, stored as an
+ * immutable object, and shared via std::shared_ptr.
+ *
+ * The key is the composition quantized to MixtureCache::quantum, together
+ * with a tag identifying the parameter set. Compositions that only differ by
+ * round-off share coefficients.
+ *
+ * All functions are thread safe.
+ *
+ * \tparam Coefficients Type holding the mixture coefficients
+ */
+template <typename Coefficients>
+class MixtureCache
+{
+public:
+    //! Resolution of the quantized composition key
+    static constexpr double quantum = 1e-12;
+
+    //! Max number of entries before the cache is cleared, to bound memory use
+    //! with continuously varying compositions
+    static constexpr std::size_t maxSize = 4096;
+
+    /*!
+     * \brief Get the coefficients for the given composition, calculating and
+     * storing them if not already cached.
+     * \param tag Identifies the parameter set the coefficients are calculated
+     * from
+     * \param composition Gas composition
+     * \param calculate Function that calculates the coefficients from the
+     * composition, called without holding the lock
+     * \return Shared, immutable coefficients
+     */
+    template <typename Function>
+    static std::shared_ptr<const Coefficients> get(
+            const std::string& tag,
+            const arma::vec& composition,
+            Function calculate)
+    {
+        Key key(tag, {});
+        for (arma::uword i = 0; i < key.second.size() && i < composition.n_elem; i++)
+        {
+            key.second[i] = std::llround(composition[i]/quantum);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex());
+            const auto it = entries().find(key);
+            if (it != entries().end())
+            {
+                return it->second;
+            }
+        }
+
+        std::shared_ptr<const Coefficients> coefficients =
+                std::make_shared<const Coefficients>(calculate(composition));
+
+        std::lock_guard<std::mutex> lock(mutex());
+        if (entries().size() >= maxSize)
+        {
+            entries().clear(); // instances keep their coefficients alive
+        }
+
+        // if another thread got here first, use its coefficients instead
+        return entries().emplace(std::move(key), std::move(coefficients)).first->second;
+    }
+
+    //! Number of cached coefficient sets
+    static std::size_t size()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        return entries().size();
+    }
+
+    //! Remove all cached coefficient sets
+    static void clear()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        entries().clear();
+    }
+
+private:
+    //! Parameter set tag and quantized composition
+    using Key = std::pair<std::string, std::array<long long, 10>>;
+
+    static std::map<Key, std::shared_ptr<const Coefficients>>& entries()
+    {
+        static std::map<Key, std::shared_ptr<const Coefficients>> entries;
+        return entries;
+    }
+
+    static std::mutex& mutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+};
@@ -0,0 +1,454 @@
+#include "equationofstate/tabulatedeos.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#include "equationofstate/bwrs.hpp"
+#include "equationofstate/gerg04.hpp"
+#include "equationofstate/mixturecache.hpp"
+
+using arma::vec;
+using arma::mat;
+using arma::uword;
+using std::string;
+
+//! Node values of a table. Node (i, j) (pressure index i, temperature index
+//! j) is column i + pressurePoints*j of nodes, and contains the value, the
+//! pressure derivative, the temperature derivative and the mixed derivative
+//! of each property, in that order. The derivatives are scaled by the grid
+//! spacing, i.e. they are derivatives with respect to the grid indices.
+struct TabulatedEOS::Table
+{
+    mat nodes; //!< 24 values per node (four per property)
+    vec error; //!< See TabulatedEOS::errorEstimate()
+};
+
+namespace
+{
+
+std::unique_ptr<EquationOfStateBase> makeModel(const string& model, const vec& composition)
+{
+    if (model == "BWRS")
+    {
+        return std::make_unique<BWRS>(composition);
+    }
+    else if (model == "GERG04")
+    {
+        return std::make_unique<GERG04>(composition);
+    }
+    else
+    {
+        std::string what = "invalid tabulated EOS type \"" + model + "\"";
+        throw std::invalid_argument(what);
+    }
+}
+
+//! Second order finite difference approximation of the derivative with respect
+//! to the index, at element i of the n elements values[0], values[stride], ...
+double difference(const double* values, const uword i, const uword n, const uword stride)
+{
+    if (i == 0)
+        return (-3*values[0] + 4*values[stride] - values[2*stride])/2;
+    if (i == n - 1)
+        return (3*values[(n - 1)*stride] - 4*values[(n - 2)*stride] + values[(n - 3)*stride])/2;
+
+    return (values[(i + 1)*stride] - values[(i - 1)*stride])/2;
+}
+
+//! Bicubic Hermite interpolation of the six properties in nodes (see
+//! TabulatedEOS::Table), at a state inside the grid.
+void interpolate(
+        const mat& nodes,
+        const TabulatedEOS::Grid& grid,
+        const double pressureStep,
+        const double temperatureStep,
+        const double pressure,
+        const double temperature,
+        double* output,
+        const uword stride)
+{
+    // cell (i, j), and position (s, t) within the cell in [0, 1]
+    const double x = (pressure - grid.minPressure)/pressureStep;
+    const double y = (temperature - grid.minTemperature)/temperatureStep;
+    const uword i = std::min(uword(x), grid.pressurePoints - 2);
+    const uword j = std::min(uword(y), grid.temperaturePoints - 2);
+    const double s = x - i;
+    const double t = y - j;
+
+    // Hermite basis functions for the values at the first and second node,
+    // and the derivatives at the first and second node
+    const double a0 = (1 + 2*s)*(1 - s)*(1 - s);
+    const double a1 = s*s*(3 - 2*s);
+    const double a2 = s*(1 - s)*(1 - s);
+    const double a3 = s*s*(s - 1);
+
+    const double b0 = (1 + 2*t)*(1 - t)*(1 - t);
+    const double b1 = t*t*(3 - 2*t);
+    const double b2 = t*(1 - t)*(1 - t);
+    const double b3 = t*t*(t - 1);
+
+    const uword n = grid.pressurePoints;
+    const double* c00 = nodes.colptr(i + n*j);
+    const double* c10 = nodes.colptr(i + 1 + n*j);
+    const double* c01 = nodes.colptr(i + n*(j + 1));
+    const double* c11 = nodes.colptr(i + 1 + n*(j + 1));
+
+    for (uword k = 0; k < 6; k++)
+    {
+        const uword r = 4*k;
+        output[k*stride] =
+                b0*(a0*c00[r] + a1*c10[r] + a2*c00[r + 1] + a3*c10[r + 1])
+                + b1*(a0*c01[r] + a1*c11[r] + a2*c01[r + 1] + a3*c11[r + 1])
+                + b2*(a0*c00[r + 2] + a1*c10[r + 2] + a2*c00[r + 3] + a3*c10[r + 3])
+                + b3*(a0*c01[r + 2] + a1*c11[r + 2] + a2*c01[r + 3] + a3*c11[r + 3]);
+    }
+}
+
+std::atomic<uword> s_buildLimit(16); //!< See TabulatedEOS::tableBuildLimit()
+std::atomic<uword> s_builtTables(0); //!< See TabulatedEOS::builtTables()
+std::atomic<bool> s_warnedAboutLimit(false); //!< If the build limit warning has been printed
+
+//! Count a table about to be built, unless the build limit is reached
+bool reserveTableBuild()
+{
+    uword built = s_builtTables.load();
+    do
+    {
+        if (built >= s_buildLimit.load())
+        {
+            if (!s_warnedAboutLimit.exchange(true))
+            {
+                std::cout << "WARNING: TabulatedEOS: built " << built << " tables, which is the limit. "
+                          << "New compositions are evaluated with the full equation of state." << std::endl;
+            }
+            return false;
+        }
+    } while (!s_builtTables.compare_exchange_weak(built, built + 1));
+
+    return true;
+}
+
+} // end anonymous namespace
+
+TabulatedEOS::TabulatedEOS(
+        const string& model,
+        const vec& composition,
+        const Grid& grid,
+        const string& directory):
+    EquationOfStateBase(composition),
+    m_modelName(model),
+    m_model(makeModel(model, composition)),
+    m_grid(grid),
+    m_directory(directory)
+{
+    if (!(grid.minPressure < grid.maxPressure) || grid.pressurePoints < 3
+            || !(grid.minTemperature < grid.maxTemperature) || grid.temperaturePoints < 3)
+    {
+        throw std::invalid_argument("grid");
+    }
+
+    m_pressureStep = (grid.maxPressure - grid.minPressure)/(grid.pressurePoints - 1);
+    m_temperatureStep = (grid.maxTemperature - grid.minTemperature)/(grid.temperaturePoints - 1);
+
+    std::ostringstream tag;
+    tag << std::setprecision(17) << model << "-Table/"
+        << grid.minPressure << "/" << grid.maxPressure << "/" << grid.pressurePoints << "/"
+        << grid.minTemperature << "/" << grid.maxTemperature << "/" << grid.temperaturePoints;
+    m_cacheTag = tag.str();
+
+    setComposition(composition, true);
+}
+
+TabulatedEOS::~TabulatedEOS()
+{}
+
+vec TabulatedEOS::evaluate(const double pressure, const double temperature) const
+{
+    DensityState state; // no initial guess
+    return evaluate(pressure, temperature, state);
+}
+
+vec TabulatedEOS::evaluate(const double pressure, const double temperature, DensityState& state) const
+{
+    vec Z_factor(6);
+    evaluateInto(pressure, temperature, state, Z_factor.memptr(), 1);
+
+    return Z_factor;
+}
+
+void TabulatedEOS::evaluateBatch(
+        const vec& pressure,
+        const vec& temperature,
+        const arma::mat& composition,
+        arma::mat& output,
+        std::vector<DensityState>& densityStates)
+{
+    const uword n = prepareBatch(pressure, temperature, composition, output, densityStates);
+    for (uword i = 0; i < n; i++)
+    {
+        setBatchComposition(composition, i);
+        evaluateInto(pressure[i], temperature[i], batchDensityState(densityStates, i), output.colptr(0) + i, n);
+        output.at(i, 6) = m_molarMassOfMixture;
+    }
+}
+
+double TabulatedEOS::calculateCompressibility(const double pressure, const double temperature) const
+{
+    if (!contains(pressure, temperature))
+    {
+        return m_model->calculateCompressibility(pressure, temperature);
+    }
+
+    DensityState state; // not used inside the table
+    double output[6];
+    evaluateInto(pressure, temperature, state, output, 1);
+
+    return output[0];
+}
+
+bool TabulatedEOS::setComposition(const vec& composition, const bool force)
+{
+    if (!EquationOfStateBase::setComposition(composition, force))
+    {
+        return false; // composition not changed
+    }
+
+    m_model->setComposition(m_composition);
+    m_table = MixtureCache<Table>::get(
+            m_cacheTag,
+            m_composition,
+            [this](const vec& x) { return loadOrBuildTable(x); });
+
+    return true;
+}
+
+bool TabulatedEOS::contains(const double pressure, const double temperature) const
+{
+    return !m_table->nodes.is_empty()
+            && pressure >= m_grid.minPressure && pressure <= m_grid.maxPressure
+            && temperature >= m_grid.minTemperature && temperature <= m_grid.maxTemperature;
+}
+
+const vec& TabulatedEOS::errorEstimate() const
+{
+    return m_table->error;
+}
+
+void TabulatedEOS::clearTables()
+{
+    MixtureCache<Table>::clear();
+    s_builtTables = 0;
+    s_warnedAboutLimit = false;
+}
+
+void TabulatedEOS::setTableBuildLimit(const uword limit)
+{
+    s_buildLimit = limit;
+}
+
+uword TabulatedEOS::tableBuildLimit()
+{
+    return s_buildLimit;
+}
+
+uword TabulatedEOS::builtTables()
+{
+    return s_builtTables;
+}
+
+void TabulatedEOS::evaluateInto(
+        const double pressure,
+        const double temperature,
+        DensityState& state,
+        double* output,
+        const uword stride) const
+{
+    if (!contains(pressure, temperature))
+    {
+        const vec Z_factor = m_model->evaluate(pressure, temperature, state);
+        for (uword k = 0; k < 6; k++)
+            output[k*stride] = Z_factor(k);
+
+        return;
+    }
+
+    interpolate(m_table->nodes, m_grid, m_pressureStep, m_temperatureStep, pressure, temperature, output, stride);
+}
+
+TabulatedEOS::Table TabulatedEOS::loadOrBuildTable(const vec& composition) const
+{
+    if (m_directory.empty())
+    {
+        return reserveTableBuild() ? buildTable(composition) : Table();
+    }
+
+    const string fileName = tableFileName(composition);
+    const vec key = tableKey(composition);
+
+    // only use a saved table if it was made for exactly this grid and composition
+    arma::field<mat> fields;
+    if (std::filesystem::exists(fileName)
+            && fields.load(fileName, arma::arma_binary)
+            && fields.n_elem == 3
+            && fields(0).n_elem == key.n_elem
+            && std::equal(key.begin(), key.end(), fields(0).begin())
+            && fields(1).n_rows == 24
+            && fields(1).n_cols == m_grid.pressurePoints*m_grid.temperaturePoints
+            && fields(2).n_elem == 6)
+    {
+        return Table{fields(1), vec(fields(2))};
+    }
+
+    if (!reserveTableBuild())
+    {
+        return Table();
+    }
+
+    Table table = buildTable(composition);
+
+    std::filesystem::create_directories(m_directory);
+    fields.set_size(3);
+    fields(0) = key;
+    fields(1) = table.nodes;
+    fields(2) = table.error;
+
+    // write to a file of our own and rename it, so other threads building the
+    // same table never load a partially written file
+    const string tmpFileName = fileName + "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+    if (!fields.save(tmpFileName, arma::arma_binary))
+    {
+        throw std::runtime_error("Couldn't save file \"" + fileName + "\"");
+    }
+    std::filesystem::rename(tmpFileName, fileName);
+
+    return table;
+}
+
+TabulatedEOS::Table TabulatedEOS::buildTable(const vec& composition) const
+{
+    const uword nP = m_grid.pressurePoints;
+    const uword nT = m_grid.temperaturePoints;
+
+    // composition as a matrix with a single column
+    const mat x(composition);
+
+    // evaluate the underlying equation of state at all nodes
+    vec pressure(nP*nT);
+    vec temperature(nP*nT);
+    for (uword j = 0; j < nT; j++)
+    {
+        for (uword i = 0; i < nP; i++)
+        {
+            pressure[i + nP*j] = m_grid.minPressure + i*m_pressureStep;
+            temperature[i + nP*j] = m_grid.minTemperature + j*m_temperatureStep;
+        }
+    }
+
+    mat values;
+    m_model->evaluateBatch(pressure, temperature, x, values);
+
+    Table table;
+    table.nodes.set_size(24, nP*nT);
+    for (uword k = 0; k < 6; k++)
+    {
+        for (uword j = 0; j < nT; j++)
+        {
+            for (uword i = 0; i < nP; i++)
+            {
+                const uword c = i + nP*j;
+                table.nodes.at(4*k, c) = values.at(c, k);
+                if (k == 0)
+                {
+                    // exact derivatives of Z
+                    table.nodes.at(1, c) = values.at(c, 2)*m_pressureStep;
+                    table.nodes.at(2, c) = values.at(c, 1)*m_temperatureStep;
+                }
+                else
+                {
+                    table.nodes.at(4*k + 1, c) = difference(values.colptr(k) + nP*j, i, nP, 1);
+                    table.nodes.at(4*k + 2, c) = difference(values.colptr(k) + i, j, nT, nP);
+                }
+            }
+        }
+
+        // mixed derivative from the temperature difference of the pressure derivatives
+        for (uword j = 0; j < nT; j++)
+        {
+            for (uword i = 0; i < nP; i++)
+            {
+                table.nodes.at(4*k + 3, i + nP*j) = difference(table.nodes.colptr(i) + 4*k + 1, j, nT, 24*nP);
+            }
+        }
+    }
+
+    // compare to the underlying equation of state at the cell centres
+    const uword nCells = (nP - 1)*(nT - 1);
+    vec centrePressure(nCells);
+    vec centreTemperature(nCells);
+    for (uword j = 0; j < nT - 1; j++)
+    {
+        for (uword i = 0; i < nP - 1; i++)
+        {
+            centrePressure[i + (nP - 1)*j] = m_grid.minPressure + (i + 0.5)*m_pressureStep;
+            centreTemperature[i + (nP - 1)*j] = m_grid.minTemperature + (j + 0.5)*m_temperatureStep;
+        }
+    }
+
+    mat exact;
+    m_model->evaluateBatch(centrePressure, centreTemperature, x, exact);
+
+    table.error = arma::zeros<vec>(6);
+    double interpolated[6];
+    for (uword c = 0; c < nCells; c++)
+    {
+        interpolate(table.nodes, m_grid, m_pressureStep, m_temperatureStep,
+                    centrePressure[c], centreTemperature[c], interpolated, 1);
+        for (uword k = 0; k < 6; k++)
+            table.error[k] = std::max(table.error[k], std::abs(interpolated[k] - exact.at(c, k)));
+    }
+
+    for (uword k = 0; k < 6; k++)
+    {
+        const double scale = arma::abs(values.col(k)).max();
+        if (scale > 0)
+            table.error[k] /= scale;
+    }
+
+    return table;
+}
+
+string TabulatedEOS::tableFileName(const vec& composition) const
+{
+    const vec key = tableKey(composition);
+
+    std::ostringstream text;
+    text << std::setprecision(17) << m_modelName;
+    for (const double value : key)
+        text << "/" << value;
+
+    std::ostringstream name;
+    name << m_modelName << "-" << std::hex << std::hash<string>()(text.str()) << ".bin";
+
+    return (std::filesystem::path(m_directory) / name.str()).string();
+}
+
+vec TabulatedEOS::tableKey(const vec& composition) const
+{
+    vec key(6 + composition.n_elem);
+    key[0] = m_grid.minPressure;
+    key[1] = m_grid.maxPressure;
+    key[2] = m_grid.pressurePoints;
+    key[3] = m_grid.minTemperature;
+    key[4] = m_grid.maxTemperature;
+    key[5] = m_grid.temperaturePoints;
+    std::copy(composition.begin(), composition.end(), key.begin() + 6);
+
+    return key;
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <armadillo>
+
+#include "composition.hpp"
+#include "equationofstate/equationofstatebase.hpp"
+
+/*!
+ * \brief The TabulatedEOS class evaluates another equation of state (BWRS or
+ * GERG04) by interpolation in a table precomputed over a box in pressure and
+ * temperature, for a given composition.
+ *
+ * The table stores \f$Z\f$, \f$\frac{\partial Z}{\partial T}|_p\f$,
+ * \f$\frac{\partial Z}{\partial p}|_T\f$, \f$\frac{\partial Z}{\partial T}|_\rho\f$,
+ * \f$c_p\f$ and \f$c_v\f$, and their first derivatives and mixed second
+ * derivative with respect to pressure and temperature, at each node of a
+ * uniform grid. Between the nodes the properties are evaluated by bicubic
+ * Hermite interpolation, which is continuous with continuous first
+ * derivatives across the cells. Outside the box the underlying equation of
+ * state is evaluated directly.
+ *
+ * The node derivatives of \f$Z\f$ are the exact derivatives from the
+ * underlying equation of state, so the interpolation error in \f$Z\f$ is
+ * bounded by \f$\frac{h^4}{384} \max|\partial^4 Z|\f$ in each direction,
+ * where \f$h\f$ is the grid spacing. The node derivatives of the other
+ * properties are approximated by second order finite differences, which
+ * makes their error \f$O(h^3)\f$. When building a table, the interpolation
+ * is compared to the underlying equation of state at the centre of each
+ * cell (where the interpolation error is largest), and the largest error of
+ * each property, relative to the largest magnitude of that property in the
+ * table, is available from errorEstimate().
+ *
+ * Tables only depend on the underlying equation of state, the grid and the
+ * composition, and are shared between all instances. Building a table
+ * requires evaluating the underlying equation of state at each node and
+ * cell centre, so this class is intended for runs with constant
+ * composition, where a single table is used. Tables can be saved to a
+ * directory, so they are only built once across runs.
+ *
+ * Every composition without a table in memory or on disk builds (and saves)
+ * a new table, so the number of tables built by the process is capped by
+ * tableBuildLimit(). When the cap is reached, a warning is printed once, and
+ * new compositions are evaluated with the underlying equation of state
+ * directly, as if all states were outside the table. Compositions that
+ * already have a table keep using it.
+ */
+class TabulatedEOS : public EquationOfStateBase
+{
+public:
+    //! The box in pressure and temperature covered by the table, and the
+    //! number of grid points in each direction.
+    struct Grid
+    {
+        double minPressure = 1e5; //!< Smallest tabulated pressure [Pa]
+        double maxPressure = 15e6; //!< Largest tabulated pressure [Pa]
+        arma::uword pressurePoints = 100; //!< Number of grid points in pressure, at least 3
+        double minTemperature = 243.15; //!< Smallest tabulated temperature [K]
+        double maxTemperature = 343.15; //!< Largest tabulated temperature [K]
+        arma::uword temperaturePoints = 51; //!< Number of grid points in temperature, at least 3
+    };
+
+    /*!
+     * \brief TabulatedEOS constructor.
+     *
+     * If directory is not empty, the table is loaded from the directory if it
+     * has been saved there before (with the same equation of state, grid and
+     * composition), and otherwise built and saved there.
+     *
+     * \param model Underlying equation of state ("BWRS" or "GERG04")
+     * \param composition Gas composition fractions, in order C1, C2, C3, iC4, nC4, iC5, nC5, C6, N2, CO2.
+     * \param grid Box and number of grid points of the table
+     * \param directory Directory to load tables from and save tables to, not used if empty
+     */
+    explicit TabulatedEOS(
+            const std::string& model,
+            const arma::vec& composition = Composition::defaultComposition,
+            const Grid& grid = Grid(),
+            const std::string& directory = "");
+
+    //! Declared to avoid the inline compiler-generated default destructor.
+    virtual ~TabulatedEOS();
+
+    /*!
+     * \brief Override. Interpolate in the table, or evaluate the underlying
+     * equation of state if outside the table.
+     * \see EquationOfStateBase::evaluate()
+     */
+    virtual arma::vec evaluate(const double pressure, const double temperature) const override;
+
+    /*!
+     * \brief Override. As evaluate(), but state is used (and updated) when
+     * the underlying equation of state is evaluated outside the table.
+     * \see EquationOfStateBase::evaluate(const double, const double, DensityState&) const
+     */
+    virtual arma::vec evaluate(const double pressure, const double temperature, DensityState& state) const override;
+
+    /*!
+     * \brief Override. Interpolates directly into the output, without
+     * per-state temporaries.
+     * \see EquationOfStateBase::evaluateBatch()
+     */
+    virtual void evaluateBatch(
+            const arma::vec& pressure,
+            const arma::vec& temperature,
+            const arma::mat& composition,
+            arma::mat& output,
+            std::vector<DensityState>& densityStates) override;
+
+    /*!
+     * \brief Override. Interpolate just \f$Z\f$ in the table, or evaluate
+     * the underlying equation of state if outside the table.
+     * \see EquationOfStateBase::calculateCompressibility()
+     */
+    virtual double calculateCompressibility(const double pressure, const double temperature) const override;
+
+    /*!
+     * \brief Override. Also sets the composition of the underlying equation
+     * of state, and gets (or builds) the table for the new composition.
+     * \see EquationOfStateBase::setComposition()
+     */
+    virtual bool setComposition(const arma::vec& composition, const bool force = true) override;
+
+    //! Check if the given pressure [Pa] and temperature [K] are inside the
+    //! table. Always false if the composition has no table (see
+    //! tableBuildLimit()).
+    bool contains(const double pressure, const double temperature) const;
+
+    /*!
+     * \brief Largest interpolation error of each property at the cell
+     * centres, relative to the largest magnitude of the property in the
+     * table.
+     * \return arma::vec with the errors of \f$Z\f$, \f$\frac{\partial Z}{\partial T}|_p\f$,
+     * \f$\frac{\partial Z}{\partial p}|_T\f$, \f$\frac{\partial Z}{\partial T}|_\rho\f$,
+     * \f$c_p\f$ and \f$c_v\f$, or an empty arma::vec if the composition
+     * has no table (see tableBuildLimit())
+     */
+    const arma::vec& errorEstimate() const;
+
+    //! Get the grid of the table
+    const Grid& grid() const { return m_grid; }
+
+    //! Get the underlying equation of state
+    const EquationOfStateBase& model() const { return *m_model; }
+
+    /*!
+     * \brief Remove all tables from memory, and reset builtTables().
+     * Instances keep their current table, and tables saved to disk are not
+     * affected.
+     */
+    static void clearTables();
+
+    /*!
+     * \brief Set the max number of tables the process builds, see
+     * tableBuildLimit(). Tables loaded from disk do not count. Compositions
+     * that were refused a table keep using the underlying equation of state
+     * until clearTables().
+     */
+    static void setTableBuildLimit(const arma::uword limit);
+
+    //! Max number of tables the process builds (default 16). Compositions
+    //! without a table after this use the underlying equation of state.
+    static arma::uword tableBuildLimit();
+
+    //! Number of tables built by the process since the last clearTables()
+    static arma::uword builtTables();
+
+private:
+    struct Table;
+
+    //! Interpolate the six properties at the given state, and write them to
+    //! output[0], output[stride], ..., output[5*stride]. The density state is
+    //! only used outside the table.
+    void evaluateInto(
+            const double pressure,
+            const double temperature,
+            DensityState& state,
+            double* output,
+            const arma::uword stride) const;
+
+    //! Load the table for composition from m_directory, or build it (and
+    //! save it to m_directory). Returns an empty table if it has to be built
+    //! and tableBuildLimit() is reached.
+    Table loadOrBuildTable(const arma::vec& composition) const;
+
+    //! Calculate the table for composition with the underlying equation of state
+    Table buildTable(const arma::vec& composition) const;
+
+    //! Path to the file storing the table for composition in m_directory
+    std::string tableFileName(const arma::vec& composition) const;
+
+    //! Values identifying a table: the grid and the composition
+    arma::vec tableKey(const arma::vec& composition) const;
+
+    std::string m_modelName; //!< Name of the underlying equation of state
+    std::unique_ptr<EquationOfStateBase> m_model; //!< Underlying equation of state
+    Grid m_grid; //!< Box and number of grid points of the table
+    std::string m_directory; //!< Directory tables are saved to (not used if empty)
+    std::string m_cacheTag; //!< Identifies the equation of state and grid in MixtureCache
+    double m_pressureStep; //!< Pressure grid spacing [Pa]
+    double m_temperatureStep; //!< Temperature grid spacing [K]
+    std::shared_ptr<const Table> m_table; //!< Table for the current composition
+};
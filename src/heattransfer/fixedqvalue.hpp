@@ -5,7 +5,7 @@
 /*!
  * \brief Implementation of HeatTransferBase for fixed heat flux.
  */
-class FixedQValue: public HeatTransferBase
+class FixedQValue final : public HeatTransferBase
 {
 public:
     /*!
@@ -6,7 +6,7 @@
  * \brief Implementation of HeatTransferBase for fixed U-value (total heat transfer
  * coefficient).
  */
-class FixedUValue: public HeatTransferBase
+class FixedUValue final : public HeatTransferBase
 {
 public:
     /*!
@@ -1,24 +1,178 @@
 #include "heattransfer.hpp"
 
+#include <limits>
+#include <variant>
+
 #include "heattransferbase.hpp"
 #include "heattransferstate.hpp"
+#include "heattransferstatematrix.hpp"
 #include "pipeline.hpp"
 #include "unsteady.hpp"
+#include "unsteadybatch.hpp"
 #include "steadystate.hpp"
 #include "fixedqvalue.hpp"
 #include "fixeduvalue.hpp"
+#include "utilities/threadpool.hpp"
 
 using std::make_unique;
 using std::vector;
-using std::unique_ptr;
 using arma::uword;
 using arma::vec;
+using arma::mat;
+
+struct HeatTransfer::Models
+{
+    //! Instances of one of the heat transfer types, one for each grid point
+    std::variant<
+        vector<UnsteadyHeatTransfer>,
+        vector<SteadyStateHeatTransfer>,
+        vector<FixedQValue>,
+        vector<FixedUValue>> heat;
+};
+
+namespace
+{
+
+template<typename Model>
+vector<Model> makeRadial(const Pipeline& pipeline)
+{
+    vector<Model> heat;
+    heat.reserve(pipeline.size());
+    for (uword i = 0; i < pipeline.size(); i++)
+    {
+        heat.emplace_back(
+                    pipeline.diameter()(i),
+                    pipeline.pipeWall().at(i),
+                    pipeline.burialDepth()(i),
+                    pipeline.burialMedium().at(i),
+                    pipeline.ambientFluid().at(i));
+    }
+
+    return heat;
+}
+
+// calls function for all of [0, n), in ranges on the threads of the pool if set
+void forEachRange(
+        utils::ThreadPool* threadPool,
+        const uword n,
+        const utils::ThreadPool::RangeFunction& function)
+{
+    if (threadPool)
+    {
+        threadPool->parallelFor(n, function);
+    }
+    else
+    {
+        function(0, n);
+    }
+}
 
-// in this file only
-unique_ptr<HeatTransferBase> makeSingle(
+// number of shell temperatures returned by Model::evaluate() (only the
+// unsteady model keeps shell temperatures)
+template<typename Model>
+uword evaluatedLayers(const Model&)
+{
+    return 0;
+}
+
+uword evaluatedLayers(const UnsteadyHeatTransfer& heat)
+{
+    return heat.size();
+}
+
+// evaluates grid point i of pipeline from current, writes the new state to
+// next and returns the heat flux. Only the unsteady model uses the shell
+// temperatures, so the other models get a state with just the heat flux.
+template<typename Model>
+double evaluateAt(
+        const Model& heat,
+        const HeatTransferStateMatrix::ConstView& current,
+        const double timeStep,
+        const Pipeline& pipeline,
+        const uword i,
+        HeatTransferStateMatrix::View next)
+{
+    const HeatTransferState state = heat.evaluate(
+                HeatTransferState(current.heatFlux()),
+                timeStep,
+                pipeline.ambientTemperature()(i),
+                pipeline.pressure()(i),
+                pipeline.temperature()(i),
+                pipeline.reynoldsNumber()(i),
+                pipeline.heatCapacityConstantPressure()(i),
+                pipeline.viscosity()(i));
+
+    next = state;
+    return state.heatFlux();
+}
+
+// the unsteady model reads and writes the columns of the matrices directly,
+// which may be the same column
+double evaluateAt(
+        const UnsteadyHeatTransfer& heat,
+        const HeatTransferStateMatrix::ConstView& current,
+        const double timeStep,
         const Pipeline& pipeline,
-        const arma::uword i,
-        const std::string& type);
+        const uword i,
+        HeatTransferStateMatrix::View next)
+{
+    const arma::subview_col<double> shellTemperature = current.temperature();
+    arma::subview_col<double> newShellTemperature = next.temperature();
+    if (shellTemperature.n_elem != heat.size() || newShellTemperature.n_elem != heat.size())
+        throw std::runtime_error("incompatible size");
+
+    const double heatFlux = heat.evaluateInto(
+                shellTemperature.colptr(0),
+                timeStep,
+                pipeline.ambientTemperature()(i),
+                pipeline.pressure()(i),
+                pipeline.temperature()(i),
+                pipeline.reynoldsNumber()(i),
+                pipeline.heatCapacityConstantPressure()(i),
+                pipeline.viscosity()(i),
+                newShellTemperature.colptr(0));
+
+    next.setHeatFlux(heatFlux);
+    return heatFlux;
+}
+
+// the models are final, so these calls are not virtual
+template<typename Model>
+void evaluateEach(
+        const vector<Model>& heat,
+        const HeatTransferStateMatrix& state,
+        const double timeStep,
+        Pipeline& pipeline,
+        utils::ThreadPool* threadPool)
+{
+    // Each grid point only writes its own column of the temperature matrix,
+    // so ranges of grid points can be evaluated in parallel. This requires
+    // that the matrix is never resized by the writes, so check up front that
+    // every grid point has room for the layers its model returns.
+    for (uword i = 0; i < heat.size(); i++)
+    {
+        const uword layers = evaluatedLayers(heat[i]);
+        if (layers > 0 && state.layers(i) != layers)
+            throw std::runtime_error("incompatible size");
+    }
+
+    // start from the current state, which has room for all the layers
+    HeatTransferStateMatrix& newState = pipeline.heatTransferState();
+    if (&newState != &state)
+    {
+        newState = state;
+    }
+
+    forEachRange(threadPool, heat.size(), [&](const uword begin, const uword end)
+    {
+        for (uword i = begin; i < end; i++)
+        {
+            pipeline.heatFlow()(i) = evaluateAt(heat[i], state.at(i), timeStep, pipeline, i, newState.at(i));
+        }
+    });
+}
+
+} // end anonymous namespace
 
 HeatTransfer::~HeatTransfer()
 {}
@@ -26,17 +180,64 @@ HeatTransfer::~HeatTransfer()
 HeatTransfer::HeatTransfer(
         const Pipeline& pipeline,
         const std::string& type):
-    m_heat(make_unique<vector<unique_ptr<HeatTransferBase>>>())
+    m_heat(make_unique<Models>())
 {
-    // fill vector
-    for (arma::uword i = 0; i < pipeline.size(); i++)
+    if (type == "Unsteady")
+    {
+        m_heat->heat = makeRadial<UnsteadyHeatTransfer>(pipeline);
+    }
+    else if (type == "SteadyState")
+    {
+        m_heat->heat = makeRadial<SteadyStateHeatTransfer>(pipeline);
+    }
+    else if (type == "FixedQValue")
+    {
+        const double q = 0;
+        m_heat->heat = vector<FixedQValue>(pipeline.size(), FixedQValue(q));
+    }
+    else if (type == "FixedUValue")
+    {
+        const double U = 0;
+        m_heat->heat = vector<FixedUValue>(pipeline.size(), FixedUValue(U));
+    }
+    else
+    {
+        const std::string what = "invalid type transfer type \"" + type + "\"";
+        throw std::invalid_argument(what);
+    }
+
+    auto* unsteady = std::get_if<vector<UnsteadyHeatTransfer>>(&m_heat->heat);
+    if (unsteady && !unsteady->empty())
     {
-        m_heat->push_back(makeSingle(pipeline, i, type));
+        bool sameSize = true;
+        for (const UnsteadyHeatTransfer& h : *unsteady)
+        {
+            sameSize = sameSize && h.size() == unsteady->front().size();
+        }
+
+        // otherwise fall back to evaluating each grid point separately. The
+        // instances then refer to the shell data in the batch.
+        if (sameSize && unsteady->front().size() >= 2)
+        {
+            m_unsteady = make_unique<UnsteadyHeatTransferBatch>(*unsteady);
+        }
     }
 }
 
+const HeatTransferBase& HeatTransfer::at(std::size_t pos) const
+{
+    return std::visit(
+                [pos](const auto& heat) -> const HeatTransferBase& { return heat.at(pos); },
+                m_heat->heat);
+}
+
+std::size_t HeatTransfer::size() const
+{
+    return std::visit([](const auto& heat) { return heat.size(); }, m_heat->heat);
+}
+
 void HeatTransfer::evaluate(
-        const std::vector<HeatTransferState>& state,
+        const HeatTransferStateMatrix& state,
         const double timeStep,
         Pipeline& pipeline) const
 {
@@ -44,66 +245,107 @@ void HeatTransfer::evaluate(
     {
         throw std::runtime_error("heat transfer state is not initialized");
     }
-    if (m_heat->size() != pipeline.size())
+    if (size() != pipeline.size() || state.size() != pipeline.size())
     {
         throw std::runtime_error("incompatible size)");
     }
 
-    for (uword i = 0; i < m_heat->size(); i++)
+    if (m_unsteady)
     {
-        HeatTransferState heatTransferState = m_heat->at(i)->evaluate(
-                    state.at(i),
+        if (!state.isUniform() || state.layers() != m_unsteady->layers())
+            throw std::runtime_error("incompatible size");
+
+        vec heatFlux;
+        mat newShellTemperature;
+        m_unsteady->evaluate(
+                    state.temperature(),
                     timeStep,
-                    pipeline.ambientTemperature()(i),
-                    pipeline.pressure()(i),
-                    pipeline.temperature()(i),
-                    pipeline.reynoldsNumber()(i),
-                    pipeline.heatCapacityConstantPressure()(i),
-                    pipeline.viscosity()(i));
+                    pipeline.ambientTemperature(),
+                    pipeline.pressure(),
+                    pipeline.temperature(),
+                    pipeline.reynoldsNumber(),
+                    pipeline.heatCapacityConstantPressure(),
+                    pipeline.viscosity(),
+                    heatFlux,
+                    newShellTemperature);
 
-        pipeline.heatFlow()(i) = heatTransferState.heatFlux();
-        pipeline.heatTransferState().at(i) = heatTransferState;
+        pipeline.heatFlow() = heatFlux;
+        pipeline.heatTransferState().set(std::move(heatFlux), std::move(newShellTemperature));
+
+        return;
     }
+
+    std::visit(
+                [&](const auto& heat) { evaluateEach(heat, state, timeStep, pipeline, m_threadPool.get()); },
+                m_heat->heat);
 }
 
-unique_ptr<HeatTransferBase> makeSingle(
-        const Pipeline& pipeline,
-        const arma::uword i,
-        const std::string& type)
+void HeatTransfer::thermalize(Pipeline& pipeline) const
 {
-    if (type == "Unsteady")
+    const auto* unsteady = std::get_if<vector<UnsteadyHeatTransfer>>(&m_heat->heat);
+    if (!unsteady)
     {
-        return make_unique<UnsteadyHeatTransfer>(
-                    pipeline.diameter()(i),
-                    pipeline.pipeWall().at(i),
-                    pipeline.burialDepth()(i),
-                    pipeline.burialMedium().at(i),
-                    pipeline.ambientFluid().at(i)
-                    );
+        // just keep the existing state if not Unsteady
+        pipeline.heatFlow() = pipeline.heatTransferState().heatFlux();
+        return;
     }
-    else if (type == "SteadyState")
+
+    if (m_unsteady)
     {
-        return make_unique<SteadyStateHeatTransfer>(
-                    pipeline.diameter()(i),
-                    pipeline.pipeWall().at(i),
-                    pipeline.burialDepth()(i),
-                    pipeline.burialMedium().at(i),
-                    pipeline.ambientFluid().at(i)
-                    );
+        // same as UnsteadyHeatTransfer::thermalizeToSteadyState(), an infinite
+        // time step from an arbitrary initial temperature
+        const mat shellTemperature = arma::zeros<mat>(m_unsteady->layers(), size()) + 273.15;
+
+        vec heatFlux;
+        mat newShellTemperature;
+        m_unsteady->evaluate(
+                    shellTemperature,
+                    std::numeric_limits<double>::infinity(),
+                    pipeline.ambientTemperature(),
+                    pipeline.pressure(),
+                    pipeline.temperature(),
+                    pipeline.reynoldsNumber(),
+                    pipeline.heatCapacityConstantPressure(),
+                    pipeline.viscosity(),
+                    heatFlux,
+                    newShellTemperature);
+
+        pipeline.heatFlow() = heatFlux;
+        pipeline.heatTransferState().set(std::move(heatFlux), std::move(newShellTemperature));
+        return;
     }
-    else if (type == "FixedQValue")
+
+    // each grid point only writes its own element of state
+    vector<HeatTransferState> state(unsteady->size());
+    forEachRange(m_threadPool.get(), unsteady->size(), [&](const uword begin, const uword end)
     {
-        const double q = 0;
-        return make_unique<FixedQValue>(q);
-    }
-    else if (type == "FixedUValue")
+        for (uword i = begin; i < end; i++)
+        {
+            state[i] = (*unsteady)[i].thermalizeToSteadyState(
+                        pipeline.ambientTemperature()(i),
+                        pipeline.pressure()(i),
+                        pipeline.temperature()(i),
+                        pipeline.reynoldsNumber()(i),
+                        pipeline.heatCapacityConstantPressure()(i),
+                        pipeline.viscosity()(i));
+        }
+    });
+
+    pipeline.heatTransferState() = HeatTransferStateMatrix(state);
+    pipeline.heatFlow() = pipeline.heatTransferState().heatFlux();
+}
+
+void HeatTransfer::setThreadPool(std::shared_ptr<utils::ThreadPool> threadPool)
+{
+    if (threadPool && threadPool->size() < 2)
     {
-        const double U = 0;
-        return make_unique<FixedUValue>(U);
+        // no point in going through the pool with a single thread
+        threadPool = nullptr;
     }
-    else
+
+    m_threadPool = threadPool;
+    if (m_unsteady)
     {
-        const std::string what = "invalid type transfer type \"" + type + "\"";
-        throw std::invalid_argument(what);
+        m_unsteady->setThreadPool(threadPool);
     }
 }
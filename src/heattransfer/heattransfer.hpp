@@ -1,16 +1,24 @@
 #pragma once
 
 #include <memory>
+#include <string>
 #include <vector>
 
 class HeatTransferBase;
-class HeatTransferState;
+class HeatTransferStateMatrix;
+class UnsteadyHeatTransferBatch;
 class Pipeline;
+namespace utils { class ThreadPool; }
 
 /*!
- * \brief The EquationOfState class is a wrapper around HeatTransferBase that
+ * \brief The HeatTransfer class is a wrapper around HeatTransferBase that
  * has one heat transfer instance per grid point, and wraps the
  * HeatTransferBase::evaluate() function.
+ *
+ * All grid points use the same type of heat transfer. The instances are stored
+ * by value in one std::vector of the concrete type, and the type is dispatched
+ * once per call instead of once per grid point, so the loops over grid points
+ * have no virtual calls.
  */
 class HeatTransfer
 {
@@ -22,7 +30,8 @@ public:
      * \brief Construct from pipeline and string to determine the type of
      * heat transfer.
      * \param pipeline Pipeline instance
-     * \param type Type of heat transfer ("BWRS", "GERG04" or "IdealGas")
+     * \param type Type of heat transfer ("Unsteady", "SteadyState",
+     * "FixedQValue" or "FixedUValue")
      */
     HeatTransfer(const Pipeline& pipeline, const std::string& type);
 
@@ -30,19 +39,57 @@ public:
      * \brief This is a wrapper around HeatTransferBase::evaluate() that
      * calls that function for each grid point. This modifes the pipeline
      * argument.
+     *
+     * With "Unsteady" heat transfer, all grid points are evaluated together
+     * with UnsteadyHeatTransferBatch, as long as they all have the same
+     * number of discretization layers.
+     *
+     * With a thread pool of more than one thread (see setThreadPool()), ranges
+     * of grid points are evaluated in parallel.
      * \param state Current heat transfer state
      * \param timeStep Time step [s]
      * \param pipeline Pipeline instance
      */
-    void evaluate(const std::vector<HeatTransferState>& state, const double timeStep, Pipeline& pipeline) const;
+    void evaluate(const HeatTransferStateMatrix& state, const double timeStep, Pipeline& pipeline) const;
+
+    /*!
+     * \brief Thermalize the heat transfer state of each grid point to steady
+     * state, using UnsteadyHeatTransfer::thermalizeToSteadyState(). This
+     * modifies the pipeline argument.
+     *
+     * Only unsteady heat transfer has a state to thermalize, so with other
+     * types of heat transfer this only copies the heat flux of the current
+     * state to Pipeline::heatFlow().
+     *
+     * \param pipeline Pipeline instance
+     */
+    void thermalize(Pipeline& pipeline) const;
+
+    /*!
+     * \brief Set the thread pool used to evaluate and thermalize the grid
+     * points in parallel.
+     * \param threadPool Thread pool, shared with the owner (e.g. Physics).
+     * Grid points are evaluated serially if nullptr (default).
+     */
+    void setThreadPool(std::shared_ptr<utils::ThreadPool> threadPool);
 
     //! std::vector-like at(i) getter
-    const HeatTransferBase& at(std::size_t pos) const { return *m_heat->at(pos); }
+    const HeatTransferBase& at(std::size_t pos) const;
 
     //! std::vector-like size() operator
-    auto size() const { return m_heat->size(); }
+    std::size_t size() const;
 
 private:
-    //! Vector of HeatTransferBase instances, one for each grid point.
-    std::unique_ptr<std::vector<std::unique_ptr<HeatTransferBase>>> m_heat;
+    //! The heat transfer instances of all grid points, one std::vector for
+    //! each type of heat transfer (defined in heattransfer.cpp).
+    struct Models;
+
+    //! HeatTransferBase instances, one for each grid point.
+    std::unique_ptr<Models> m_heat;
+
+    //! Batched evaluation of all grid points, only used with "Unsteady".
+    std::unique_ptr<UnsteadyHeatTransferBatch> m_unsteady;
+
+    //! Thread pool used to evaluate grid points in parallel
+    std::shared_ptr<utils::ThreadPool> m_threadPool;
 };
@@ -40,7 +40,7 @@ struct HeatTransferState
      *
      * \return True if State::m_temperature is set (optional).
      */
-    bool hasTemperature() { return m_temperature.has_value(); }
+    bool hasTemperature() const { return m_temperature.has_value(); }
 
     //! Heat flux getter [W/m2]
     double heatFlux() const { return m_heatFlux; }
@@ -0,0 +1,142 @@
+#include "heattransferstatematrix.hpp"
+
+#include <optional>
+#include <stdexcept>
+
+using arma::uword;
+using arma::vec;
+using arma::mat;
+using arma::uvec;
+
+HeatTransferStateMatrix::ConstView::ConstView(const HeatTransferStateMatrix& states, const uword index):
+    m_states(&states),
+    m_index(index)
+{}
+
+const arma::subview_col<double> HeatTransferStateMatrix::ConstView::temperature() const
+{
+    if (!hasTemperature())
+        throw std::bad_optional_access();
+
+    return m_states->m_temperature.col(m_index).head(m_states->m_layers(m_index));
+}
+
+HeatTransferStateMatrix::ConstView::operator HeatTransferState() const
+{
+    if (hasTemperature())
+        return HeatTransferState(heatFlux(), temperature());
+
+    return HeatTransferState(heatFlux());
+}
+
+HeatTransferStateMatrix::View::View(HeatTransferStateMatrix& states, const uword index):
+    ConstView(states, index),
+    m_mutableStates(&states)
+{}
+
+HeatTransferStateMatrix::View& HeatTransferStateMatrix::View::operator=(const HeatTransferState& state)
+{
+    setHeatFlux(state.heatFlux());
+    if (state.hasTemperature())
+    {
+        setTemperature(state.temperature());
+    }
+    else
+    {
+        m_mutableStates->m_layers(m_index) = 0;
+    }
+
+    return *this;
+}
+
+HeatTransferStateMatrix::View& HeatTransferStateMatrix::View::operator=(const ConstView& other)
+{
+    return *this = HeatTransferState(other);
+}
+
+HeatTransferStateMatrix::View& HeatTransferStateMatrix::View::operator=(const View& other)
+{
+    return *this = static_cast<const ConstView&>(other);
+}
+
+arma::subview_col<double> HeatTransferStateMatrix::View::temperature()
+{
+    if (!hasTemperature())
+        throw std::bad_optional_access();
+
+    return m_mutableStates->m_temperature.col(m_index).head(m_states->m_layers(m_index));
+}
+
+void HeatTransferStateMatrix::View::setHeatFlux(const double heatFlux)
+{
+    m_mutableStates->m_heatFlux(m_index) = heatFlux;
+}
+
+void HeatTransferStateMatrix::View::setTemperature(const vec& temperature)
+{
+    mat& matrix = m_mutableStates->m_temperature;
+    if (temperature.n_elem > matrix.n_rows)
+    {
+        matrix.resize(temperature.n_elem, matrix.n_cols);
+    }
+
+    const uword n = temperature.n_elem;
+    if (n > 0)
+    {
+        matrix.col(m_index).head(n) = temperature;
+    }
+    if (n < matrix.n_rows)
+    {
+        matrix.col(m_index).tail(matrix.n_rows - n).zeros();
+    }
+    m_mutableStates->m_layers(m_index) = n;
+}
+
+HeatTransferStateMatrix::HeatTransferStateMatrix(const uword size):
+    m_heatFlux(arma::zeros<vec>(size)),
+    m_temperature(0, size),
+    m_layers(arma::zeros<uvec>(size))
+{}
+
+HeatTransferStateMatrix::HeatTransferStateMatrix(const std::vector<HeatTransferState>& states):
+    HeatTransferStateMatrix(states.size())
+{
+    uword layers = 0;
+    for (const HeatTransferState& state : states)
+    {
+        if (state.hasTemperature())
+            layers = std::max(layers, uword(state.temperature().n_elem));
+    }
+    m_temperature.zeros(layers, states.size());
+
+    for (uword i = 0; i < states.size(); i++)
+    {
+        at(i) = states.at(i);
+    }
+}
+
+void HeatTransferStateMatrix::set(vec heatFlux, mat temperature)
+{
+    if (heatFlux.n_elem != temperature.n_cols)
+        throw std::runtime_error("incompatible size");
+
+    m_heatFlux = std::move(heatFlux);
+    m_temperature = std::move(temperature);
+    m_layers = arma::zeros<uvec>(m_heatFlux.n_elem) + m_temperature.n_rows;
+}
+
+HeatTransferStateMatrix::ConstView HeatTransferStateMatrix::at(const uword i) const
+{
+    if (i >= size())
+        throw std::out_of_range("HeatTransferStateMatrix::at");
+
+    return ConstView(*this, i);
+}
+
+HeatTransferStateMatrix::View HeatTransferStateMatrix::at(const uword i)
+{
+    if (i >= size())
+        throw std::out_of_range("HeatTransferStateMatrix::at");
+
+    return View(*this, i);
+}
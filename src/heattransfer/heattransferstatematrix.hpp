@@ -0,0 +1,161 @@
+#pragma once
+
+#include <vector>
+#include <armadillo>
+
+#include "heattransfer/heattransferstate.hpp"
+
+/*!
+ * \brief Container for the HeatTransferState of every grid point in a
+ * pipeline.
+ *
+ * The heat fluxes are stored in one vector, and the shell temperatures of all
+ * grid points in one matrix with one column per grid point, so copying the
+ * state is a couple of contiguous copies instead of one allocation per grid
+ * point. at() returns a lightweight view of a single grid point, which can be
+ * converted to, and assigned from, HeatTransferState.
+ *
+ * Grid points without temperature (for example with steady state heat
+ * transfer) have zero layers. If the grid points have different numbers of
+ * layers, the matrix has as many rows as the largest number of layers, and
+ * the rows below the layers of a grid point are not used.
+ */
+class HeatTransferStateMatrix
+{
+public:
+    /*!
+     * \brief Read-only view of the state of a single grid point.
+     *
+     * Only valid as long as the HeatTransferStateMatrix it refers to.
+     */
+    class ConstView
+    {
+    public:
+        //! Construct from container and index of grid point
+        ConstView(const HeatTransferStateMatrix& states, const arma::uword index);
+
+        //! Heat flux getter [W/m2]
+        double heatFlux() const { return m_states->m_heatFlux(m_index); }
+
+        //! True if the grid point has temperature (at least one layer)
+        bool hasTemperature() const { return m_states->m_layers(m_index) > 0; }
+
+        /*!
+         * \brief Temperature getter. This will throw an error if the grid
+         * point has no temperature, like HeatTransferState::temperature().
+         *
+         * The read-only subview refers to the memory of the matrix, so it is
+         * invalidated if the matrix is resized.
+         *
+         * \return Temperature [K]
+         */
+        const arma::subview_col<double> temperature() const;
+
+        //! Copy the state of the grid point to a HeatTransferState
+        operator HeatTransferState() const;
+
+    protected:
+        const HeatTransferStateMatrix* m_states; //!< Container
+        arma::uword m_index; //!< Index of grid point
+    };
+
+    /*!
+     * \brief View of the state of a single grid point, which can also modify
+     * the state.
+     *
+     * Assigning to a View modifies the grid point it refers to (it is not
+     * rebound).
+     */
+    class View : public ConstView
+    {
+    public:
+        //! Construct from container and index of grid point
+        View(HeatTransferStateMatrix& states, const arma::uword index);
+
+        View(const View&) = default;
+
+        //! Set the heat flux, and the temperature if the state has temperature
+        View& operator=(const HeatTransferState& state);
+        //! Set the heat flux and temperature to those of another grid point
+        View& operator=(const ConstView& other);
+        //! Set the heat flux and temperature to those of another grid point
+        View& operator=(const View& other);
+
+        //! Set the heat flux [W/m2]
+        void setHeatFlux(const double heatFlux);
+
+        //! Set the temperature [K]. Adds rows to the matrix if the grid point
+        //! has more layers than any other grid point.
+        void setTemperature(const arma::vec& temperature);
+
+        using ConstView::temperature;
+
+        /*!
+         * \brief Writable temperature getter, see ConstView::temperature().
+         * Writes go straight to the matrix, and the number of layers is not
+         * changed.
+         * \return Temperature [K]
+         */
+        arma::subview_col<double> temperature();
+
+    private:
+        HeatTransferStateMatrix* m_mutableStates; //!< Container
+    };
+
+    /*!
+     * \brief Construct with zero heat flux and no temperature at each grid point.
+     * \param size Number of grid points
+     */
+    explicit HeatTransferStateMatrix(const arma::uword size = 0);
+
+    /*!
+     * \brief Construct from the HeatTransferState of each grid point.
+     * \param states HeatTransferState of each grid point
+     */
+    explicit HeatTransferStateMatrix(const std::vector<HeatTransferState>& states);
+
+    //! Number of grid points
+    arma::uword size() const { return m_heatFlux.n_elem; }
+
+    //! Number of rows in the temperature matrix (the largest number of layers)
+    arma::uword layers() const { return m_temperature.n_rows; }
+
+    //! Number of layers of grid point i
+    arma::uword layers(const arma::uword i) const { return m_layers(i); }
+
+    //! True if all grid points have layers() layers
+    bool isUniform() const { return arma::all(m_layers == layers()); }
+
+    //! Heat flux of each grid point [W/m2]
+    const arma::vec& heatFlux() const { return m_heatFlux; }
+
+    //! Temperature of each layer (rows) of each grid point (columns) [K]
+    const arma::mat& temperature() const { return m_temperature; }
+
+    /*!
+     * \brief Set the state of all grid points.
+     * \param heatFlux Heat flux of each grid point [W/m2]
+     * \param temperature Temperature of each layer (rows) of each grid point (columns) [K]
+     */
+    void set(arma::vec heatFlux, arma::mat temperature);
+
+    //! std::vector-like at(i) getter
+    ConstView at(const arma::uword i) const;
+    //! std::vector-like at(i) getter
+    View at(const arma::uword i);
+
+    //! std::vector-like front() getter
+    ConstView front() const { return at(0); }
+    //! std::vector-like front() getter
+    View front() { return at(0); }
+
+    //! std::vector-like back() getter
+    ConstView back() const { return at(size() - 1); }
+    //! std::vector-like back() getter
+    View back() { return at(size() - 1); }
+
+private:
+    arma::vec m_heatFlux;    //!< Heat flux of each grid point [W/m2]
+    arma::mat m_temperature; //!< Temperature of each layer of each grid point [K]
+    arma::uvec m_layers;     //!< Number of layers of each grid point
+};
@@ -27,7 +27,8 @@ SteadyStateHeatTransfer::SteadyStateHeatTransfer(
     const double outerRadius = m_ro.tail(1)(0);
     const double ho = calculateOuterFilmCoefficient(); // doesn't depend on gas
     m_overallThermalResistance += 1.0/(outerRadius*ho);
-    m_overallHeatTransferCoefficient = 1.0/(m_ri(0)*m_overallThermalResistance);
+    m_wallThermalResistance = m_ri(0)*m_overallThermalResistance;
+    m_overallHeatTransferCoefficient = 1.0/m_wallThermalResistance;
 }
 
 SteadyStateHeatTransfer::SteadyStateHeatTransfer(
@@ -86,7 +87,7 @@ double SteadyStateHeatTransfer::calculateHeatTransferCoefficient(
     const double hi = utils::calcInnerWallFilmCoefficient(
                 m_diameter, gasPressure, gasReynoldsNumber,
                 gasHeatCapacityConstantPressure, gasViscosity);
-    const double inverseU = 1.0/hi + m_ri(0)*m_overallThermalResistance;
+    const double inverseU = 1.0/hi + m_wallThermalResistance;
     const double U = 1.0/inverseU;
 
     return U;
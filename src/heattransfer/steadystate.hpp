@@ -15,7 +15,7 @@ class AmbientFluid;
  *
  * This is well documented in Jan Fredrik Helgaker's PhD thesis.
  */
-class SteadyStateHeatTransfer : public RadialHeatTransfer
+class SteadyStateHeatTransfer final : public RadialHeatTransfer
 {
 public:
     /*!
@@ -123,4 +123,10 @@ private:
     //! Total thermal resistance of all radial discretization shells.
     //! Does not include the inner film coefficient.
     double m_overallThermalResistance;
+
+    //! Inverse of the heat transfer coefficient of all radial discretization
+    //! shells, relative to the inner wall (m_ri(0)*m_overallThermalResistance).
+    //! Only the inner film coefficient is added to this in
+    //! calculateHeatTransferCoefficient().
+    double m_wallThermalResistance;
 };
@@ -1,5 +1,6 @@
 #include "heattransfer/unsteady.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 #include "utilities/errors.hpp"
@@ -20,16 +21,16 @@ UnsteadyHeatTransfer::UnsteadyHeatTransfer(
         const double burialDepth,
         const BurialMedium& burialMedium,
         const AmbientFluid& ambientFluid):
-    RadialHeatTransfer(diameter, pipeWall, burialDepth, burialMedium, ambientFluid)
+    RadialHeatTransfer(diameter, pipeWall, burialDepth, burialMedium, ambientFluid),
+    m_index(0)
 {
     // Transfer coefficients between each shell in each pipe section
-    //    m_heatTransferCoefficient; // == h
-    m_heatTransferCoefficient = zeros<vec>(size());
+    vec heatTransferCoefficient = zeros<vec>(size()); // == h
 
     // Inner n-1 shells
     for (uword j = 0; j < size() - 1; j++)
     {
-        m_heatTransferCoefficient(j) =
+        heatTransferCoefficient(j) =
             pow( // Sum of ln(ro/ri)/lambda for half shells
                 log(                      m_ro(j)/(m_ri(j) + m_width(j)/2.0) )/( 2.0*constants::pi*m_conductivity(j) )
                 + log( (m_ro(j) + m_width(j+1)/2.0)/m_ro(j)                  )/( 2.0*constants::pi*m_conductivity(j+1) )
@@ -37,8 +38,25 @@ UnsteadyHeatTransfer::UnsteadyHeatTransfer(
     }
     // Outermost shell
     uword j = size() - 1;
-    m_heatTransferCoefficient(j) =
+    heatTransferCoefficient(j) =
             pow(log( m_ro(j)/(m_ri(j) + m_width(j)/2.0) )/( 2.0*constants::pi*m_conductivity(j) ), -1);
+
+    // The rest of eq. (2.26) that doesn't depend on the gas or the time step
+    auto coefficients = std::make_shared<Coefficients>();
+    coefficients->diameter = {m_diameter};
+    coefficients->innerRadius = {m_ri(0)};
+    coefficients->heatTransferCoefficient = heatTransferCoefficient.t();
+    coefficients->thermalMass = (m_density%m_crossSection%m_heatCapacity).t();
+
+    coefficients->innerShellResistance = {log( (m_ri(0) + m_width(0)/2.0)/m_ri(0) )/( 2.0*constants::pi*m_conductivity(0) )};
+
+    const double k0N = calculateOuterFilmCoefficient();
+    coefficients->outerHeatTransferCoefficient = {pow(
+        log( m_ro(j) / (m_ri(j) + m_width(j)/2.0))/(2*constants::pi*m_conductivity(j) )
+        + 1.0/(m_ro(j)*2.0*constants::pi*k0N)
+    , -1)}; // heat transfer coefficient for last, outer shell
+
+    m_coefficients = std::move(coefficients);
 }
 
 // override
@@ -71,27 +89,47 @@ HeatTransferState UnsteadyHeatTransfer::evaluateInternal(
         const double gasHeatCapacity,
         const double gasViscosity) const
 {
-    if (shellTemperature.n_elem != m_density.n_elem)
+    if (shellTemperature.n_elem != size())
         throw std::runtime_error("incompatible size");
 
-    vec x = solveEquations(
+    vec newShellTemperature(size());
+    const double heatFlux = evaluateInto(
+                shellTemperature.memptr(), timeStep, ambientTemperature,
+                gasPressure, gasTemperature, gasReynoldsNumber, gasHeatCapacity,
+                gasViscosity, newShellTemperature.memptr());
+
+    return HeatTransferState(heatFlux, newShellTemperature);
+}
+
+double UnsteadyHeatTransfer::evaluateInto(
+        const double* shellTemperature,
+        const double timeStep,
+        const double ambientTemperature,
+        const double gasPressure,
+        const double gasTemperature,
+        const double gasReynoldsNumber,
+        const double gasHeatCapacity,
+        const double gasViscosity,
+        double* newShellTemperature) const
+{
+    const vec x = solveEquations(
                 shellTemperature, timeStep, gasPressure, gasTemperature,
                 ambientTemperature, gasReynoldsNumber, gasHeatCapacity,
                 gasViscosity);
-    double heatFlux = x(0);
-    vec newShellTemperature = x(arma::span(1, size()));
 
-    if (arma::any(newShellTemperature < 0))
+    if (arma::any(x.tail(size()) < 0))
     {
         throw utils::temperature_range_error("wall layer temperature less than 0 K");
     }
 
-    return HeatTransferState(heatFlux, newShellTemperature);
+    std::copy(x.begin() + 1, x.end(), newShellTemperature);
+
+    return x(0);
 }
 
 // private
 vec UnsteadyHeatTransfer::solveEquations(
-        const vec& shellTemperature,
+        const double* shellTemperature,
         const double timeStep,
         const double pressure,
         const double temperature,
@@ -103,14 +141,18 @@ vec UnsteadyHeatTransfer::solveEquations(
 {
     /* First do some global calculations ----------------------------------- */
 
-    const double hi = utils::calcInnerWallFilmCoefficient(m_diameter, pressure, reynoldsNumber, heatCapacity, viscosity);
+    // the coefficients of this grid point are row m_index
+    const Coefficients& coefficients = *m_coefficients;
+    const double diameter = coefficients.diameter(m_index);
+    const auto k = [&](const uword j) { return coefficients.heatTransferCoefficient(m_index, j); };
+
+    const double hi = utils::calcInnerWallFilmCoefficient(diameter, pressure, reynoldsNumber, heatCapacity, viscosity);
     const double hw = pow( // Heat transfer coefficient for inner film + half the first shell
-        1.0/(2.0*constants::pi*m_ri(0)*hi)
-        + log( (m_ri(0) + m_width(0)/2.0)/m_ri(0) )/( 2.0*constants::pi*m_conductivity(0) )
+        1.0/(2.0*constants::pi*coefficients.innerRadius(m_index)*hi)
+        + coefficients.innerShellResistance(m_index)
     , -1);
 
-    vec mass = m_density%m_crossSection;
-    vec factor = mass%m_heatCapacity/timeStep; // Factor used a lot in A and b
+    const vec factor = coefficients.thermalMass.row(m_index).t()/timeStep; // Factor used a lot in A and b
 
     /*
     Equation 2.4.1 in "Numerical Recipies" (2nd edition)
@@ -133,39 +175,34 @@ vec UnsteadyHeatTransfer::solveEquations(
     /* Setting up equations ------------------------------------------------ */
     // Heat equation, first part of eq. (2.26) in JFH thesis
     bt(0) = 1;
-    ct(0) = hw/(constants::pi*m_diameter);
-    rt(0) = temperature*hw/(constants::pi*m_diameter);
+    ct(0) = hw/(constants::pi*diameter);
+    rt(0) = temperature*hw/(constants::pi*diameter);
 
     // Pipe layer 1
     // this is the second line of eq. (2.26), multiplied by A_1
-    bt(1) = factor(0) + hw + m_heatTransferCoefficient(0); // Could get this into loops below if we incoorporated hw in h
-    ct(1) = -m_heatTransferCoefficient(0);
-    rt(1) = factor(0)*shellTemperature(0) + hw*temperature;
+    bt(1) = factor(0) + hw + k(0); // Could get this into loops below if we incoorporated hw in h
+    ct(1) = -k(0);
+    rt(1) = factor(0)*shellTemperature[0] + hw*temperature;
 
     // Filling row 2:(n-1) of A and b using loops
     // this is the third line of eq. (2.26), multiplied by A_i
     for (uword i = 2; i < size(); i++)
     {
-        bt(i) = m_heatTransferCoefficient(i-1) + m_heatTransferCoefficient(i-2) + factor(i-1); // Diagonal
-        ct(i) = -m_heatTransferCoefficient(i-1); // Right of diagonal
-        at(i) = -m_heatTransferCoefficient(i-2); // Left of diagonal
-        rt(i) = factor(i-1)*shellTemperature(i-1);
+        bt(i) = k(i-1) + k(i-2) + factor(i-1); // Diagonal
+        ct(i) = -k(i-1); // Right of diagonal
+        at(i) = -k(i-2); // Left of diagonal
+        rt(i) = factor(i-1)*shellTemperature[i-1];
     }
 
-    // Calculate final heat transfer coefficient
-    const uword end = size() - 1;
-    const double k0N = calculateOuterFilmCoefficient();
-    const double hN = pow(
-        log( m_ro(end) / (m_ri(end) + m_width(end)/2.0))/(2*constants::pi*m_conductivity(end) )
-        + 1.0/(m_ro(end)*2.0*constants::pi*k0N)
-    , -1); // heat transfer coefficient for last, outer shell
+    // heat transfer coefficient for last, outer shell
+    const double hN = coefficients.outerHeatTransferCoefficient(m_index);
 
     // Fill last row of A and b
     // this is the last line of eq. (2.26)
     uword i = size();
-    bt(i) = hN + m_heatTransferCoefficient(i-2) + factor(i-1); // Diagonal
-    at(i) = -m_heatTransferCoefficient(i-2); // Left of diagonal
-    rt(i) = factor(i-1)*shellTemperature(i-1) + hN*ambientTemperature;
+    bt(i) = hN + k(i-2) + factor(i-1); // Diagonal
+    at(i) = -k(i-2); // Left of diagonal
+    rt(i) = factor(i-1)*shellTemperature[i-1] + hN*ambientTemperature;
 
     // Solve Ax = b
     vec x = utils::tridag(at, bt, ct, rt, size()+1);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <armadillo>
 
 #include "heattransfer/radial.hpp"
@@ -11,7 +12,7 @@
  *  - <a href="10.1016/j.apm.2009.07.017">Sensitivity of pipeline gas flow model to the selection of the equation of state</a>
  *  - <a href="10.1016/j.cherd.2009.06.008">Transient flow in natural gas pipeline - The effect of pipeline thermal model</a>
  */
-class UnsteadyHeatTransfer : public RadialHeatTransfer
+class UnsteadyHeatTransfer final : public RadialHeatTransfer
 {
 public:
     /*!
@@ -81,6 +82,34 @@ public:
             const double gasHeatCapacity,
             const double gasViscosity) const;
 
+    /*!
+     * \brief As evaluateInternal(), but reads the current shell temperatures
+     * from, and writes the new ones to, the caller's memory, so the state of
+     * a grid point can be updated in place (see HeatTransferStateMatrix).
+     *
+     * \param shellTemperature The size() temperatures of the discretization layers [K]
+     * \param timeStep Time step [s]
+     * \param ambientTemperature Ambient temperature [K]
+     * \param gasPressure Gas pressure [Pa]
+     * \param gasTemperature Gas temperature [K]
+     * \param gasReynoldsNumber Reynolds number of gas [-]
+     * \param gasHeatCapacity Gas heat capacity (\f$c_p\f$) [J/(kg K)]
+     * \param gasViscosity Gas dynamic viscosity [Pa s] = [kg/m*s]
+     * \param newShellTemperature Output size() new temperatures [K]. May be
+     * the same memory as shellTemperature, and is not written if this throws.
+     * \return New heat flux [W/m2]
+     */
+    double evaluateInto(
+            const double* shellTemperature,
+            const double timeStep,
+            const double ambientTemperature,
+            const double gasPressure,
+            const double gasTemperature,
+            const double gasReynoldsNumber,
+            const double gasHeatCapacity,
+            const double gasViscosity,
+            double* newShellTemperature) const;
+
     /*!
      * \brief Thermalize the unsteady heat transfer model to steady state.
      *
@@ -105,15 +134,49 @@ public:
             const double gasViscosity) const;
 
 private:
-    //! Heat transfer coefficient for each discretization layer.
-    //! This is the k_i from eq. (2.26) in JFH PhD thesis.
-    arma::vec m_heatTransferCoefficient;
+    //! Shares the coefficients of the grid points.
+    friend class UnsteadyHeatTransferBatch;
+
+    /*!
+     * \brief The parts of eq. (2.26) in JFH PhD thesis that don't depend on
+     * the gas or the time step, for one or more grid points, with one row per
+     * grid point and one column per discretization layer.
+     *
+     * An instance made on its own owns a single row. UnsteadyHeatTransferBatch
+     * gathers the rows of all the grid points into one Coefficients, and
+     * points each instance to its row there, so the coefficients are only
+     * stored once.
+     */
+    struct Coefficients
+    {
+        arma::vec diameter;    //!< Pipe inner diameter [m]
+        arma::vec innerRadius; //!< Inner radius of the first shell [m]
+
+        //! Thermal resistance of the inner half of the first layer [m K/W].
+        //! Combined with the inner film coefficient to get h_w in eq. (2.26).
+        arma::vec innerShellResistance;
+
+        //! Heat transfer coefficient between the outermost layer and the
+        //! surroundings, including the outer film coefficient [W/(m K)].
+        //! This is h_N in eq. (2.26).
+        arma::vec outerHeatTransferCoefficient;
+
+        //! Heat transfer coefficient for each discretization layer [W/(m K)].
+        //! This is the k_i from eq. (2.26).
+        arma::mat heatTransferCoefficient;
+
+        //! Mass times heat capacity of each discretization layer [J/(m K)]
+        arma::mat thermalMass;
+    };
+
+    std::shared_ptr<const Coefficients> m_coefficients; //!< Coefficients, shared with the batch if any
+    arma::uword m_index; //!< Row of this grid point in m_coefficients
 
     /*!
      * \brief Internal (private) method used for solving the equations in the 1d
      * radial unsteady heat transfer model.
      *
-     * \param shellTemperature The temperature of each discretization layer [K]
+     * \param shellTemperature The size() temperatures of the discretization layers [K]
      * \param timeStep Time step [s]
      * \param ambientTemperature Ambient temperature [K]
      * \param gasPressure Gas pressure [Pa]
@@ -124,7 +187,7 @@ private:
      * \return HeatTransferState with new heat flux.
      */
     arma::vec solveEquations(
-            const arma::vec& shellTemperature,
+            const double* shellTemperature,
             const double timeStep,
             const double gasPressure,
             const double gasTemperature,
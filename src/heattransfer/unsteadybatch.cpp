@@ -0,0 +1,199 @@
+#include "heattransfer/unsteadybatch.hpp"
+
+#include <cmath>
+
+#include "heattransfer/unsteady.hpp"
+#include "heattransfer/utils.hpp"
+#include "utilities/threadpool.hpp"
+#include "utilities/errors.hpp"
+#include "constants.hpp"
+
+using arma::uword;
+using arma::vec;
+using arma::mat;
+using std::pow;
+
+UnsteadyHeatTransferBatch::UnsteadyHeatTransferBatch(std::vector<UnsteadyHeatTransfer>& heat)
+{
+    const uword n = heat.size();
+    const uword layers = n > 0 ? heat.front().size() : 0;
+    if (n > 0 && layers < 2)
+        throw std::invalid_argument("UnsteadyHeatTransferBatch requires at least two layers");
+
+    auto coefficients = std::make_shared<UnsteadyHeatTransfer::Coefficients>();
+    coefficients->diameter.set_size(n);
+    coefficients->innerRadius.set_size(n);
+    coefficients->innerShellResistance.set_size(n);
+    coefficients->outerHeatTransferCoefficient.set_size(n);
+    coefficients->heatTransferCoefficient.set_size(n, layers);
+    coefficients->thermalMass.set_size(n, layers);
+
+    for (uword i = 0; i < n; i++)
+    {
+        const UnsteadyHeatTransfer& h = heat.at(i);
+        if (h.size() != layers)
+            throw std::invalid_argument("UnsteadyHeatTransferBatch requires the same number of layers at each grid point");
+
+        const UnsteadyHeatTransfer::Coefficients& c = *h.m_coefficients;
+        const uword row = h.m_index;
+        coefficients->diameter(i) = c.diameter(row);
+        coefficients->innerRadius(i) = c.innerRadius(row);
+        coefficients->innerShellResistance(i) = c.innerShellResistance(row);
+        coefficients->outerHeatTransferCoefficient(i) = c.outerHeatTransferCoefficient(row);
+        coefficients->heatTransferCoefficient.row(i) = c.heatTransferCoefficient.row(row);
+        coefficients->thermalMass.row(i) = c.thermalMass.row(row);
+    }
+
+    // point each instance to its row, which releases its own copy
+    for (uword i = 0; i < n; i++)
+    {
+        heat[i].m_coefficients = coefficients;
+        heat[i].m_index = i;
+    }
+
+    m_coefficients = std::move(coefficients);
+}
+
+void UnsteadyHeatTransferBatch::setThreadPool(std::shared_ptr<utils::ThreadPool> threadPool)
+{
+    m_threadPool = std::move(threadPool);
+}
+
+void UnsteadyHeatTransferBatch::evaluate(
+        const mat& shellTemperature,
+        const double timeStep,
+        const vec& ambientTemperature,
+        const vec& pressure,
+        const vec& temperature,
+        const vec& reynoldsNumber,
+        const vec& heatCapacity,
+        const vec& viscosity,
+        vec& heatFlux,
+        mat& newShellTemperature) const
+{
+    const uword n = size();
+    const uword m = layers();
+    if (shellTemperature.n_rows != m || shellTemperature.n_cols != n)
+        throw std::runtime_error("incompatible size");
+
+    const vec& diameter = m_coefficients->diameter;
+    const vec& innerRadius = m_coefficients->innerRadius;
+    const vec& innerShellResistance = m_coefficients->innerShellResistance;
+    const mat& heatTransferCoefficient = m_coefficients->heatTransferCoefficient;
+    const mat& thermalMass = m_coefficients->thermalMass;
+
+    // This is the same system of equations as in
+    // UnsteadyHeatTransfer::solveEquations(), with row 0 for the heat flux and
+    // row j for layer j - 1, solved with the same algorithm as utils::tridag().
+    // Each column of u and gam holds one row of the system for all grid points.
+    const mat current = shellTemperature.t();
+
+    mat u(n, m + 1);
+    mat gam(n, m + 1);
+    vec hw(n);
+    vec bet(n);
+    vec c(n); // right of diagonal in the previous row
+
+    // the grid points are independent, so ranges of grid points can be
+    // solved in parallel, each with the loop over layers outside
+    const auto solveRange = [&](const uword begin, const uword end)
+    {
+        // Heat equation, first part of eq. (2.26) in JFH thesis
+        for (uword i = begin; i < end; i++)
+        {
+            const double hi = utils::calcInnerWallFilmCoefficient(
+                        diameter(i), pressure(i), reynoldsNumber(i), heatCapacity(i), viscosity(i));
+            hw(i) = pow(1.0/(2.0*constants::pi*innerRadius(i)*hi) + innerShellResistance(i), -1);
+
+            c(i) = hw(i)/(constants::pi*diameter(i));
+            bet(i) = 1;
+            u(i, 0) = temperature(i)*hw(i)/(constants::pi*diameter(i));
+        }
+
+        // Pipe layer 1, second line of eq. (2.26)
+        {
+            const double* k = heatTransferCoefficient.colptr(0);
+            const double* C = thermalMass.colptr(0);
+            const double* T = current.colptr(0);
+            double* g = gam.colptr(1);
+            double* x = u.colptr(1);
+            for (uword i = begin; i < end; i++)
+            {
+                const double f = C[i]/timeStep;
+                g[i] = c(i)/bet(i);
+                bet(i) = f + hw(i) + k[i];
+                x[i] = (f*T[i] + hw(i)*temperature(i))/bet(i);
+                c(i) = -k[i];
+            }
+        }
+
+        // Inner layers, third line of eq. (2.26)
+        for (uword j = 2; j < m; j++)
+        {
+            const double* k = heatTransferCoefficient.colptr(j - 1);
+            const double* kPrevious = heatTransferCoefficient.colptr(j - 2);
+            const double* C = thermalMass.colptr(j - 1);
+            const double* T = current.colptr(j - 1);
+            const double* xPrevious = u.colptr(j - 1);
+            double* g = gam.colptr(j);
+            double* x = u.colptr(j);
+            for (uword i = begin; i < end; i++)
+            {
+                const double f = C[i]/timeStep;
+                const double a = -kPrevious[i];
+                g[i] = c(i)/bet(i);
+                bet(i) = k[i] + kPrevious[i] + f - a*g[i];
+                x[i] = (f*T[i] - a*xPrevious[i])/bet(i);
+                c(i) = -k[i];
+            }
+        }
+
+        // Outermost layer, last line of eq. (2.26)
+        {
+            const double* kPrevious = heatTransferCoefficient.colptr(m - 2);
+            const double* C = thermalMass.colptr(m - 1);
+            const double* T = current.colptr(m - 1);
+            const double* xPrevious = u.colptr(m - 1);
+            const double* hN = m_coefficients->outerHeatTransferCoefficient.memptr();
+            double* g = gam.colptr(m);
+            double* x = u.colptr(m);
+            for (uword i = begin; i < end; i++)
+            {
+                const double f = C[i]/timeStep;
+                const double a = -kPrevious[i];
+                g[i] = c(i)/bet(i);
+                bet(i) = hN[i] + kPrevious[i] + f - a*g[i];
+                x[i] = (f*T[i] + hN[i]*ambientTemperature(i) - a*xPrevious[i])/bet(i);
+            }
+        }
+
+        // Backsubstitution
+        for (uword j = m; j-- > 0;)
+        {
+            const double* g = gam.colptr(j + 1);
+            const double* xNext = u.colptr(j + 1);
+            double* x = u.colptr(j);
+            for (uword i = begin; i < end; i++)
+            {
+                x[i] -= g[i]*xNext[i];
+            }
+        }
+    };
+
+    if (m_threadPool)
+    {
+        m_threadPool->parallelFor(n, solveRange);
+    }
+    else
+    {
+        solveRange(0, n);
+    }
+
+    if (arma::any(arma::vectorise(u.tail_cols(m)) < 0))
+    {
+        throw utils::temperature_range_error("wall layer temperature less than 0 K");
+    }
+
+    heatFlux = u.col(0);
+    newShellTemperature = u.tail_cols(m).t();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <armadillo>
+
+#include "heattransfer/unsteady.hpp"
+
+namespace utils { class ThreadPool; }
+
+/*!
+ * \brief Evaluates the 1d radial unsteady heat transfer model of
+ * UnsteadyHeatTransfer for all grid points at once.
+ *
+ * The shell data of all the grid points is stored in matrices with one row
+ * per grid point and one column per discretization layer, and the tridiagonal
+ * systems of all the grid points are solved together, with the loop over
+ * layers outside and the loop over grid points inside. This gives the same
+ * result as UnsteadyHeatTransfer::evaluate() for each grid point, but the
+ * inner loops run over contiguous memory, and there are no allocations per
+ * grid point.
+ *
+ * The matrices are the only copy of the shell data. On construction the
+ * UnsteadyHeatTransfer instances are pointed to their rows, and their own
+ * copies are released, so batching does not add memory per grid point.
+ *
+ * All the grid points must have the same number of discretization layers.
+ */
+class UnsteadyHeatTransferBatch
+{
+public:
+    /*!
+     * \brief Construct from the UnsteadyHeatTransfer instance of each grid
+     * point, and share the shell data with the instances.
+     *
+     * Throws std::invalid_argument if the instances don't have the same number
+     * of discretization layers, or have less than two layers. The instances
+     * are only modified if this succeeds. They give the same results as
+     * before, and are still valid if the batch is destroyed.
+     *
+     * \param heat UnsteadyHeatTransfer instance of each grid point
+     */
+    explicit UnsteadyHeatTransferBatch(std::vector<UnsteadyHeatTransfer>& heat);
+
+    //! Number of grid points
+    arma::uword size() const { return m_coefficients->diameter.n_elem; }
+
+    //! Number of discretization layers of each grid point
+    arma::uword layers() const { return m_coefficients->heatTransferCoefficient.n_cols; }
+
+    /*!
+     * \brief Set the thread pool used to solve ranges of grid points in
+     * parallel.
+     * \param threadPool Thread pool, shared with the owner. Grid points are
+     * solved serially if nullptr (default).
+     */
+    void setThreadPool(std::shared_ptr<utils::ThreadPool> threadPool);
+
+    /*!
+     * \brief Evaluate the unsteady heat transfer model for all grid points.
+     *
+     * Throws utils::temperature_range_error if any of the new shell
+     * temperatures are less than 0 K.
+     *
+     * \param shellTemperature Temperature of each layer (rows) of each grid point (columns) [K]
+     * \param timeStep Time step [s]
+     * \param ambientTemperature Ambient temperature [K]
+     * \param gasPressure Gas pressure [Pa]
+     * \param gasTemperature Gas temperature [K]
+     * \param gasReynoldsNumber Reynolds number of gas [-]
+     * \param gasHeatCapacity Gas heat capacity (\f$c_p\f$) [J/(kg K)]
+     * \param gasViscosity Gas dynamic viscosity [Pa s] = [kg/m*s]
+     * \param heatFlux Output heat flux of each grid point [W/m2]
+     * \param newShellTemperature Output temperature of each layer (rows) of each grid point (columns) [K]
+     */
+    void evaluate(
+            const arma::mat& shellTemperature,
+            const double timeStep,
+            const arma::vec& ambientTemperature,
+            const arma::vec& gasPressure,
+            const arma::vec& gasTemperature,
+            const arma::vec& gasReynoldsNumber,
+            const arma::vec& gasHeatCapacity,
+            const arma::vec& gasViscosity,
+            arma::vec& heatFlux,
+            arma::mat& newShellTemperature) const;
+
+private:
+    //! Shell data of all grid points, shared with the UnsteadyHeatTransfer instances
+    std::shared_ptr<const UnsteadyHeatTransfer::Coefficients> m_coefficients;
+
+    std::shared_ptr<utils::ThreadPool> m_threadPool; //!< Thread pool used to solve grid points in parallel
+};
@@ -6,6 +6,7 @@
 #include "pipeline.hpp"
 #include "solver/boundaryconditions.hpp"
 #include "utilities/physics.hpp"
+#include "utilities/threadpool.hpp"
 #include "equationofstate/equationofstate.hpp"
 #include "equationofstate/equationofstatebase.hpp"
 #include "equationofstate/bwrs.hpp"
@@ -13,13 +14,12 @@
 #include "equationofstate/idealgas.hpp"
 #include "equationofstate/dummygas.hpp"
 #include "heattransfer/heattransferbase.hpp"
-#include "heattransfer/radial.hpp"
-#include "heattransfer/unsteady.hpp"
 
 using std::cout;
 using std::endl;
 using std::vector;
 using std::make_unique;
+using std::make_shared;
 using std::unique_ptr;
 using arma::uword;
 using arma::mat;
@@ -31,23 +31,35 @@ Physics::~Physics()
 Physics::Physics(
         const Pipeline& state,
         const Config& config):
-    Physics(state, config.equationOfState, config.heatTransfer)
-{}
+    m_threadPool(make_shared<utils::ThreadPool>(config.threads)),
+    m_eos(make_unique<EquationOfState>(state, config)),
+    m_heat(make_unique<HeatTransfer>(state, config.heatTransfer))
+{
+    m_eos->setThreadPool(m_threadPool);
+    m_heat->setThreadPool(m_threadPool);
+}
 
 Physics::Physics(
         const Pipeline& state,
         const std::string& eos,
         const std::string& heat):
+    m_threadPool(make_shared<utils::ThreadPool>(1)),
     m_eos(make_unique<EquationOfState>(state, eos)),
     m_heat(make_unique<HeatTransfer>(state, heat))
 {}
 
+uword Physics::threads() const
+{
+    return m_threadPool->size();
+}
+
 void Physics::updateDerivedProperties(Pipeline& state) const
 {
     // calculate derived properties based on current pressure, temperature and composition
 
     // evaluate equation of state
-    mat out = m_eos->evaluate(state);
+    m_eos->evaluate(state, m_eosOutput);
+    const mat& out = m_eosOutput;
 
     state.compressibilityFactor() = out.col(0);
 
@@ -68,24 +80,36 @@ void Physics::updateDerivedProperties(Pipeline& state) const
     state.velocity() = state.flow()/(state.density() % state.diameter());
 
     // this isn't technically a derived property, but...
-    state.frictionFactor() =
-            utils::calculateColebrookWhiteFrictionFactor(
-                state.roughness(), state.diameter(), state.reynoldsNumber());
+    const vec& roughness = state.roughness();
+    const vec& diameter = state.diameter();
+    const vec& reynoldsNumber = state.reynoldsNumber();
+    vec& frictionFactor = state.frictionFactor();
+    frictionFactor.set_size(state.size());
+    m_threadPool->parallelFor(state.size(), [&](const uword begin, const uword end)
+    {
+        for (uword i = begin; i < end; i++)
+        {
+            frictionFactor(i) = utils::calculateColebrookWhiteFrictionFactor(roughness(i), diameter(i), reynoldsNumber(i));
+        }
+    });
 }
 
 void Physics::initializeHeatTransferState(Pipeline& state) const
 {
-    vector<HeatTransferState> heatTransferState;
-    for (uword i = 0; i < m_heat->size(); i++)
+    // each grid point only writes its own element
+    vector<HeatTransferState> heatTransferState(m_heat->size());
+    m_threadPool->parallelFor(m_heat->size(), [&](const uword begin, const uword end)
     {
-        heatTransferState.push_back(
-                    m_heat->at(i).makeState(
+        for (uword i = begin; i < end; i++)
+        {
+            heatTransferState[i] = m_heat->at(i).makeState(
                         state.heatFlow()(i),
                         state.ambientTemperature()(i),
-                        state.temperature()(i)));
-    }
+                        state.temperature()(i));
+        }
+    });
 
-    state.heatTransferState() = heatTransferState;
+    state.heatTransferState() = HeatTransferStateMatrix(heatTransferState);
     state.heatTransferIsInitialized() = true;
 }
 
@@ -94,32 +118,5 @@ void Physics::thermalizeHeatTransfer(Pipeline& pipeline) const
     if (!pipeline.heatTransferIsInitialized())
         throw std::runtime_error("heat transfer not initialized");
 
-    vector<HeatTransferState> heatTransferState;
-    arma::vec heatFlow(m_heat->size());
-    for (uword i = 0; i < m_heat->size(); i++)
-    {
-        // only possible for Unsteady
-        const UnsteadyHeatTransfer* heat = dynamic_cast<const UnsteadyHeatTransfer*>(&m_heat->at(i));
-        if (heat)
-        {
-            HeatTransferState state = heat->thermalizeToSteadyState(
-                pipeline.ambientTemperature()(i),
-                pipeline.pressure()(i),
-                pipeline.temperature()(i),
-                pipeline.reynoldsNumber()(i),
-                pipeline.heatCapacityConstantPressure()(i),
-                pipeline.viscosity()(i));
-            heatTransferState.push_back(state);
-            heatFlow(i) = state.heatFlux();
-        }
-        else
-        {
-            // just copy existing state if not Unsteady
-            heatTransferState.push_back(pipeline.heatTransferState().at(i));
-            heatFlow(i) = pipeline.heatTransferState().at(i).heatFlux();
-        }
-    }
-
-    pipeline.heatTransferState() = heatTransferState;
-    pipeline.heatFlow() = heatFlow;
+    m_heat->thermalize(pipeline);
 }
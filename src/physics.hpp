@@ -9,6 +9,7 @@
 
 class Pipeline;
 class EquationOfState;
+namespace utils { class ThreadPool; }
 
 /*!
  * \brief The Physics class combines EquationOfState and HeatTransfer to
@@ -26,6 +27,10 @@ public:
 
     /*!
      * \brief Construct from Config and Pipeline.
+     *
+     * Config::threads sets the number of threads used by
+     * updateDerivedProperties().
+     *
      * \param state Pipeline instance
      * \param config Config instance
      */
@@ -48,6 +53,11 @@ public:
     /*!
      * \brief Updates all derived properties, but does not evaluate the heat
      * transfer.
+     *
+     * The equation of state and the friction factor are evaluated for ranges
+     * of grid points in parallel, if more than one thread is used (see
+     * Config::threads).
+     *
      * \param state Pipeline state to update
      */
     void updateDerivedProperties(
@@ -74,7 +84,14 @@ public:
     //! Get (const ref) HeatTransfer
     const HeatTransfer& heatTransfer() const { return *m_heat; }
 
+    //! Number of threads used by updateDerivedProperties() and for heat transfer
+    arma::uword threads() const;
+
 private:
+    std::shared_ptr<utils::ThreadPool> m_threadPool; //!< Threads shared by the equation of state and heat transfer
     std::unique_ptr<EquationOfState> m_eos; //!< Equation of state
     std::unique_ptr<HeatTransfer> m_heat; //!< Heat transfer
+
+    //! Buffer for the output of EquationOfState::evaluate(), reused between calls
+    mutable arma::mat m_eosOutput;
 };
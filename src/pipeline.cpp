@@ -156,7 +156,7 @@ Pipeline::State::State(const arma::vec& gridPoints):
     m_ambientTemperature(zeros<vec>(gridPoints.n_elem)),
     m_heatFlow(zeros<vec>(gridPoints.n_elem)),
 
-    m_heatTransferState(gridPoints.n_elem, HeatTransferState()),
+    m_heatTransferState(gridPoints.n_elem),
     m_heatTransferIsInitialized(false),
 
     m_batchTrackingState(gridPoints, m_composition),
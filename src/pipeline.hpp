@@ -9,6 +9,7 @@
 #include "heattransfer/burialmedium.hpp"
 #include "heattransfer/ambientfluid.hpp"
 #include "heattransfer/heattransferbase.hpp"
+#include "heattransfer/heattransferstatematrix.hpp"
 #include "advection/batchtrackingstate.hpp"
 
 class BoundaryConditions;
@@ -63,7 +64,7 @@ public:
         const arma::vec& ambientTemperature() const             { return m_ambientTemperature; }
         const arma::vec& heatFlow() const                       { return m_heatFlow; }
 
-//        const std::vector<HeatTransferState>& heatTransferState() const { return m_heatTransferState; }
+//        const HeatTransferStateMatrix& heatTransferState() const { return m_heatTransferState; }
 //        const BatchTrackingState& batchTrackingState() const  { return m_batchTrackingState; }
 //        bool batchTrackingIsInitialized() const                 { return m_batchTrackingIsInitialized; }
 
@@ -94,7 +95,7 @@ public:
 //        arma::vec& ambientTemperature()             { return m_ambientTemperature; }
 //        arma::vec& heatFlow()                       { return m_heatFlow; }
 
-//        std::vector<HeatTransferState>& heatTransferState() { return m_heatTransferState; }
+//        HeatTransferStateMatrix& heatTransferState() { return m_heatTransferState; }
 //        BatchTrackingState& batchTrackingState()  { return m_batchTrackingState; }
 //        bool& batchTrackingIsInitialized()          { return m_batchTrackingIsInitialized; }
 
@@ -147,7 +148,7 @@ public:
         arma::vec m_ambientTemperature; //!< Ambient temperature [K]
         arma::vec m_heatFlow; //!< Heat flow q [W/m2]
 
-        std::vector<HeatTransferState> m_heatTransferState; //!< Heat transfer state
+        HeatTransferStateMatrix m_heatTransferState; //!< Heat transfer state
         bool m_heatTransferIsInitialized; //!< If heat transfer is initialized
 
         BatchTrackingState m_batchTrackingState; //!< Batch tracking state
@@ -222,7 +223,7 @@ public:
     const arma::vec& ambientTemperature() const             { return prop().m_ambientTemperature; }
     const arma::vec& heatFlow() const                       { return prop().m_heatFlow; }
 
-    const std::vector<HeatTransferState>& heatTransferState() const { return prop().m_heatTransferState; }
+    const HeatTransferStateMatrix& heatTransferState() const { return prop().m_heatTransferState; }
     bool heatTransferIsInitialized() const                  { return prop().m_heatTransferIsInitialized; }
 
     const BatchTrackingState& batchTrackingState() const    { return prop().m_batchTrackingState; }
@@ -275,7 +276,7 @@ public:
     arma::vec& ambientTemperature()             { return prop().m_ambientTemperature; }
     arma::vec& heatFlow()                       { return prop().m_heatFlow; }
 
-    std::vector<HeatTransferState>& heatTransferState() { return prop().m_heatTransferState; }
+    HeatTransferStateMatrix& heatTransferState() { return prop().m_heatTransferState; }
     bool& heatTransferIsInitialized()           { return prop().m_heatTransferIsInitialized; }
 
     BatchTrackingState& batchTrackingState()    { return prop().m_batchTrackingState; }
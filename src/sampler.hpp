@@ -107,6 +107,9 @@ public:
     //! Get (const ref) output directory.
     const std::filesystem::path& outputDir() const { return m_outputDir; }
 
+    //! Earliest time of the next sample [s]
+    arma::uword nextSampleTime() const { return m_timeOfLastPrint + m_printInterval; }
+
     //! Automatically determines property label from Pipeline getter function
     //! pointer.
     static std::string getSampleLabel(PropertyGetter samplingFunction);
@@ -1,6 +1,8 @@
 #include "simulator.hpp"
 
+#include <algorithm>
 #include <cmath>
+#include <iostream>
 #include <stdexcept>
 
 #include "solver/discretizer/enthalpy.hpp"
@@ -8,6 +10,7 @@
 #include "solver/boundaryconditions.hpp"
 #include "solver/solver.hpp"
 #include "timeseries.hpp"
+#include "utilities/errors.hpp"
 
 Simulator::Simulator(const Pipeline& pipeline, const Config& config):
     m_state(std::make_unique<Pipeline>(pipeline)),
@@ -15,6 +18,9 @@ Simulator::Simulator(const Pipeline& pipeline, const Config& config):
     m_solver(std::make_unique<Solver>(pipeline.size(), config)),
     m_sampler(makeSampler(config)) // optional
 {
+    if (config.adaptiveTimeStep)
+        enableAdaptiveTimeStep(config.minTimeStep, config.maxTimeStep, config.timeStepTolerance);
+
     m_physics->updateDerivedProperties(*m_state);
 
     m_physics->initializeHeatTransferState(*m_state);
@@ -39,6 +45,23 @@ Simulator::Simulator(
     m_state->initializeBatchTracking();
 }
 
+void Simulator::enableAdaptiveTimeStep(
+        const arma::uword minTimeStep,
+        const arma::uword maxTimeStep,
+        const double tolerance)
+{
+    if (minTimeStep == 0 || maxTimeStep < minTimeStep)
+        throw std::invalid_argument("invalid time step limits");
+    if (tolerance <= 0)
+        throw std::invalid_argument("tolerance");
+
+    m_adaptiveTimeStep = true;
+    m_minTimeStep = minTimeStep;
+    m_maxTimeStep = maxTimeStep;
+    m_timeStepTolerance = tolerance;
+    m_timeStep = 0;
+}
+
 void Simulator::enableBatchTracking()
 {
     m_state->enableBatchTracking();
@@ -59,6 +82,9 @@ std::optional<Sampler> Simulator::makeSampler(const Config& config)
 arma::vec Simulator::simulate(const TimeSeries& ts)
 {
     const std::vector<BoundaryConditionsStamped> &timeSeries = ts; // user-defined cast
+    if (m_adaptiveTimeStep)
+        return simulateAdaptive(timeSeries);
+
     arma::vec nIterations(ts.size());
 
     if (m_sampler && m_state->timestamp() == 0)
@@ -100,3 +126,165 @@ arma::vec Simulator::simulate(const TimeSeries& ts)
 
     return nIterations;
 }
+
+namespace
+{
+
+//! Largest relative difference between the boundary values of a and b.
+double boundaryDifference(const BoundaryConditions& a, const BoundaryConditions& b)
+{
+    double difference = 0;
+    for (arma::uword i = 0; i < 3; i++)
+    {
+        // flow can be zero, so use a minimum scale of 1 kg/s
+        const double inletScale = std::max(std::abs(b.inlet(i).value()), 1.0);
+        const double outletScale = std::max(std::abs(b.outlet(i).value()), 1.0);
+        difference = std::max(difference, std::abs(a.inlet(i).value() - b.inlet(i).value())/inletScale);
+        difference = std::max(difference, std::abs(a.outlet(i).value() - b.outlet(i).value())/outletScale);
+    }
+    return difference;
+}
+
+//! Flow, pressure and temperature stacked, each scaled to order one.
+arma::vec scaledState(const Pipeline& state, const Pipeline& reference)
+{
+    const double flowScale = std::max(arma::max(arma::abs(reference.flow())), 1.0);
+    return arma::join_cols(
+                arma::join_cols(state.flow()/flowScale, state.pressure()/reference.pressure()),
+                state.temperature()/reference.temperature());
+}
+
+} // end anonymous namespace
+
+arma::vec Simulator::simulateAdaptive(const std::vector<BoundaryConditionsStamped>& timeSeries)
+{
+    arma::vec nIterations = arma::zeros<arma::vec>(timeSeries.size());
+    if (timeSeries.empty())
+        return nIterations;
+
+    if (m_sampler && m_state->timestamp() == 0)
+    {
+        m_sampler->sample(*m_state);
+    }
+
+    // same sanity checks of the timestamps as with fixed time steps
+    for (std::size_t i = 0; i < timeSeries.size(); i++)
+    {
+        const arma::uword previous = i == 0 ? m_state->timestamp() : timeSeries.at(i - 1).timestamp();
+        if (timeSeries.at(i).timestamp() < previous)
+            throw std::runtime_error("negative time step, likely error with timestamps");
+        if (timeSeries.at(i).timestamp() - previous > 24*60*60)
+            throw std::runtime_error("time step larger than 24 hours, likely error with timestamps");
+    }
+
+    // boundary conditions at the start of the simulation
+    const BoundaryConditionsStamped start(m_state->timestamp(), BoundaryConditions(*m_state));
+
+    // boundary conditions at any time in the time series
+    const auto boundaryConditionsAt = [&](const std::size_t row, const arma::uword timestamp) {
+        const BoundaryConditionsStamped& lower = row == 0 ? start : timeSeries.at(row - 1);
+        return BoundaryConditionsStamped::interpolate(lower, timeSeries.at(row), timestamp);
+    };
+
+    if (m_timeStep == 0)
+    {
+        const arma::uword firstStep = timeSeries.front().timestamp() - m_state->timestamp();
+        m_timeStep = std::clamp(firstStep, m_minTimeStep, m_maxTimeStep);
+    }
+
+    arma::vec previousChange;
+    arma::uword previousStep = 0;
+
+    const arma::uword end = timeSeries.back().timestamp();
+    std::size_t row = 0; // first row with timestamp after current time
+    while (m_state->timestamp() < end)
+    {
+        const arma::uword time = m_state->timestamp();
+        while (timeSeries.at(row).timestamp() <= time)
+            row++;
+
+        arma::uword nextTime = std::min(time + m_timeStep, end);
+        if (m_sampler)
+            nextTime = std::min(nextTime, std::max(m_sampler->nextSampleTime(), time + 1));
+
+        // don't step past rows that are not well described by linear
+        // interpolation, like sharp transients
+        std::size_t nextRow = row;
+        while (timeSeries.at(nextRow).timestamp() < nextTime)
+            nextRow++;
+        const BoundaryConditionsStamped current = boundaryConditionsAt(row, time);
+        const BoundaryConditionsStamped next = boundaryConditionsAt(nextRow, nextTime);
+        for (std::size_t i = row; i < nextRow; i++)
+        {
+            const BoundaryConditionsStamped interpolated = BoundaryConditionsStamped::interpolate(current, next, timeSeries.at(i).timestamp());
+            if (boundaryDifference(interpolated, timeSeries.at(i)) > m_timeStepTolerance)
+            {
+                nextTime = timeSeries.at(i).timestamp();
+                nextRow = i;
+                break;
+            }
+        }
+        const BoundaryConditionsStamped bc = boundaryConditionsAt(nextRow, nextTime);
+        const arma::uword step = nextTime - time;
+
+        Pipeline output;
+        bool converged = true;
+        try
+        {
+            output = m_solver->solveWithIterations(step, *m_state, bc, *m_physics);
+        }
+        catch (const utils::no_convergence_error& e)
+        {
+            converged = false;
+            if (step > m_minTimeStep)
+            {
+                m_solver->rejectLastState();
+                m_timeStep = std::max(step/2, m_minTimeStep);
+                continue; // retry with shorter step
+            }
+
+            // same as Solver::solve(), give up and keep the old state
+            std::cout << e.what() << std::endl;
+            output = *m_state;
+        }
+
+        // local error estimate, from how much the change over this step
+        // deviates from the change over the previous step (the leading
+        // truncation error of the implicit time discretization)
+        const arma::vec change = scaledState(output, *m_state) - scaledState(*m_state, *m_state);
+        double error = 0;
+        if (previousStep > 0)
+            error = 0.5*arma::max(arma::abs(change - previousChange*double(step)/previousStep));
+
+        if (converged && error > m_timeStepTolerance && step > m_minTimeStep)
+        {
+            m_solver->rejectLastState(); // keep the predictor history of accepted steps
+            m_timeStep = std::max(step/2, m_minTimeStep);
+            continue; // reject step
+        }
+
+        // accept step
+        *m_state = output;
+        m_state->timestamp() = nextTime;
+        nIterations(nextRow) += m_solver->nIterations();
+        previousChange = change;
+        previousStep = step;
+
+        if (m_sampler)
+        {
+            m_sampler->sample(*m_state);
+        }
+
+        // grow or shrink next step
+        double factor = error > 0 ? std::clamp(0.9*std::sqrt(m_timeStepTolerance/error), 0.5, 2.0) : 2.0;
+        if (!converged || m_solver->nIterations() > 10)
+            factor = std::min(factor, 0.5);
+
+        // steps shortened to hit a timestamp or sampling time should not
+        // limit the growth of the next step
+        const double base = factor < 1 ? step : std::max(step, m_timeStep);
+        m_timeStep = std::clamp<arma::uword>(std::lround(base*factor), m_minTimeStep, m_maxTimeStep);
+    }
+
+    return nIterations;
+}
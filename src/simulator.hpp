@@ -57,6 +57,26 @@ public:
      */
     arma::vec simulate(const TimeSeries& timeSeries);
 
+    /*!
+     * \brief Enable adaptive time steps in simulate().
+     *
+     * Instead of stepping exactly at the timestamps of the boundary
+     * conditions, the time step is increased while the state is
+     * quasi-steady, and reduced when the local error estimate exceeds the
+     * tolerance, the solver needs many iterations or does not converge.
+     * Boundary conditions are interpolated linearly between the timestamps,
+     * and steps never cross a timestamp where the boundary conditions deviate
+     * from this interpolation, or the next sampling time of the sampler.
+     *
+     * \param minTimeStep Smallest time step [s]
+     * \param maxTimeStep Largest time step [s]
+     * \param tolerance Tolerance of the local error estimate (relative)
+     */
+    void enableAdaptiveTimeStep(
+            const arma::uword minTimeStep = 10,
+            const arma::uword maxTimeStep = 3600,
+            const double tolerance = 1e-3);
+
     //! Enables batch tracking. Wrapper around Pipeline::enableBatchTracking().
     void enableBatchTracking();
 
@@ -84,10 +104,23 @@ private:
     std::unique_ptr<Solver> m_solver; //!< Solver instance, contains GoverningEquationSolver and BatchTracking
     std::optional<Sampler> m_sampler; //!< (Optional) sampler instance, for writing results to file during simulation
 
+    bool m_adaptiveTimeStep = false; //!< If simulate() uses adaptive time steps
+    arma::uword m_minTimeStep = 10; //!< Smallest adaptive time step [s]
+    arma::uword m_maxTimeStep = 3600; //!< Largest adaptive time step [s]
+    double m_timeStepTolerance = 1e-3; //!< Tolerance of the local error estimate
+    arma::uword m_timeStep = 0; //!< Current adaptive time step [s] (0 if not yet set)
+
     /*!
      * \brief Make optional Sampler instance. Returns empty optional if
      * config.outputPath is empty.
      * \return config Config instance
      */
     std::optional<Sampler> makeSampler(const Config& config);
+
+    /*!
+     * \brief Implementation of simulate() with adaptive time steps.
+     * \param timeSeries Boundary conditions with timestamps
+     * \return Number of iterations used to reach each timestamp
+     */
+    arma::vec simulateAdaptive(const std::vector<BoundaryConditionsStamped>& timeSeries);
 };
@@ -114,3 +114,29 @@ std::ostream& operator <<(std::ostream& out, const BoundaryConditions& c)
 
     return out;
 }
+
+BoundaryConditionsStamped BoundaryConditionsStamped::interpolate(
+        const BoundaryConditionsStamped& lower,
+        const BoundaryConditionsStamped& upper,
+        const arma::uword timestamp)
+{
+    if (upper.timestamp() <= lower.timestamp())
+        return BoundaryConditionsStamped(timestamp, upper);
+
+    const double w = (double(timestamp) - lower.timestamp())/(upper.timestamp() - lower.timestamp());
+    const auto value = [w](const SingleCondition& a, const SingleCondition& b) {
+        return SingleCondition((1 - w)*a.value() + w*b.value(), b.isActive());
+    };
+
+    return BoundaryConditionsStamped(
+                timestamp,
+                BoundaryConditions(
+                    value(lower.inletFlow(), upper.inletFlow()),
+                    value(lower.outletFlow(), upper.outletFlow()),
+                    value(lower.inletPressure(), upper.inletPressure()),
+                    value(lower.outletPressure(), upper.outletPressure()),
+                    value(lower.inletTemperature(), upper.inletTemperature()),
+                    value(lower.outletTemperature(), upper.outletTemperature()),
+                    Composition((1 - w)*lower.inletComposition().vec() + w*upper.inletComposition().vec()),
+                    Composition((1 - w)*lower.outletComposition().vec() + w*upper.outletComposition().vec())));
+}
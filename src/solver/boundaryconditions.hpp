@@ -319,6 +319,22 @@ public:
     //! Get (copy of) timestamp
     arma::uword timestamp() const { return m_timestamp; }
 
+    /*!
+     * \brief Linearly interpolate boundary conditions between two timestamps.
+     *
+     * Values and compositions are interpolated, while which conditions are
+     * active is taken from upper.
+     *
+     * \param lower Boundary conditions at the start of the interval
+     * \param upper Boundary conditions at the end of the interval
+     * \param timestamp Timestamp to interpolate to [s]
+     * \return Boundary conditions at timestamp
+     */
+    static BoundaryConditionsStamped interpolate(
+            const BoundaryConditionsStamped& lower,
+            const BoundaryConditionsStamped& upper,
+            const arma::uword timestamp);
+
 private:
     arma::uword m_timestamp; //!< Timestamp [s]
 };
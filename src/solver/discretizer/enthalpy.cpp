@@ -1,12 +1,11 @@
 #include "solver/discretizer/enthalpy.hpp"
 
+#include <cmath>
+
 #include "pipeline.hpp"
-#include "utilities/utilities.hpp"
 #include "constants.hpp"
 
 using arma::vec;
-using arma::zeros;
-using arma::span;
 using arma::uword;
 
 EnthalpyDiscretizer::EnthalpyDiscretizer(
@@ -60,104 +59,110 @@ void EnthalpyDiscretizer::discretizeFromPrimitives(
         const vec& guessFriction,
         const vec& guessHeatCapacityConstantPressure,
         const vec& guessHeatFlux,
-        const vec& guessDensity,
+        const vec& /*guessDensity*/, // not needed in the enthalpy form
         const vec& guessCompressibilityFactor,
         const vec& guess_dZdT_p,
         const vec& guess_dZdp)
 {
-    const uword nGridPoints = gridPoints.n_elem;
-    const uword n = nGridPoints;
-
-    const vec gasConstant           = utils::centerAverage(currentSpecificGasConstant);
-
-    const vec diameter              = utils::centerAverage(diameter_);
-    const vec crossSection          = constants::pi*pow(diameter/2.0, 2.0);
-    const vec dh                    = utils::centerDifference(height); // difference
-    const vec dx                    = utils::centerDifference(gridPoints); // difference
-
-    const vec friction_             = utils::centerAverage(guessFriction);
-    const vec heatCapacityAtConstantPressure_ = utils::centerAverage(guessHeatCapacityConstantPressure);
-    const vec heatTransfer_         = utils::centerAverage(guessHeatFlux);
-    const vec rho_                  = utils::centerAverage(guessDensity);
-
-    const vec massFlow_             = utils::centerAverage(guessMassFlow);
-    const vec pressure_             = utils::centerAverage(guessPressure);
-    const vec temperature_          = utils::centerAverage(guessTemperature);
-
-    const vec Z_                    = utils::centerAverage(guessCompressibilityFactor);
-    const vec dZdT_p_               = utils::centerAverage(guess_dZdT_p);
-    const vec dZdp_                 = utils::centerAverage(guess_dZdp);
+    const uword nSections = gridPoints.n_elem - 1;
 
     // indexing in term_i and term_ipp is (grid point, equation #, variable)
     // order of variables are m, p, T
     // order of equations are (continuity, momentum, energy)
 
-    uword col; // For indexing
-
-    // Common terms
-    const vec ZRToverpA             = Z_%gasConstant%temperature_/(pressure_%crossSection);
-
-    // Continuity equation
-    col = 0;
-    // Helgaker form
-    const vec c1c                   = 1.0/(1.0/pressure_ - (1.0/Z_)%dZdp_);
-    const vec c2c                   = 1.0/temperature_ + (1.0/Z_)%dZdT_p_;
-    const vec c3c                   = ZRToverpA;
-    m_term_i  .slice(0).col(col)    = - c1c%c3c/dx;
-    m_term_ipp.slice(0).col(col)    = + c1c%c3c/dx;
-    m_term_i  .slice(1).col(col)    = zeros<vec>(nGridPoints-1) + 1.0/(2.0*dt);
-    m_term_ipp.slice(1).col(col)    = zeros<vec>(nGridPoints-1) + 1.0/(2.0*dt);
-    m_term_i  .slice(2).col(col)    = - c1c%c2c/(2.0*dt);
-    m_term_ipp.slice(2).col(col)    = - c1c%c2c/(2.0*dt);
-    m_boundaryTerm.col(col) =
-            - c1c%c2c%(currentTemperature(span(1, n-1)) + currentTemperature(span(0, n-2)))/(2.0*dt)
-            + (currentPressure(span(1, n-1)) + currentPressure(span(0, n-2)))/(2.0*dt);
-
-    // Momentum equation
-    col = 1;
-    // Helgaker form
-    const vec c1m                   = massFlow_%ZRToverpA;
-    const vec c2m                   = massFlow_%(1.0/pressure_ - (1.0/Z_)%dZdp_);
-    const vec c3m                   = massFlow_%(1.0/temperature_ + (1.0/Z_)%dZdT_p_);
-    const vec c4m                   = friction_%arma::abs(massFlow_)/(2.0*diameter)%ZRToverpA;
-    const vec sinTheta              = dh/dx;
-    const vec c5m                   = crossSection/(Z_%gasConstant%temperature_)*m_gravity%sinTheta;
-    m_term_i  .slice(0).col(col)    = + ( 1.0/(2.0*dt) + c4m/2.0 ) - 2.0*c1m/dx;
-    m_term_ipp.slice(0).col(col)    = + ( 1.0/(2.0*dt) + c4m/2.0 ) + 2.0*c1m/dx;
-    m_term_i  .slice(1).col(col)    = - ( crossSection/dx - c1m%c2m/dx ) + c5m/2.0;
-    m_term_ipp.slice(1).col(col)    = + ( crossSection/dx - c1m%c2m/dx ) + c5m/2.0;
-    m_term_i  .slice(2).col(col)    = - c1m%c3m/dx;
-    m_term_ipp.slice(2).col(col)    = + c1m%c3m/dx;
-    m_boundaryTerm.col(col) =
-            (currentMassFlow(span(1, n-1)) + currentMassFlow(span(0, n-2)))/(2.0*dt);
-
-    // Energy equation
-    // Common terms
-    const vec oneMinusDZDp_T        = 1.0 - (pressure_/Z_)%dZdp_;
-    const vec onePlusDZDT_p         = 1.0 + (temperature_/Z_)%dZdT_p_;
-    const vec Vw2overZRT            = 1.0/( oneMinusDZDp_T - (Z_%gasConstant/heatCapacityAtConstantPressure_)%onePlusDZDT_p%onePlusDZDT_p );
-    const vec Vw2overT              = Vw2overZRT%Z_%gasConstant;
-    const vec Vw2                   = Vw2overZRT%Z_%gasConstant%temperature_;
-
-    // convert from Q/A_h = U*(T-T_a) [W/m2] to to 4*U/D*(T-T_a)
-    const vec actualHeatTransfer_   = 4*heatTransfer_/(diameter);
-
-    col = 2;
+    // Single pass over the grid sections, with all coefficients kept as
+    // scalars, so no temporary vectors are allocated. The values of each grid
+    // section are the averages of the values at the two adjacent grid points.
+    for (uword i = 0; i < nSections; i++)
     {
-        const vec c1                    = onePlusDZDT_p;
-        const vec c2                    = oneMinusDZDp_T;
-        const vec c3                    = ZRToverpA;
-        const vec c4                    = massFlow_%(1.0 + (Vw2overT/heatCapacityAtConstantPressure_)%c1%c1);
-        const vec c5                    = 1.0/(heatCapacityAtConstantPressure_%pressure_)%c2;
-        const vec c6                    = Vw2overT%actualHeatTransfer_;
-        const vec c7                    = Vw2%massFlow_%arma::abs(massFlow_)%(friction_/(2.0*diameter%crossSection))%c3%c3;
-        m_term_i  .slice(0).col(col)    = - Vw2/heatCapacityAtConstantPressure_%c1%c3/dx - c5%c7/2.0;
-        m_term_ipp.slice(0).col(col)    = + Vw2/heatCapacityAtConstantPressure_%c1%c3/dx - c5%c7/2.0;
-        m_term_i  .slice(1).col(col)    = + Vw2/heatCapacityAtConstantPressure_%c1%c3/pressure_%massFlow_%c2/dx;
-        m_term_ipp.slice(1).col(col)    = - Vw2/heatCapacityAtConstantPressure_%c1%c3/pressure_%massFlow_%c2/dx;
-        m_term_i  .slice(2).col(col)    = + 1.0/(2.0*dt) + c5%c6/2.0 - c3%c4/dx;
-        m_term_ipp.slice(2).col(col)    = + 1.0/(2.0*dt) + c5%c6/2.0 + c3%c4/dx;
-        m_boundaryTerm.col(col) =
-                + (currentTemperature(span(1, n-1)) + currentTemperature(span(0, n-2)))/(2.0*dt);
+        const uword j = i + 1;
+
+        const double gasConstant    = (currentSpecificGasConstant[i] + currentSpecificGasConstant[j])/2.0;
+
+        const double diameter       = (diameter_[i] + diameter_[j])/2.0;
+        const double crossSection   = constants::pi*std::pow(diameter/2.0, 2.0);
+        const double dh             = height[j] - height[i]; // difference
+        const double dx             = gridPoints[j] - gridPoints[i]; // difference
+
+        const double friction_      = (guessFriction[i] + guessFriction[j])/2.0;
+        const double heatCapacityAtConstantPressure_ = (guessHeatCapacityConstantPressure[i] + guessHeatCapacityConstantPressure[j])/2.0;
+        const double heatTransfer_  = (guessHeatFlux[i] + guessHeatFlux[j])/2.0;
+
+        const double massFlow_      = (guessMassFlow[i] + guessMassFlow[j])/2.0;
+        const double pressure_      = (guessPressure[i] + guessPressure[j])/2.0;
+        const double temperature_   = (guessTemperature[i] + guessTemperature[j])/2.0;
+
+        const double Z_             = (guessCompressibilityFactor[i] + guessCompressibilityFactor[j])/2.0;
+        const double dZdT_p_        = (guess_dZdT_p[i] + guess_dZdT_p[j])/2.0;
+        const double dZdp_          = (guess_dZdp[i] + guess_dZdp[j])/2.0;
+
+        uword col; // For indexing
+
+        // Common terms
+        const double ZRToverpA      = Z_*gasConstant*temperature_/(pressure_*crossSection);
+
+        // Continuity equation
+        col = 0;
+        // Helgaker form
+        const double c1c            = 1.0/(1.0/pressure_ - (1.0/Z_)*dZdp_);
+        const double c2c            = 1.0/temperature_ + (1.0/Z_)*dZdT_p_;
+        const double c3c            = ZRToverpA;
+        m_term_i  .at(i, col, 0)    = - c1c*c3c/dx;
+        m_term_ipp.at(i, col, 0)    = + c1c*c3c/dx;
+        m_term_i  .at(i, col, 1)    = 1.0/(2.0*dt);
+        m_term_ipp.at(i, col, 1)    = 1.0/(2.0*dt);
+        m_term_i  .at(i, col, 2)    = - c1c*c2c/(2.0*dt);
+        m_term_ipp.at(i, col, 2)    = - c1c*c2c/(2.0*dt);
+        m_boundaryTerm.at(i, col) =
+                - c1c*c2c*(currentTemperature[j] + currentTemperature[i])/(2.0*dt)
+                + (currentPressure[j] + currentPressure[i])/(2.0*dt);
+
+        // Momentum equation
+        col = 1;
+        // Helgaker form
+        const double c1m            = massFlow_*ZRToverpA;
+        const double c2m            = massFlow_*(1.0/pressure_ - (1.0/Z_)*dZdp_);
+        const double c3m            = massFlow_*(1.0/temperature_ + (1.0/Z_)*dZdT_p_);
+        const double c4m            = friction_*std::abs(massFlow_)/(2.0*diameter)*ZRToverpA;
+        const double sinTheta       = dh/dx;
+        const double c5m            = crossSection/(Z_*gasConstant*temperature_)*m_gravity*sinTheta;
+        m_term_i  .at(i, col, 0)    = + ( 1.0/(2.0*dt) + c4m/2.0 ) - 2.0*c1m/dx;
+        m_term_ipp.at(i, col, 0)    = + ( 1.0/(2.0*dt) + c4m/2.0 ) + 2.0*c1m/dx;
+        m_term_i  .at(i, col, 1)    = - ( crossSection/dx - c1m*c2m/dx ) + c5m/2.0;
+        m_term_ipp.at(i, col, 1)    = + ( crossSection/dx - c1m*c2m/dx ) + c5m/2.0;
+        m_term_i  .at(i, col, 2)    = - c1m*c3m/dx;
+        m_term_ipp.at(i, col, 2)    = + c1m*c3m/dx;
+        m_boundaryTerm.at(i, col) =
+                (currentMassFlow[j] + currentMassFlow[i])/(2.0*dt);
+
+        // Energy equation
+        // Common terms
+        const double oneMinusDZDp_T = 1.0 - (pressure_/Z_)*dZdp_;
+        const double onePlusDZDT_p  = 1.0 + (temperature_/Z_)*dZdT_p_;
+        const double Vw2overZRT     = 1.0/( oneMinusDZDp_T - (Z_*gasConstant/heatCapacityAtConstantPressure_)*onePlusDZDT_p*onePlusDZDT_p );
+        const double Vw2overT       = Vw2overZRT*Z_*gasConstant;
+        const double Vw2            = Vw2overZRT*Z_*gasConstant*temperature_;
+
+        // convert from Q/A_h = U*(T-T_a) [W/m2] to to 4*U/D*(T-T_a)
+        const double actualHeatTransfer_ = 4*heatTransfer_/(diameter);
+
+        col = 2;
+        {
+            const double c1             = onePlusDZDT_p;
+            const double c2             = oneMinusDZDp_T;
+            const double c3             = ZRToverpA;
+            const double c4             = massFlow_*(1.0 + (Vw2overT/heatCapacityAtConstantPressure_)*c1*c1);
+            const double c5             = 1.0/(heatCapacityAtConstantPressure_*pressure_)*c2;
+            const double c6             = Vw2overT*actualHeatTransfer_;
+            const double c7             = Vw2*massFlow_*std::abs(massFlow_)*(friction_/(2.0*diameter*crossSection))*c3*c3;
+            m_term_i  .at(i, col, 0)    = - Vw2/heatCapacityAtConstantPressure_*c1*c3/dx - c5*c7/2.0;
+            m_term_ipp.at(i, col, 0)    = + Vw2/heatCapacityAtConstantPressure_*c1*c3/dx - c5*c7/2.0;
+            m_term_i  .at(i, col, 1)    = + Vw2/heatCapacityAtConstantPressure_*c1*c3/pressure_*massFlow_*c2/dx;
+            m_term_ipp.at(i, col, 1)    = - Vw2/heatCapacityAtConstantPressure_*c1*c3/pressure_*massFlow_*c2/dx;
+            m_term_i  .at(i, col, 2)    = + 1.0/(2.0*dt) + c5*c6/2.0 - c3*c4/dx;
+            m_term_ipp.at(i, col, 2)    = + 1.0/(2.0*dt) + c5*c6/2.0 + c3*c4/dx;
+            m_boundaryTerm.at(i, col) =
+                    + (currentTemperature[j] + currentTemperature[i])/(2.0*dt);
+        }
     }
 }
@@ -1,5 +1,6 @@
 #include "solver/governingequationsolver.hpp"
 
+#include <cmath>
 #include <memory>
 #include <stdexcept>
 #include <armadillo>
@@ -17,6 +18,7 @@ using arma::vec;
 using arma::uvec;
 using arma::zeros;
 using arma::mat;
+using arma::cube;
 using std::unique_ptr;
 
 GoverningEquationSolverBase::~GoverningEquationSolverBase()
@@ -40,17 +42,19 @@ GoverningEquationSolver<T>::~GoverningEquationSolver()
 
 template<typename T>
 GoverningEquationSolver<T>::GoverningEquationSolver(
-        const uword nGridPoints):
-    m_matrixEquation(std::make_unique<MatrixEquation>())
+        const uword nGridPoints,
+        const std::string& linearSolver):
+    m_matrixEquation(std::make_unique<MatrixEquation>(linearSolver))
 {
     m_discretizer = std::make_unique<T>(nGridPoints);
 }
 
 template<typename T>
 GoverningEquationSolver<T>::GoverningEquationSolver(
-        std::unique_ptr<Discretizer> discretizer):
+        std::unique_ptr<Discretizer> discretizer,
+        const std::string& linearSolver):
     m_discretizer(std::move(discretizer)),
-    m_matrixEquation(std::make_unique<MatrixEquation>())
+    m_matrixEquation(std::make_unique<MatrixEquation>(linearSolver))
 {}
 
 template<typename T>
@@ -75,6 +79,134 @@ mat GoverningEquationSolver<T>::solve(
                 boundaryConditions);
 }
 
+template<typename T>
+mat GoverningEquationSolver<T>::solveNewton(
+        const arma::uword dt,
+        const Pipeline& currentState,
+        const Pipeline& newState,
+        const BoundaryConditions& boundaryConditions)
+{
+    const uword N = m_nVariables;
+    const uword nGridPoints = newState.gridPoints().n_elem;
+    const uword nElements = nGridPoints - 1;
+
+    // the variables, in the order used by Discretizer
+    const auto variable = [](auto& state, const uword var) -> decltype(state.flow())
+    {
+        if (var == 0)
+            return state.flow();
+        else if (var == 1)
+            return state.pressure();
+        else
+            return state.temperature();
+    };
+
+    // residual at the guess
+    m_discretizer->discretize(dt, currentState, newState);
+    const mat residual0 = residual(newState);
+
+    // Jacobian by finite differences, organized like Discretizer::term_i()
+    // and Discretizer::term_ipp()
+    // the equations for element I only depend on grid points i and i+1, so
+    // we can perturb every other grid point at the same time
+    cube jacobian_i = zeros<cube>(nElements, N, N);
+    cube jacobian_ipp = zeros<cube>(nElements, N, N);
+    Pipeline perturbed = newState; // make copy
+    for (uword var = 0; var < N; var++)
+    {
+        const vec& y = variable(perturbed, var);
+        const vec h = std::sqrt(arma::datum::eps)*arma::clamp(arma::abs(y), 1.0, arma::datum::inf);
+
+        for (uword color = 0; color < 2; color++)
+        {
+            for (uword i = color; i < nGridPoints; i += 2)
+            {
+                variable(perturbed, var)(i) += h(i);
+
+                // linearized equation of state
+                double& Z = perturbed.compressibilityFactor()(i);
+                if (var == 1)
+                    Z += newState.dZdpAtConstantTemperature()(i)*h(i);
+                else if (var == 2)
+                    Z += newState.dZdtAtConstantPressure()(i)*h(i);
+                perturbed.density()(i) = perturbed.pressure()(i)
+                        /(Z*perturbed.specificGasConstant()(i)*perturbed.temperature()(i));
+            }
+
+            m_discretizer->discretize(dt, currentState, perturbed);
+            const mat dR = residual(perturbed) - residual0;
+
+            for (uword element = 0; element < nElements; element++)
+            {
+                if (element % 2 == color) // perturbed y_i
+                {
+                    for (uword eq = 0; eq < N; eq++)
+                        jacobian_i(element, eq, var) = dR(element, eq)/h(element);
+                }
+                else // perturbed y_(i+1)
+                {
+                    for (uword eq = 0; eq < N; eq++)
+                        jacobian_ipp(element, eq, var) = dR(element, eq)/h(element + 1);
+                }
+            }
+
+            // reset
+            variable(perturbed, var) = variable(newState, var);
+            perturbed.compressibilityFactor() = newState.compressibilityFactor();
+            perturbed.density() = newState.density();
+        }
+    }
+
+    // J y_(k+1) = J y_k - R(y_k)
+    mat constants = -residual0;
+    for (uword var = 0; var < N; var++)
+    {
+        const vec& y = variable(newState, var);
+        for (uword eq = 0; eq < N; eq++)
+        {
+            constants.col(eq) +=
+                    jacobian_i.slice(var).col(eq) % y.head(nElements)
+                    + jacobian_ipp.slice(var).col(eq) % y.tail(nElements);
+        }
+    }
+
+    m_matrixEquation->fillCoefficientMatrixAndConstantsVector(
+                nGridPoints,
+                N,
+                boundaryConditions,
+                jacobian_i,
+                jacobian_ipp,
+                constants);
+
+    return m_matrixEquation->solve(
+                nGridPoints,
+                N,
+                boundaryConditions);
+}
+
+template<typename T>
+mat GoverningEquationSolver<T>::residual(const Pipeline& state) const
+{
+    const uword nElements = state.gridPoints().n_elem - 1;
+    const cube& term_i = m_discretizer->term_i();
+    const cube& term_ipp = m_discretizer->term_ipp();
+
+    mat R = -m_discretizer->boundaryTerms();
+    const vec* variables[] = {&state.flow(), &state.pressure(), &state.temperature()};
+    for (uword var = 0; var < m_nVariables; var++)
+    {
+        const vec& y = *variables[var];
+        for (uword eq = 0; eq < m_nVariables; eq++)
+        {
+            R.col(eq) +=
+                    term_i.slice(var).col(eq) % y.head(nElements)
+                    + term_ipp.slice(var).col(eq) % y.tail(nElements);
+        }
+    }
+
+    return R;
+}
+
 // explicit instantiantion
 template class GoverningEquationSolver<InternalEnergyDiscretizer>;
 template class GoverningEquationSolver<EnthalpyDiscretizer>;
@@ -2,6 +2,7 @@
 
 #include <armadillo>
 #include <memory>
+#include <string>
 
 class Pipeline;
 class BoundaryConditions;
@@ -28,6 +29,13 @@ public:
             const Pipeline& newState,
             const BoundaryConditions& boundaryConditions) = 0;
 
+    //! See GoverningEquationSolver::solveNewton().
+    virtual arma::mat solveNewton(
+            const arma::uword dt,
+            const Pipeline& currentState,
+            const Pipeline& newState,
+            const BoundaryConditions& boundaryConditions) = 0;
+
     //! Returns true of the equation system is over-determined given the
     //! input boundary conditions. Just returns true if there are more than
     //! three active boundary conditions, and false else.
@@ -49,14 +57,22 @@ public:
     /*!
      * \brief Construct with string determining the type of energy equation.
      * \param nGridPoints Number of grid points
+     * \param linearSolver Linear solver backend used by MatrixEquation
+     * ("SuperLU" or "Banded")
      */
-    explicit GoverningEquationSolver(const arma::uword nGridPoints);
+    explicit GoverningEquationSolver(
+            const arma::uword nGridPoints,
+            const std::string& linearSolver = "Banded");
 
     /*!
      * \brief Construct from Discretizer instance.
      * \param discretizer Discretizer instance
+     * \param linearSolver Linear solver backend used by MatrixEquation
+     * ("SuperLU" or "Banded")
      */
-    explicit GoverningEquationSolver(std::unique_ptr<Discretizer> discretizer);
+    explicit GoverningEquationSolver(
+            std::unique_ptr<Discretizer> discretizer,
+            const std::string& linearSolver = "Banded");
 
     /*!
      * \brief Solve the governing equations for a given time step and boundary
@@ -73,9 +89,59 @@ public:
             const Pipeline& newState,
             const BoundaryConditions& boundaryConditions) override;
 
+    /*!
+     * \brief Perform a single quasi-Newton step for the governing equations
+     * for a given time step and boundary conditions.
+     *
+     * Where solve() solves \f$A(y_k) y_{k+1} = b(y_k)\f$, with the
+     * coefficients evaluated at the guess \f$y_k\f$, this solves
+     * \f$J(y_k) y_{k+1} = J(y_k) y_k - R(y_k)\f$, where
+     * \f$R(y) = A(y) y - b(y)\f$ is the residual of the discretized
+     * equations, and \f$J\f$ is the Jacobian of the residual.
+     *
+     * The equations for each element only depend on the two grid points of
+     * the element, so the Jacobian is found by finite differences using only
+     * six evaluations of the residual (one for every other grid point, for
+     * each variable). The compressibility factor and density of the perturbed
+     * states are found using the derivatives of the compressibility factor
+     * (\f$\partial Z/\partial p|_T\f$ and \f$\partial Z/\partial T|_p\f$)
+     * from the equation of state, so the equation of state is not evaluated
+     * here.
+     *
+     * The heat capacity, friction factor and heat flux are kept at their
+     * values at the guess, so their dependence on the state is not part of
+     * the Jacobian. This makes it a quasi-Newton method: each step is exact
+     * for the pressure and density coupling, which dominates at large time
+     * steps, but the convergence is linear rather than quadratic. Including
+     * these terms would require evaluating the equation of state and heat
+     * transfer for each perturbation, where the iterative density solution
+     * is not accurate enough for finite differences with steps of
+     * \f$\sqrt{\epsilon}\f$.
+     *
+     * \param dt Time step [s]
+     * \param currentState Current Pipeline state
+     * \param newState New/guess Pipeline state
+     * \param boundaryConditions Boundary conditions
+     * \return Matrix containing flow, pressure and temperature columns
+     */
+    virtual arma::mat solveNewton(
+            const arma::uword dt,
+            const Pipeline& currentState,
+            const Pipeline& newState,
+            const BoundaryConditions& boundaryConditions) override;
+
 private:
     const arma::uword m_nVariables = 3; //!< Number of flow variables (flow, pressure and temperature)
 
+    /*!
+     * \brief Calculate the residual \f$R(y) = A(y) y - b(y)\f$ of the
+     * discretized equations, using the coefficients currently stored in
+     * m_discretizer.
+     * \param state Pipeline state (y)
+     * \return Residual, organized as (element, equation number)
+     */
+    arma::mat residual(const Pipeline& state) const;
+
     //! Discretizer used when solving the governing equations. The main
     //! difference between the two options InternalEnergyDiscretizer and
     //! EnthalpyDiscretizer is the choice of energy equation.
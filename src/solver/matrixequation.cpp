@@ -1,6 +1,9 @@
 #include "solver/matrixequation.hpp"
 
+#include <algorithm>
+
 #include "utilities/errors.hpp"
+#include "utilities/numerics.hpp"
 #include "solver/boundaryconditions.hpp"
 
 using arma::mat;
@@ -16,6 +19,13 @@ using std::cout;
 MatrixEquation::~MatrixEquation()
 {}
 
+MatrixEquation::MatrixEquation(const std::string& linearSolver):
+    m_linearSolver(linearSolver)
+{
+    if (m_linearSolver != "SuperLU" && m_linearSolver != "Banded")
+        throw std::invalid_argument("linearSolver");
+}
+
 mat MatrixEquation::solve(
         const uword nGridPoints,
         const uword nEquationsAndVariables,
@@ -37,7 +47,7 @@ mat MatrixEquation::solve(
             cout << "MatrixEquation::solve() could not find a solution. Trying a final trick before giving up";
             try
             {
-                x = arma::spsolve(m_coefficients, m_constants, "superlu", settings); // sparse solver, uses superlu by default
+                x = arma::spsolve(coefficientMatrix(), m_constants, "superlu", settings); // sparse solver, uses superlu by default
             }
             catch (const std::runtime_error&) // spsolve only throws this, and only when it can't find a solution
             {
@@ -95,20 +105,56 @@ void MatrixEquation::fillCoefficientMatrixAndConstantsVector(
     const uword nRows = N*nElements; // nEquations for each element
     const uword nCols = N*nElements - nExtraConditions; // nVariables for each element, but need to subtract for boundary conditions
 
-//    m_coefficients = sp_mat(nRows, nCols); // don't construct here, use batch insertion later
-    m_constants = zeros<vec>(nRows); // the constants/knowns in each equation for each element
+    // the sparsity pattern of A only depends on the number of grid points and
+    // which boundary conditions are active, so we only construct m_coefficients
+    // when this changes, and else only refill the values in m_values
+    uword patternKey = 0;
+    for (uword var = 0; var < N; var++)
+    {
+        patternKey |= uword(boundaryConditions.inlet(var).isActive()) << var;
+        patternKey |= uword(boundaryConditions.outlet(var).isActive()) << (N + var);
+    }
+    const bool newPattern =
+            !m_patternIsValid
+            || patternKey != m_patternKey
+            || nRows != m_coefficients.n_rows
+            || nCols != m_coefficients.n_cols;
+
+    m_constants.zeros(nRows); // the constants/knowns in each equation for each element
 
-    // use batch insertion
     // we need 2*nEquations*nVariables elements for each element I, but subtract nEquations for each boundary condition (removes one column from A)
-    //  - the actual insertion is performed in the last line of this function
     uword nElementsToInsert = 2*N*N*nElements - (N + nExtraConditions)*N;
 
     // locations is a dense matrix of type umat, with a size of 2 x N, where N is the number of values to be inserted;
     // the location of the i-th element is specified by the contents of the i-th column of the locations matrix,
     // where the row is in locations(0,i), and the column is in locations(1,i)
-    umat locations = zeros<umat>(2, nElementsToInsert);
-    vec values = zeros<vec>(nElementsToInsert);
+    // (only used when constructing a new pattern, with batch insertion)
+    umat locations;
+    vec values;
+    if (newPattern)
+    {
+        locations = zeros<umat>(2, nElementsToInsert);
+        values = zeros<vec>(nElementsToInsert);
+    }
+
+    // with an existing pattern, the values are written to m_values, and
+    // m_valueIndex maps the insertion order below to the location in the
+    // compressed sparse column storage
     uword c = 0; // counter of where we are in locations and values
+    const auto insert = [&](const uword row, const uword col, const double value)
+    {
+        if (newPattern)
+        {
+            locations(0, c) = row;
+            locations(1, c) = col;
+            values(c) = value;
+        }
+        else
+        {
+            m_values(m_valueIndex(c)) = value;
+        }
+        c++;
+    };
 
     uword colOffset = 0; // only used to find starting point for col0
 
@@ -147,10 +193,7 @@ void MatrixEquation::fillCoefficientMatrixAndConstantsVector(
                 {
                     // term y_i^(n+1) is unknown, so the coefficient in front of that goes into the unknowns matrix A
                     uword row = eq;
-                    locations(0, c) = row;
-                    locations(1, c) = col;
-                    values(c) = term_i(element, eq, var);
-                    c++;
+                    insert(row, col, term_i(element, eq, var));
                 }
                 col++; // only incremented if not a boundary condition at the inlet
             }
@@ -172,17 +215,11 @@ void MatrixEquation::fillCoefficientMatrixAndConstantsVector(
 
                 // coeffient of y_(i+1)^(n+1) from equation for element I --> y_1
                 row = row0 + eq;
-                locations(0, c) = row;
-                locations(1, c) = col;
-                values(c) = term_ipp(element, eq, var);
-                c++;
+                insert(row, col, term_ipp(element, eq, var));
 
                 // coefficient of y_i^(n+1) from equation for element I+1 --> y_1
                 row = row0 + (eq + N); // one block down
-                locations(0, c) = row;
-                locations(1, c) = col;
-                values(c) = term_i(element+1, eq, var); // grid + 1 to get element I+1, term_i to get y_i
-                c++;
+                insert(row, col, term_i(element+1, eq, var)); // grid + 1 to get element I+1, term_i to get y_i
             }
         }
         row0 += N;
@@ -211,28 +248,72 @@ void MatrixEquation::fillCoefficientMatrixAndConstantsVector(
                 {
                     // coeffient of y_(i+1)^(n+1) from equation for final element
                     uword row = row0 + eq;
-                    locations(0, c) = row;
-                    locations(1, c) = col;
-                    values(c) = term_ipp(element, eq, var);
-                    c++;
+                    insert(row, col, term_ipp(element, eq, var));
                 }
                 col++; // only incremented if not a boundary condition at the outlet
             }
         }
     }
 
-    // options for sp_mat batch insertion constructor
-    bool add_values = false; // when set to true, identical locations are allowed, and the values at identical locations are added
-    bool sort_locations = true; // If sort_locations is set to false, the locations matrix is assumed to contain locations that are already sorted according to column-major ordering
-    bool check_for_zeros = true; // If check_for_zeros is set to false, the values vector is assumed to contain no zero values
-    uword n_rows = nRows;
-    uword n_cols = nCols;
+    if (newPattern)
+    {
+        // options for sp_mat batch insertion constructor
+        bool add_values = false; // when set to true, identical locations are allowed, and the values at identical locations are added
+        bool sort_locations = true; // If sort_locations is set to false, the locations matrix is assumed to contain locations that are already sorted according to column-major ordering
+        bool check_for_zeros = false; // keep explicit zeros, so the pattern does not depend on the values
+        uword n_rows = nRows;
+        uword n_cols = nCols;
+
+        // use batch insertion to populate Amatrix
+        m_coefficients = sp_mat(add_values, locations, values, n_rows, n_cols, sort_locations, check_for_zeros); // use batch insertion constructor
+
+        // keep our own copy of the compressed sparse column storage, so the
+        // values can be refilled later without touching the internals of
+        // m_coefficients
+        m_rowIndices = arma::uvec(m_coefficients.row_indices, m_coefficients.n_nonzero);
+        m_colPtrs = arma::uvec(m_coefficients.col_ptrs, m_coefficients.n_cols + 1);
+        m_values = vec(m_coefficients.values, m_coefficients.n_nonzero);
+
+        // find where each inserted element ended up in the compressed sparse
+        // column storage
+        m_valueIndex.set_size(nElementsToInsert);
+        for (uword i = 0; i < nElementsToInsert; i++)
+        {
+            const uword row = locations(0, i);
+            const uword col = locations(1, i);
+            for (uword k = m_colPtrs(col); k < m_colPtrs(col + 1); k++)
+            {
+                if (m_rowIndices(k) == row)
+                {
+                    m_valueIndex(i) = k;
+                    break;
+                }
+            }
+        }
+
+        m_patternKey = patternKey;
+        m_patternIsValid = true;
+        m_bandIsValid = false;
+        m_coefficientsAreCurrent = true;
+    }
+    else
+    {
+        // the values were refilled in m_values, which the banded solvers use
+        // directly, so m_coefficients is only rebuilt if it is needed
+        m_coefficientsAreCurrent = false;
+    }
+}
 
-//    sp_mat test(add_values, locations, values, n_rows, n_cols, sort_locations, check_for_zeros);
-//    cout << arma::accu(arma::abs(Amatrix - test)) << endl;
+const sp_mat& MatrixEquation::coefficientMatrix() const
+{
+    if (!m_coefficientsAreCurrent)
+    {
+        // the structure is already sorted, so this is just a copy
+        m_coefficients = sp_mat(m_rowIndices, m_colPtrs, m_values, m_coefficients.n_rows, m_coefficients.n_cols);
+        m_coefficientsAreCurrent = true;
+    }
 
-    // use batch insertion to populate Amatrix
-    m_coefficients = sp_mat(add_values, locations, values, n_rows, n_cols, sort_locations, check_for_zeros); // use batch insertion constructor
+    return m_coefficients;
 }
 
 mat MatrixEquation::reshapeSolverOutput(
@@ -308,11 +389,8 @@ vec MatrixEquation::solveMatrixEquation() const
     vec x;
     if (m_coefficients.n_rows > m_coefficients.n_cols)
     {
-        // over-determined, need to use the regular solver
-        // WARNING: this is slower and increases memory usage, since we need to convert the sparse matrix to a dense matrix first
-        // it's probably possible to avoid this by solving the extra equation(s) for m_i/p_i/T_i and inserting into a equation i+1/i-1, thereby eliminating some rows
-        mat A(m_coefficients); // convert sparse matrix to dense matrix
-        x = arma::solve(A, m_constants); // dense matrix solver
+        // over-determined, find the least squares solution
+        x = solveLeastSquares();
     }
     else if (m_coefficients.n_rows < m_coefficients.n_cols)
     {
@@ -321,8 +399,110 @@ vec MatrixEquation::solveMatrixEquation() const
     else
     {
         // critically determined system (square matrix)
-        x = arma::spsolve(m_coefficients, m_constants, "superlu"); // sparse matrix solver, uses superlu by default
+        if (m_linearSolver == "Banded")
+        {
+            x = solveBanded();
+        }
+        else
+        {
+            // the unknowns are ordered grid point by grid point, which already
+            // gives a narrow band, so use the natural column ordering and
+            // skip the ordering analysis (if this fails, solve() tries again
+            // with the default ordering)
+            arma::superlu_opts settings;
+            settings.permutation = arma::superlu_opts::NATURAL;
+            x = arma::spsolve(coefficientMatrix(), m_constants, "superlu", settings); // sparse matrix solver
+        }
     }
 
     return x;
 }
+
+vec MatrixEquation::solveLeastSquares() const
+{
+    // the least squares solution of the over-determined system is found by
+    // QR decomposition (Givens rotations) of the banded matrix, which gives the
+    // same solution as the dense solver, with cost linear in the number of
+    // grid points
+    if (!m_bandIsValid)
+        analyseBand();
+
+    fillBand();
+
+    return utils::banlsq(m_band, m_bandLower, m_bandUpper, m_coefficients.n_cols, m_constants); // throws std::runtime_error if rank deficient
+}
+
+vec MatrixEquation::solveBanded() const
+{
+    if (!m_bandIsValid)
+        analyseBand();
+
+    fillBand();
+
+    try
+    {
+        // numerical factorization only
+        utils::bandec(m_band, m_bandLower, m_bandUpper, m_bandMultipliers, m_bandPivots);
+    }
+    catch (const std::runtime_error&)
+    {
+        // singular pivot, so do a full re-analysis next time, and let solve()
+        // fall back to superlu
+        m_bandIsValid = false;
+        throw;
+    }
+
+    vec x = m_constants;
+    utils::banbks(m_band, m_bandLower, m_bandUpper, m_bandMultipliers, m_bandPivots, x);
+
+    return x;
+}
+
+void MatrixEquation::fillBand() const
+{
+    // copy values to compact band storage, using the cached locations
+    // (this keeps the size, so no allocation)
+    m_band.zeros();
+    for (uword k = 0; k < m_bandIndex.n_elem; k++)
+    {
+        m_band(m_bandIndex(k)) = m_values(k);
+    }
+}
+
+void MatrixEquation::analyseBand() const
+{
+    // use our copy of the structure, which keeps the explicit zeros
+    const uword* const colPtrs = m_colPtrs.memptr();
+    const uword* const rowIndices = m_rowIndices.memptr();
+
+    // find number of sub- and superdiagonals
+    m_bandLower = 0;
+    m_bandUpper = 0;
+    for (uword col = 0; col < m_coefficients.n_cols; col++)
+    {
+        for (uword k = colPtrs[col]; k < colPtrs[col + 1]; k++)
+        {
+            const uword row = rowIndices[k];
+            if (row > col)
+                m_bandLower = std::max(m_bandLower, row - col);
+            else
+                m_bandUpper = std::max(m_bandUpper, col - row);
+        }
+    }
+
+    // location of each non-zero element in the compact band storage, with
+    // one column per row of A
+    const uword bandwidth = m_bandLower + m_bandUpper + 1;
+    m_bandIndex.set_size(m_values.n_elem);
+    for (uword col = 0; col < m_coefficients.n_cols; col++)
+    {
+        for (uword k = colPtrs[col]; k < colPtrs[col + 1]; k++)
+        {
+            const uword row = rowIndices[k];
+            m_bandIndex(k) = (m_bandLower + col - row) + row*bandwidth;
+        }
+    }
+
+    m_band.set_size(bandwidth, m_coefficients.n_rows);
+    m_bandIsValid = true;
+}
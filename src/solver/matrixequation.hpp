@@ -1,5 +1,6 @@
 #pragma once
 
+#include <string>
 #include <armadillo>
 
 class BoundaryConditions;
@@ -22,11 +23,28 @@ class BoundaryConditions;
  * fills in the matrix using results from Discretizer, and solves the matrix
  * equation.
  *
- * The matrix equation is solved using the sparse matrix solver arma::spsolve,
- * which uses superlu internally. This solver only works for critically
- * determined systems, not for over-determined systems. In that case the regular
- * solver is used, and the sparse matrix has to be converted to a regular
- * matrix.
+ * By default (`linearSolver = "Banded"`) the critically determined system is
+ * solved with a banded LU decomposition (utils::bandec() and utils::banbks()).
+ * The band structure is found once for each sparsity pattern and reused, so
+ * each solve only does the numerical factorization. The N equations of each
+ * element (rows) only couple the 2N variables at its two grid points
+ * (columns). With c inlet boundary conditions, whose variables are removed
+ * from the unknowns, this gives N - 1 + c subdiagonals and 2N - 1 - c
+ * superdiagonals, so the bandwidth (3N - 1) does not depend on the number of
+ * grid points. The actual band structure is found from the sparsity pattern
+ * (see analyseBand()). The cost is linear in the number of grid points,
+ * without the symbolic analysis performed by superlu.
+ *
+ * Alternatively (`linearSolver = "SuperLU"`), it is solved using the sparse
+ * matrix solver arma::spsolve, which uses superlu internally (with natural
+ * column ordering, since the unknowns are already ordered grid point by grid
+ * point). arma::spsolve has no way to keep the factorization between calls,
+ * so each solve does the full symbolic and numerical factorization. The
+ * superlu solver is also the fallback if the banded factorization finds a
+ * singular pivot.
+ *
+ * Over-determined systems are always solved in the least squares sense by a
+ * banded QR decomposition, see solveLeastSquares().
  *
  * Most of the elements in the matrix are zero, so we use sparse matrices. The
  * non-zero elements are all located near the diagonal.
@@ -39,6 +57,13 @@ public:
     //! Declared to avoid the inline compiler-generated default destructor.
     ~MatrixEquation();
 
+    /*!
+     * \brief Construct with string selecting the linear solver backend.
+     * \param linearSolver Linear solver used for critically determined
+     * systems ("SuperLU" or "Banded")
+     */
+    explicit MatrixEquation(const std::string& linearSolver = "Banded");
+
     /*!
      * \brief Fill in the coefficient matrix A (MatrixEquation::m_coefficients)
      * and constants vector b (MatrixEquation::m_constants) in the matrix
@@ -58,6 +83,14 @@ public:
      * over-determined system, and giving less than 3 leads to a
      * under-determined system.
      *
+     * The sparsity pattern of A only depends on the number of grid points
+     * and which boundary conditions are active. The pattern is constructed
+     * on the first call, and when these change. On all other calls only the
+     * values are refilled in place, in MatrixEquation::m_values, which the
+     * banded solvers use directly. The sparse matrix is only rebuilt from
+     * these (a copy without sorting) when it is needed, by the superlu solver
+     * or coefficients().
+     *
      * \see Discretizer::discretize()
      *
      * \param nGridPoints Number of grid points
@@ -95,14 +128,43 @@ public:
             const BoundaryConditions& boundaryConditions) const;
 
     //! Get coefficient matrix A. For testing purposes.
-    const arma::sp_mat& coefficients() const { return m_coefficients; }
+    const arma::sp_mat& coefficients() const { return coefficientMatrix(); }
     //! Get constants vector b. For testing purposes.
     const arma::vec& constants() const { return m_constants; }
+    //! Get linear solver backend ("SuperLU" or "Banded")
+    const std::string& linearSolver() const { return m_linearSolver; }
 
 private:
-    arma::sp_mat m_coefficients; //!< Coefficient matrix A
+    std::string m_linearSolver; //!< Linear solver backend ("SuperLU" or "Banded")
+    //! Coefficient matrix A, rebuilt from m_values by coefficientMatrix()
+    //! when the values have changed (mutable since solve() is const)
+    mutable arma::sp_mat m_coefficients;
+    //! If m_coefficients holds the values in m_values
+    mutable bool m_coefficientsAreCurrent = false;
     arma::vec m_constants; //!< Constants vector b
 
+    //! If m_coefficients contains a valid sparsity pattern
+    bool m_patternIsValid = false;
+    //! Bitmask of the active boundary conditions the sparsity pattern of
+    //! m_coefficients was constructed for
+    arma::uword m_patternKey = 0;
+    //! Location in the compressed sparse column storage (index into
+    //! m_values) of each element, in the order they are filled in by
+    //! fillCoefficientMatrixAndConstantsVector()
+    arma::uvec m_valueIndex;
+    //! Row index of each element in the compressed sparse column storage,
+    //! including explicit zeros
+    arma::uvec m_rowIndices;
+    //! Column pointers of the compressed sparse column storage
+    arma::uvec m_colPtrs;
+    //! Values in the compressed sparse column storage, refilled in place
+    //! when the sparsity pattern is reused
+    arma::vec m_values;
+
+    //! Get m_coefficients, after rebuilding it from m_rowIndices, m_colPtrs
+    //! and m_values if the values have changed since it was built.
+    const arma::sp_mat& coefficientMatrix() const;
+
     /*!
      * \brief Reshape output from solving the matrix equation into a matrix
      * containing flow, pressure and temperature as columns.
@@ -132,4 +194,49 @@ private:
      * \return Vector x, solution of the matrix equation Ax = b.
      */
     arma::vec solveMatrixEquation() const;
+
+    /*!
+     * \brief Internal method that finds the least squares solution of the
+     * over-determined matrix equation.
+     *
+     * Uses QR decomposition of the banded coefficient matrix
+     * (utils::banlsq()), which gives the same solution as a dense least
+     * squares solver, without converting A to a dense matrix.
+     *
+     * \return Vector x, least squares solution of the matrix equation Ax = b.
+     */
+    arma::vec solveLeastSquares() const;
+
+    /*!
+     * \brief Internal method that solves the critically determined matrix
+     * equation using banded LU decomposition.
+     *
+     * Copies the non-zero elements of the coefficient matrix to compact band
+     * storage, and solves using utils::bandec() and utils::banbks(). The band
+     * structure is found by analyseBand() only when the sparsity pattern
+     * changes (or the factorization failed), so only the numerical
+     * factorization is done on each call.
+     *
+     * \return Vector x, solution of the matrix equation Ax = b.
+     */
+    arma::vec solveBanded() const;
+
+    //! Find the band structure of the coefficient matrix, and the location
+    //! of each non-zero element in the compact band storage. Used by both
+    //! solveBanded() and solveLeastSquares().
+    void analyseBand() const;
+
+    //! Copy the non-zero elements of the coefficient matrix to the compact
+    //! band storage m_band.
+    void fillBand() const;
+
+    // cached band structure, mutable since solve() is const
+    mutable bool m_bandIsValid = false; //!< If the cached band structure is valid
+    mutable arma::uword m_bandLower = 0; //!< Number of subdiagonals
+    mutable arma::uword m_bandUpper = 0; //!< Number of superdiagonals
+    //! Location of each non-zero element of m_coefficients in m_band
+    mutable arma::uvec m_bandIndex;
+    mutable arma::mat m_band; //!< Compact band storage, overwritten by the factorization
+    mutable arma::mat m_bandMultipliers; //!< Lower triangular matrix from the factorization
+    mutable arma::uvec m_bandPivots; //!< Row permutations from the factorization
 };
@@ -1,5 +1,6 @@
 #include "solver/solver.hpp"
 
+#include <algorithm>
 #include <cmath>
 
 #include "advection/batchtracking.hpp"
@@ -32,21 +33,26 @@ Solver::Solver(
         const std::string& toleranceType,
         const arma::vec& tolerances,
         const bool bruteForce,
-        const arma::uword maxIterations):
+        const arma::uword maxIterations,
+        const std::string& linearSolver):
     m_relaxationFactor(relaxationFactors),
     m_toleranceType(toleranceType),
     m_tolerances(tolerances),
     m_bruteForce(bruteForce),
     m_maxIterations(maxIterations),
-    m_governingEquationSolver(makeGoverningEquationSolver(nGridPoints, energyEquation)),
+    m_governingEquationSolver(makeGoverningEquationSolver(nGridPoints, energyEquation, linearSolver)),
     m_compositionSolver(std::make_unique<BatchTracking>())
 {}
 
 Solver::Solver(const arma::uword nGridPoints, const Config& config):
     Solver(nGridPoints, config.discretizer, config.relaxationFactors,
            config.toleranceType, config.tolerances, config.bruteForce,
-           config.maxIterations)
-{}
+           config.maxIterations, config.linearSolver)
+{
+    setNonlinearSolver(config.nonlinearSolver);
+    setAndersonDepth(config.andersonDepth);
+    setPredictorOrder(config.predictorOrder);
+}
 
 Pipeline Solver::solve(
     const arma::uword dt,
@@ -72,6 +78,10 @@ Pipeline Solver::solve(
         cout << e.what() << endl;
     }
 
+    // the state is not advanced, so the predictor history no longer applies
+    m_acceptedStates.clear();
+    m_acceptedTimes.clear();
+
     // if all else fails, return old state
     return current;
 }
@@ -82,30 +92,71 @@ Pipeline Solver::solveWithIterations(
         const BoundaryConditions& boundaryConditions,
         const Physics& physics) const
 {
+    m_lastStateIsPending = false;
+
     Pipeline guess = current; // make copy
-    Pipeline previous = current;
+    if (m_predictorOrder > 0 && predict(dt, current, guess))
+    {
+        physics.updateDerivedProperties(guess);
+        physics.heatTransfer().evaluate(current.heatTransferState(), dt, guess);
+    }
+
+    // flow, pressure and temperature (columns) of the previous iteration,
+    // for checking convergence
+    mat previous(guess.size(), 3);
+    previous.col(0) = guess.flow();
+    previous.col(1) = guess.pressure();
+    previous.col(2) = guess.temperature();
 
-    arma::vec relaxationFactor = m_relaxationFactor;
+    // Newton steps are not relaxed
+    const bool newton = m_nonlinearSolver == "Newton";
+    arma::vec relaxationFactor = newton ? arma::ones<vec>(3) : m_relaxationFactor;
 
     const bool lowFlowState =
             (boundaryConditions.inletFlow().isActive() && boundaryConditions.inletFlow() < 10)
             || (boundaryConditions.outletFlow().isActive() && boundaryConditions.outletFlow() < 10);
 
+    // Anderson acceleration works on the stacked (flow, pressure, temperature)
+    // vector, with each property scaled to order one so the least-squares
+    // problem is well conditioned
+    const bool anderson = !newton && m_andersonDepth > 0;
+    const vec scale = {
+        std::max(arma::max(arma::abs(current.flow())), 1.0),
+        arma::max(current.pressure()),
+        arma::max(current.temperature())};
+    const auto stack = [&scale](const Pipeline& state) -> vec {
+        return arma::join_cols(
+                    arma::join_cols(state.flow()/scale(0), state.pressure()/scale(1)),
+                    state.temperature()/scale(2));
+    };
+    mat residualDifferences; // differences of consecutive residuals (columns)
+    mat updateDifferences; // differences of consecutive updates (columns)
+    vec previousResidual;
+    vec previousUpdate;
+
     m_nIterations = 0; // mutable
     while (true)
     {
         m_nIterations++;
 
-        // decrease relaxation factor after some iterations
-        if (m_nIterations >= 50)
+        // decrease relaxation factor after some iterations (Newton steps are
+        // never relaxed)
+        if (!newton && m_nIterations >= 50)
             relaxationFactor *= 0.95;
 
+        const vec x = anderson ? stack(guess) : vec();
+
         // calculate new flow, pressure, temperature
-        const mat output = m_governingEquationSolver->solve(dt, current, guess, boundaryConditions);
+        const mat output = newton
+                ? m_governingEquationSolver->solveNewton(dt, current, guess, boundaryConditions)
+                : m_governingEquationSolver->solve(dt, current, guess, boundaryConditions);
         guess.flow()        = guess.flow()        + (output.col(0) - guess.flow())       *relaxationFactor(0);
         guess.pressure()    = guess.pressure()    + (output.col(1) - guess.pressure())   *relaxationFactor(1);
         guess.temperature() = guess.temperature() + (output.col(2) - guess.temperature())*relaxationFactor(2);
 
+        if (anderson)
+            accelerate(stack(guess) - x, stack(guess), scale, residualDifferences, updateDifferences, previousResidual, previousUpdate, guess);
+
         // TODO: do some validation of flow, pressure and temperature here?
 
         if (!guess.constantComposition())
@@ -135,16 +186,19 @@ Pipeline Solver::solveWithIterations(
             // this solver has issues converging at low flows, especially if using
             // unsteady heat transfer
             // hotfix is to just limit the number of iterations in these cases,
-            // and return even if we haven't converged
-            if (lowFlowState && m_nIterations >= 5)
+            // and return even if we haven't converged (not needed with
+            // Anderson acceleration)
+            if (lowFlowState && !anderson && m_nIterations >= 5)
                 break;
         }
 
         if (m_nIterations >= m_maxIterations)
             break;
 
-        // for comparing differences
-        previous = guess;
+        // for comparing differences (copies into the existing memory)
+        previous.col(0) = guess.flow();
+        previous.col(1) = guess.pressure();
+        previous.col(2) = guess.temperature();
     }
 
     if (!m_bruteForce)
@@ -155,6 +209,9 @@ Pipeline Solver::solveWithIterations(
         }
     }
 
+    if (m_predictorOrder > 0)
+        acceptState(dt, current, guess);
+
     return guess;
 }
 
@@ -168,24 +225,183 @@ void Solver::setMaxIterations(const arma::uword maxIterations)
     m_maxIterations = maxIterations;
 }
 
+void Solver::setAndersonDepth(const arma::uword depth)
+{
+    m_andersonDepth = depth;
+}
+
+void Solver::setPredictorOrder(const arma::uword order)
+{
+    if (order > 2)
+        throw std::invalid_argument("predictorOrder");
+
+    m_predictorOrder = order;
+    m_acceptedStates.clear();
+    m_acceptedTimes.clear();
+    m_lastStateIsPending = false;
+}
+
+void Solver::rejectLastState()
+{
+    if (!m_lastStateIsPending)
+        return;
+
+    m_acceptedStates.pop_back();
+    m_acceptedTimes.pop_back();
+    m_lastStateIsPending = false;
+}
+
+bool Solver::predict(
+        const arma::uword dt,
+        const Pipeline& current,
+        Pipeline& guess) const
+{
+    const uword nStates = m_acceptedStates.size();
+    if (nStates < 2)
+        return false;
+
+    // only extrapolate if we continue from the last state we returned
+    const mat& last = m_acceptedStates.back();
+    const mat start = arma::join_rows(arma::join_rows(current.flow(), current.pressure()), current.temperature());
+    if (!arma::approx_equal(last, start, "absdiff", 0))
+        return false;
+
+    // Lagrange interpolating polynomial through the last (order + 1) states,
+    // evaluated at the new time
+    const uword first = nStates - std::min<uword>(nStates, m_predictorOrder + 1);
+    const double t = m_acceptedTimes.back() + dt;
+    mat prediction = zeros<mat>(arma::size(last));
+    for (uword j = first; j < nStates; j++)
+    {
+        double weight = 1;
+        for (uword k = first; k < nStates; k++)
+            if (k != j)
+                weight *= (t - m_acceptedTimes[k])/(m_acceptedTimes[j] - m_acceptedTimes[k]);
+        prediction += weight*m_acceptedStates[j];
+    }
+
+    if (arma::any(prediction.col(1) <= 0) || arma::any(prediction.col(2) <= 0))
+        return false;
+
+    guess.flow() = prediction.col(0);
+    guess.pressure() = prediction.col(1);
+    guess.temperature() = prediction.col(2);
+
+    return true;
+}
+
+void Solver::acceptState(
+        const arma::uword dt,
+        const Pipeline& current,
+        const Pipeline& output) const
+{
+    const mat start = arma::join_rows(arma::join_rows(current.flow(), current.pressure()), current.temperature());
+    const mat end = arma::join_rows(arma::join_rows(output.flow(), output.pressure()), output.temperature());
+
+    // restart the history if this step did not continue from the last one
+    if (m_acceptedStates.empty() || !arma::approx_equal(m_acceptedStates.back(), start, "absdiff", 0))
+    {
+        m_acceptedStates.assign(1, start);
+        m_acceptedTimes.assign(1, 0);
+    }
+
+    m_acceptedStates.push_back(end);
+    m_acceptedTimes.push_back(m_acceptedTimes.back() + dt);
+
+    m_lastStateIsPending = true;
+
+    // we only need (order + 1) states, plus one in case the last one is
+    // rejected
+    while (m_acceptedStates.size() > m_predictorOrder + 2)
+    {
+        m_acceptedStates.erase(m_acceptedStates.begin());
+        m_acceptedTimes.erase(m_acceptedTimes.begin());
+    }
+}
+
+void Solver::accelerate(
+        const vec& residual,
+        const vec& update,
+        const vec& scale,
+        mat& residualDifferences,
+        mat& updateDifferences,
+        vec& previousResidual,
+        vec& previousUpdate,
+        Pipeline& guess) const
+{
+    if (!previousResidual.is_empty())
+    {
+        residualDifferences.insert_cols(residualDifferences.n_cols, residual - previousResidual);
+        updateDifferences.insert_cols(updateDifferences.n_cols, update - previousUpdate);
+        if (residualDifferences.n_cols > m_andersonDepth)
+        {
+            residualDifferences.shed_col(0);
+            updateDifferences.shed_col(0);
+        }
+    }
+    previousResidual = residual;
+    previousUpdate = update;
+
+    if (residualDifferences.n_cols == 0)
+        return;
+
+    // find the combination of previous residuals that best cancels the
+    // current residual, and apply the same combination to the updates
+    vec gamma;
+    const bool solved = arma::solve(gamma, residualDifferences, residual, arma::solve_opts::no_approx);
+    if (!solved || !gamma.is_finite())
+    {
+        residualDifferences.reset();
+        updateDifferences.reset();
+        return;
+    }
+    const vec accelerated = update - updateDifferences*gamma;
+
+    const uword n = guess.size();
+    const vec pressure = accelerated.subvec(n, 2*n - 1)*scale(1);
+    const vec temperature = accelerated.subvec(2*n, 3*n - 1)*scale(2);
+
+    // keep the plain update and restart the history if the extrapolation
+    // ends up in a non-physical state
+    if (arma::any(pressure <= 0) || arma::any(temperature <= 0))
+    {
+        residualDifferences.reset();
+        updateDifferences.reset();
+        return;
+    }
+
+    guess.flow() = accelerated.subvec(0, n - 1)*scale(0);
+    guess.pressure() = pressure;
+    guess.temperature() = temperature;
+}
+
+void Solver::setNonlinearSolver(const std::string& nonlinearSolver)
+{
+    if (nonlinearSolver != "Picard" && nonlinearSolver != "Newton")
+        throw std::invalid_argument("nonlinearSolver");
+
+    m_nonlinearSolver = nonlinearSolver;
+}
+
 std::unique_ptr<GoverningEquationSolverBase> Solver::makeGoverningEquationSolver(
         const arma::uword nGridPoints,
         const Config& config)
 {
-    return makeGoverningEquationSolver(nGridPoints, config.discretizer);
+    return makeGoverningEquationSolver(nGridPoints, config.discretizer, config.linearSolver);
 }
 
 std::unique_ptr<GoverningEquationSolverBase> Solver::makeGoverningEquationSolver(
         const arma::uword nGridPoints,
-        const std::string& discretizer)
+        const std::string& discretizer,
+        const std::string& linearSolver)
 {
     if (discretizer == "InternalEnergy")
     {
-        return std::make_unique<GoverningEquationSolver<InternalEnergyDiscretizer>>(nGridPoints);
+        return std::make_unique<GoverningEquationSolver<InternalEnergyDiscretizer>>(nGridPoints, linearSolver);
     }
     else if (discretizer == "Enthalpy")
     {
-        return std::make_unique<GoverningEquationSolver<EnthalpyDiscretizer>>(nGridPoints);
+        return std::make_unique<GoverningEquationSolver<EnthalpyDiscretizer>>(nGridPoints, linearSolver);
     }
 
     throw std::invalid_argument("discretizer");
@@ -198,48 +414,50 @@ uword Solver::differencesWithinTolerance(
         const std::string& toleranceType,
         const vec& relaxationFactors)
 {
-    vec flowDiff;
-    vec pressureDiff;
-    vec temperatureDiff;
+    const mat previousState = arma::join_rows(arma::join_rows(previous.flow(), previous.pressure()), previous.temperature());
+    return differencesWithinTolerance(guess, previousState, tolerances, toleranceType, relaxationFactors);
+}
+
+uword Solver::differencesWithinTolerance(
+        const Pipeline& guess,
+        const mat& previous,
+        const vec& tolerances,
+        const std::string& toleranceType,
+        const vec& relaxationFactors)
+{
+    bool relative;
     if (toleranceType == "absolute")
-    {
-        flowDiff = arma::abs(guess.flow() - previous.flow());
-        pressureDiff = arma::abs(guess.pressure() - previous.pressure());
-        temperatureDiff = arma::abs(guess.temperature() - previous.temperature());
-    }
+        relative = false;
     else if (toleranceType == "relative")
+        relative = true;
+    else
+        throw std::invalid_argument(utils::stringbuilder() << "unknown tolerance type \"" << toleranceType << "\"");
+
+    const vec* const properties[] = {&guess.flow(), &guess.pressure(), &guess.temperature()};
+
+    // single pass over each property, without temporaries
+    for (uword j = 0; j < 3; j++)
     {
-        flowDiff = zeros<vec>(guess.size());
+        const double* const value = properties[j]->memptr();
+        const double* const previousValue = previous.colptr(j);
+        const double limit = tolerances(j)*relaxationFactors(j);
         for (uword i = 0; i < guess.size(); i++)
         {
-            const double currentAbsFlow = std::abs(guess.flow()(i));
-            if (currentAbsFlow > 10*tolerances(0))
-            {
-                // use relative difference
-                flowDiff(i) = std::abs(guess.flow()(i) - previous.flow()(i))/std::abs(previous.flow()(i));
-            }
-            else
+            double diff = std::abs(value[i] - previousValue[i]);
+            if (relative)
             {
-                // if actual flow is lower than 10*tolerances(0), don't check error
-                flowDiff(i) = 0.0;
+                // if actual flow is lower than 10*tolerances(0), don't check
+                // error (temperature and pressure never reach zero)
+                if (j == 0 && std::abs(value[i]) <= 10*tolerances(0))
+                    continue;
+
+                diff /= std::abs(previousValue[i]);
             }
+
+            if (diff > limit)
+                return false;
         }
-        pressureDiff = arma::abs(guess.pressure() - previous.pressure())/previous.pressure();
-        temperatureDiff = arma::abs(guess.temperature() - previous.temperature())/previous.temperature();
     }
-    else
-    {
-        throw std::invalid_argument(utils::stringbuilder() << "unknown tolerance type \"" << toleranceType << "\"");
-    }
-
-    flowDiff = flowDiff/relaxationFactors(0);
-    pressureDiff = pressureDiff/relaxationFactors(1);
-    temperatureDiff = temperatureDiff/relaxationFactors(2);
-
-    uvec withinTolerance = zeros<uvec>(3);
-    withinTolerance(0) = arma::sum(flowDiff > tolerances(0)) == 0 ? true : false;
-    withinTolerance(1) = arma::sum(pressureDiff > tolerances(1)) == 0 ? true : false;
-    withinTolerance(2) = arma::sum(temperatureDiff > tolerances(2)) == 0 ? true : false;
 
-    return arma::all(withinTolerance);
+    return true;
 }
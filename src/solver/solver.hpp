@@ -3,6 +3,7 @@
 #include <string>
 #include <memory>
 #include <string>
+#include <vector>
 #include <armadillo>
 
 class Config;
@@ -48,6 +49,7 @@ public:
      * \param bruteForce Will always do maxIterations iterations and not check
      * for convergence
      * \param maxIterations The maximum number of iterations to perform
+     * \param linearSolver Linear solver backend ("SuperLU" or "Banded")
      */
     explicit Solver(
             const arma::uword nGridPoints,
@@ -56,7 +58,8 @@ public:
             const std::string& toleranceType = "relative",
             const arma::vec& tolerances = {0.001, 0.001, 0.001},
             const bool bruteForce = false,
-            const arma::uword maxIterations = 200);
+            const arma::uword maxIterations = 200,
+            const std::string& linearSolver = "Banded");
 
     /*!
      * \brief Solve the governing equations.
@@ -118,6 +121,19 @@ public:
             const std::string& toleranceType,
             const arma::vec& relaxationFactors);
 
+    /*!
+     * \brief Overload of differencesWithinTolerance(), where the previous
+     * flow, pressure and temperature are given as the columns of a matrix.
+     * This is used by solveWithIterations(), so only these properties (and not
+     * the whole Pipeline) have to be kept from the previous iteration.
+     */
+    static arma::uword differencesWithinTolerance(
+            const Pipeline& guess,
+            const arma::mat& previous,
+            const arma::vec& tolerances,
+            const std::string& toleranceType,
+            const arma::vec& relaxationFactors);
+
     /*!
      * \brief Solve the governing equations.
      *
@@ -141,6 +157,59 @@ public:
     //! Set max iterations.
     void setMaxIterations(const arma::uword maxIterations);
 
+    /*!
+     * \brief Set the nonlinear solver.
+     *
+     * With "Picard" each iteration solves the governing equations with the
+     * coefficients evaluated at the previous iteration, and updates the guess
+     * using the relaxation factors. With "Newton" each iteration performs a
+     * quasi-Newton step, using an approximate Jacobian of the discretized
+     * equations (see GoverningEquationSolver::solveNewton()), and the
+     * relaxation factors are not used.
+     *
+     * \param nonlinearSolver Nonlinear solver ("Picard" or "Newton")
+     */
+    void setNonlinearSolver(const std::string& nonlinearSolver);
+
+    /*!
+     * \brief Set the history depth of the Anderson acceleration.
+     *
+     * With a depth m > 0, each Picard iteration combines the (relaxed) update
+     * with the updates and residuals of the last m iterations, minimizing the
+     * residual in a least-squares sense. This typically reduces the number of
+     * iterations considerably, and is not limited by the low-flow iteration
+     * cutoff used by the plain Picard iterations. It has no effect with the
+     * "Newton" nonlinear solver.
+     *
+     * \param depth Number of previous iterates to use (0 disables acceleration)
+     */
+    void setAndersonDepth(const arma::uword depth);
+
+    /*!
+     * \brief Set the order of the predictor used for the initial guess.
+     *
+     * By default the iterations start from the current state. With a predictor
+     * of order 1 or 2 the flow, pressure and temperature are instead
+     * extrapolated (linearly or quadratically) from the last two or three
+     * states returned by solve(). This is only done when each call continues
+     * from the state returned by the previous call, and otherwise falls back
+     * to the current state.
+     *
+     * \param order Predictor order (0, 1 or 2)
+     */
+    void setPredictorOrder(const arma::uword order);
+
+    /*!
+     * \brief Remove the state returned by the last call to
+     * solveWithIterations() from the predictor history.
+     *
+     * Used when the caller rejects that state, for example when an adaptive
+     * time step is retried with a shorter step, so the predictor keeps
+     * extrapolating from the accepted states. Does nothing if the last call
+     * did not add a state (it threw, or this was already called).
+     */
+    void rejectLastState();
+
     //! Return the number of iterations performed during previous solution attempt
     arma::uword nIterations() const { return m_nIterations; }
 
@@ -150,6 +219,12 @@ public:
     const std::string& toleranceType() const { return m_toleranceType; }
     //! Get (const ref) tolerances
     const arma::vec& tolerances() const { return m_tolerances; }
+    //! Get (const ref) nonlinear solver
+    const std::string& nonlinearSolver() const { return m_nonlinearSolver; }
+    //! Get history depth of Anderson acceleration
+    arma::uword andersonDepth() const { return m_andersonDepth; }
+    //! Get order of the predictor
+    arma::uword predictorOrder() const { return m_predictorOrder; }
     //! Get (const ref) GoverningEquationSolver
     const GoverningEquationSolverBase& governingEquationSolver() const { return *m_governingEquationSolver; }
 
@@ -174,6 +249,22 @@ private:
     //! The maximum number of iterations to perform, or (if m_bruteForce is
     //! true) the exact number of iterations to perform.
     arma::uword m_maxIterations;
+    //! The nonlinear solver ("Picard" or "Newton").
+    std::string m_nonlinearSolver = "Picard";
+    //! Number of previous iterates used for Anderson acceleration (0 means
+    //! no acceleration).
+    arma::uword m_andersonDepth = 0;
+    //! Order of the predictor used for the initial guess (0 means no
+    //! predictor).
+    arma::uword m_predictorOrder = 0;
+    //! Flow, pressure and temperature (columns) of the most recent states
+    //! returned by solveWithIterations(), oldest first. Used by the predictor.
+    mutable std::vector<arma::mat> m_acceptedStates;
+    //! Times of m_acceptedStates [s], relative to the first one.
+    mutable std::vector<double> m_acceptedTimes;
+    //! If the last state in m_acceptedStates was added by the last call to
+    //! solveWithIterations(), and can be removed by rejectLastState().
+    mutable bool m_lastStateIsPending = false;
     //! The number of iterations performed during the previous solution attempt.
     //! This is mutable, and is updated in Solver::solve().
     mutable arma::uword m_nIterations = 0;
@@ -200,9 +291,70 @@ private:
      * and nGridPoints.
      * \param discretizer Discretizer type ("InternalEnergy" or "Enthalpy")
      * \param nGridPoints Number of grid points
+     * \param linearSolver Linear solver backend ("SuperLU" or "Banded")
      * \return unique_ptr to GoverningEquationSolverBase
      */
     std::unique_ptr<GoverningEquationSolverBase> makeGoverningEquationSolver(
             const arma::uword nGridPoints,
-            const std::string& discretizer);
+            const std::string& discretizer,
+            const std::string& linearSolver = "Banded");
+
+    /*!
+     * \brief Private method performing one step of Anderson acceleration.
+     *
+     * Appends the latest residual and update to the history (dropping the
+     * oldest entries beyond m_andersonDepth), and replaces the flow, pressure
+     * and temperature of guess with the accelerated update. The history is
+     * restarted, and guess left unchanged, if the least-squares problem cannot
+     * be solved or the accelerated state is non-physical.
+     *
+     * \param residual Scaled residual (update minus previous iterate)
+     * \param update Scaled (relaxed) Picard update
+     * \param scale Scale of flow, pressure and temperature
+     * \param residualDifferences History of residual differences (columns)
+     * \param updateDifferences History of update differences (columns)
+     * \param previousResidual Residual of the previous iteration
+     * \param previousUpdate Update of the previous iteration
+     * \param guess State holding the plain update, overwritten with the
+     * accelerated update
+     */
+    void accelerate(
+            const arma::vec& residual,
+            const arma::vec& update,
+            const arma::vec& scale,
+            arma::mat& residualDifferences,
+            arma::mat& updateDifferences,
+            arma::vec& previousResidual,
+            arma::vec& previousUpdate,
+            Pipeline& guess) const;
+
+    /*!
+     * \brief Private method extrapolating flow, pressure and temperature from
+     * m_acceptedStates to time dt after current.
+     *
+     * \param dt Time step [s]
+     * \param current Current pipeline state
+     * \param guess State to write the extrapolation into
+     * \return True if guess was updated
+     */
+    bool predict(
+            const arma::uword dt,
+            const Pipeline& current,
+            Pipeline& guess) const;
+
+    /*!
+     * \brief Private method storing the state returned by solveWithIterations()
+     * for use by the predictor.
+     *
+     * Keeps one state more than the predictor needs, so the history is
+     * complete also after rejectLastState().
+     *
+     * \param dt Time step [s]
+     * \param current State at the start of the time step
+     * \param output State at the end of the time step
+     */
+    void acceptState(
+            const arma::uword dt,
+            const Pipeline& current,
+            const Pipeline& output) const;
 };
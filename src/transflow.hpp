@@ -14,6 +14,7 @@
 #include "equationofstate/bwrs.hpp"
 #include "equationofstate/gerg04.hpp"
 #include "equationofstate/idealgas.hpp"
+#include "equationofstate/tabulatedeos.hpp"
 
 #include "solver/discretizer/enthalpy.hpp"
 #include "solver/discretizer/internalenergy.hpp"
@@ -1,6 +1,9 @@
 #include "utilities/numerics.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <iomanip>
+#include <stdexcept>
 
 using std::cout;
 using std::endl;
@@ -56,3 +59,193 @@ arma::vec utils::tridag(const vec &a, const vec &b, const vec &c, const vec &r,
 
     return u;
 }
+
+// Methods for solving band diagonal linear system of equations
+// Source: p. 53-55 in "Numerical Recipes" (section 2.4)
+/*
+    LU decomposition with partial pivoting of a band diagonal matrix A of size
+    n x n, with m1 subdiagonal rows and m2 superdiagonal rows. The bandwidth is
+    m1 + m2 + 1.
+
+    Unlike Numerical Recipes, the compact storage is transposed, so that each
+    COLUMN of a contains one row of A (arma matrices are column major), and the
+    diagonal elements of A are stored in row m1 of a:
+
+        a(m1 + j - i, i) = A(i, j)
+
+    On output a contains the upper triangular matrix, and al the lower
+    triangular matrix (also transposed, dimensions m1 x n). indx records the
+    row permutation.
+
+    Throws std::runtime_error if the matrix is singular, like arma::spsolve.
+*/
+void utils::bandec(arma::mat& a, const uword m1, const uword m2, arma::mat& al, arma::uvec& indx)
+{
+    const uword n = a.n_cols;
+    const uword mm = m1 + m2 + 1;
+    if (a.n_rows != mm)
+        throw std::invalid_argument("bandec: wrong number of rows in band storage");
+
+    al.zeros(m1, n);
+    indx.set_size(n);
+
+    // rearrange the storage of the first m1 rows of A, so that the leftmost
+    // element of each row is stored at the top of the column of a
+    for (uword i = 0; i < std::min(m1, n); i++)
+    {
+        const uword shift = m1 - i;
+        for (uword j = shift; j < mm; j++)
+            a(j - shift, i) = a(j, i);
+        for (uword j = mm - shift; j < mm; j++)
+            a(j, i) = 0;
+    }
+
+    for (uword k = 0; k < n; k++)
+    {
+        const uword last = std::min(k + m1, n - 1);
+
+        // find the pivot element
+        double pivot = a(0, k);
+        uword ipivot = k;
+        for (uword j = k + 1; j <= last; j++)
+        {
+            if (std::abs(a(0, j)) > std::abs(pivot))
+            {
+                pivot = a(0, j);
+                ipivot = j;
+            }
+        }
+        indx(k) = ipivot;
+
+        if (pivot == 0.0)
+            throw std::runtime_error("bandec: matrix is singular");
+
+        if (ipivot != k)
+            a.swap_cols(k, ipivot);
+
+        // eliminate
+        for (uword i = k + 1; i <= last; i++)
+        {
+            const double factor = a(0, i)/a(0, k);
+            al(i - k - 1, k) = factor;
+            for (uword j = 1; j < mm; j++)
+                a(j - 1, i) = a(j, i) - factor*a(j, k);
+            a(mm - 1, i) = 0;
+        }
+    }
+}
+
+/*
+    Solve Ax = b, using the decomposition of A found by bandec(). The solution
+    is returned in b (overwrites the input). Can be called repeatedly with
+    different b.
+*/
+void utils::banbks(const arma::mat& a, const uword m1, const uword m2, const arma::mat& al, const arma::uvec& indx, vec& b)
+{
+    const uword n = a.n_cols;
+    const uword mm = m1 + m2 + 1;
+
+    // forward substitution, unscrambling the permuted rows as we go
+    for (uword k = 0; k < n; k++)
+    {
+        const uword i = indx(k);
+        if (i != k)
+            std::swap(b(k), b(i));
+
+        const uword last = std::min(k + m1, n - 1);
+        for (uword j = k + 1; j <= last; j++)
+            b(j) -= al(j - k - 1, k)*b(k);
+    }
+
+    // backsubstitution
+    uword l = 1;
+    for (uword i = n; i-- > 0;)
+    {
+        double sum = b(i);
+        for (uword k = 1; k < l; k++)
+            sum -= a(k, i)*b(k + i);
+        b(i) = sum/a(0, i);
+        if (l < mm)
+            l++;
+    }
+}
+
+/*
+    Least squares solution of the over-determined band diagonal system Ax = b,
+    where A has m rows and n columns (m >= n), with m1 subdiagonal rows and m2
+    superdiagonal rows. A is stored in the same (transposed) compact form as
+    for bandec():
+
+        a(m1 + j - i, i) = A(i, j)
+
+    with one column per row of A (m columns).
+
+    Uses QR decomposition with Givens rotations, which gives the same solution
+    as dense QR, but in O(m) operations. The upper triangular R has m1 + m2
+    superdiagonals, so each row is stored with room for the fill-in.
+
+    Throws std::runtime_error if A is rank deficient.
+*/
+vec utils::banlsq(const arma::mat& a, const uword m1, const uword m2, const uword n, vec b)
+{
+    const uword m = a.n_cols;
+    if (a.n_rows != m1 + m2 + 1)
+        throw std::invalid_argument("banlsq: wrong number of rows in band storage");
+    if (m < n || b.n_elem != m)
+        throw std::invalid_argument("banlsq: incompatible size");
+
+    // work storage, w(m1 + j - i, i) = A(i, j), with room for m1 extra
+    // superdiagonals in each row
+    const uword width = 2*m1 + m2 + 1;
+    arma::mat w = zeros<arma::mat>(width, m);
+    w.rows(0, m1 + m2) = a;
+
+    for (uword j = 0; j < n; j++)
+    {
+        const uword lastRow = std::min(j + m1, m - 1);
+        const uword lastCol = std::min(j + m1 + m2, n - 1);
+        for (uword i = j + 1; i <= lastRow; i++)
+        {
+            // rotate rows j and i to eliminate A(i, j)
+            const double aij = w(m1 + j - i, i);
+            if (aij == 0.0)
+                continue;
+
+            const double ajj = w(m1, j);
+            const double r = std::hypot(ajj, aij);
+            const double c = ajj/r;
+            const double s = aij/r;
+
+            for (uword col = j; col <= lastCol; col++)
+            {
+                double& x1 = w(m1 + col - j, j);
+                double& x2 = w(m1 + col - i, i);
+                const double t1 = x1;
+                const double t2 = x2;
+                x1 = c*t1 + s*t2;
+                x2 = -s*t1 + c*t2;
+            }
+
+            const double t1 = b(j);
+            const double t2 = b(i);
+            b(j) = c*t1 + s*t2;
+            b(i) = -s*t1 + c*t2;
+        }
+    }
+
+    // backsubstitution with the upper triangular R
+    vec x = zeros<vec>(n);
+    for (uword j = n; j-- > 0;)
+    {
+        if (w(m1, j) == 0.0)
+            throw std::runtime_error("banlsq: matrix is rank deficient");
+
+        double sum = b(j);
+        const uword lastCol = std::min(j + m1 + m2, n - 1);
+        for (uword col = j + 1; col <= lastCol; col++)
+            sum -= w(m1 + col - j, j)*x(col);
+        x(j) = sum/w(m1, j);
+    }
+
+    return x;
+}
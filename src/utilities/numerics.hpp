@@ -6,4 +6,13 @@ namespace utils
 {
     arma::vec tridag(const arma::vec& a, const arma::vec& b, const arma::vec& c,
                      const arma::vec& r, const arma::uword n);
+
+    void bandec(arma::mat& a, const arma::uword m1, const arma::uword m2,
+                arma::mat& al, arma::uvec& indx);
+
+    void banbks(const arma::mat& a, const arma::uword m1, const arma::uword m2,
+                const arma::mat& al, const arma::uvec& indx, arma::vec& b);
+
+    arma::vec banlsq(const arma::mat& a, const arma::uword m1, const arma::uword m2,
+                     const arma::uword n, arma::vec b);
 }
@@ -0,0 +1,118 @@
+#include "threadpool.hpp"
+
+#include <utility>
+
+using arma::uword;
+
+utils::ThreadPool::ThreadPool(const uword threads)
+{
+    uword n = threads;
+    if (n == 0)
+    {
+        n = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    // the calling thread runs the first range
+    for (uword i = 1; i < n; i++)
+    {
+        m_workers.emplace_back(&ThreadPool::work, this, i);
+    }
+}
+
+utils::ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_start.notify_all();
+
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void utils::ThreadPool::parallelFor(const uword n, const RangeFunction& function)
+{
+    if (m_workers.empty() || n < 2)
+    {
+        if (n > 0)
+            function(0, n);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_function = &function;
+        m_n = n;
+        m_pending = m_workers.size();
+        m_exception = nullptr;
+        m_generation++;
+    }
+    m_start.notify_all();
+
+    runRange(function, n, 0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+    m_function = nullptr;
+
+    if (m_exception)
+    {
+        std::rethrow_exception(std::exchange(m_exception, nullptr));
+    }
+}
+
+void utils::ThreadPool::work(const uword thread)
+{
+    uword generation = 0;
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_start.wait(lock, [&] { return m_stop || m_generation != generation; });
+        if (m_stop)
+        {
+            return;
+        }
+
+        generation = m_generation;
+        const RangeFunction& function = *m_function;
+        const uword n = m_n;
+        lock.unlock();
+
+        runRange(function, n, thread);
+
+        lock.lock();
+        m_pending--;
+        if (m_pending == 0)
+        {
+            m_done.notify_one();
+        }
+    }
+}
+
+void utils::ThreadPool::runRange(const RangeFunction& function, const uword n, const uword thread)
+{
+    const uword threads = size();
+    const uword begin = n*thread/threads;
+    const uword end = n*(thread + 1)/threads;
+    if (begin == end)
+    {
+        return;
+    }
+
+    try
+    {
+        function(begin, end);
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_exception)
+        {
+            m_exception = std::current_exception();
+        }
+    }
+}
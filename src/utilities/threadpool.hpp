@@ -0,0 +1,79 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <armadillo>
+
+namespace utils
+{
+    /*!
+     * \brief The ThreadPool class runs loops over independent grid points on
+     * a fixed set of worker threads.
+     *
+     * The threads are started once, and wait between calls to parallelFor(),
+     * so the cost of a call is a wake-up rather than a thread creation. A pool
+     * of size 1 has no worker threads, and parallelFor() just calls the
+     * function on the calling thread.
+     *
+     * parallelFor() must only be called from one thread at a time, and not
+     * from within a function passed to parallelFor().
+     */
+    class ThreadPool
+    {
+    public:
+        //! Function called with a range [begin, end) of indices
+        using RangeFunction = std::function<void(const arma::uword begin, const arma::uword end)>;
+
+        /*!
+         * \brief ThreadPool constructor.
+         * \param threads Number of threads, including the thread calling
+         * parallelFor(). Uses the number of hardware threads if 0.
+         */
+        explicit ThreadPool(const arma::uword threads = 1);
+
+        //! Stops and joins the worker threads
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        //! Number of threads, including the thread calling parallelFor()
+        arma::uword size() const { return m_workers.size() + 1; }
+
+        /*!
+         * \brief Call function for contiguous ranges [begin, end) which
+         * together cover [0, n), one range per thread, and wait for all of
+         * them to finish.
+         *
+         * If function throws, the first exception is rethrown on the calling
+         * thread after all the ranges have finished.
+         *
+         * \param n Number of indices
+         * \param function Function called with each range
+         */
+        void parallelFor(const arma::uword n, const RangeFunction& function);
+
+    private:
+        //! Worker thread main loop
+        void work(const arma::uword thread);
+
+        //! Run the range of the given thread, and store any exception thrown
+        void runRange(const RangeFunction& function, const arma::uword n, const arma::uword thread);
+
+        std::vector<std::thread> m_workers; //!< Worker threads
+
+        std::mutex m_mutex; //!< Protects the members below
+        std::condition_variable m_start; //!< Signals a new loop (or stop) to the workers
+        std::condition_variable m_done; //!< Signals that the last worker finished
+        const RangeFunction* m_function = nullptr; //!< Function of the current loop
+        arma::uword m_n = 0; //!< Number of indices in the current loop
+        arma::uword m_generation = 0; //!< Incremented for each loop
+        arma::uword m_pending = 0; //!< Number of workers still running the current loop
+        bool m_stop = false; //!< Tells the workers to exit
+        std::exception_ptr m_exception; //!< First exception thrown in the current loop
+    };
+}
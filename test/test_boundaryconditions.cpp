@@ -349,3 +349,32 @@ TEST_CASE("SingleCondition")
         CHECK(s.value() == 2);
     }
 }
+
+TEST_CASE("BoundaryConditionsStamped::interpolate")
+{
+    BoundaryConditions lower(1, 2, 3, 4, 5, 6, Composition::defaultComposition, Composition::defaultComposition);
+    BoundaryConditions upper(3, 4, 5, 6, 7, 8, Composition::defaultComposition, Composition::defaultComposition);
+    upper.setBoundarySettings({"outlet", "inlet", "both"});
+
+    const BoundaryConditionsStamped bc = BoundaryConditionsStamped::interpolate(
+                BoundaryConditionsStamped(100, lower),
+                BoundaryConditionsStamped(200, upper),
+                150);
+
+    CHECK(bc.timestamp() == 150);
+    CHECK(bc.inletFlow().value() == doctest::Approx(2));
+    CHECK(bc.outletFlow().value() == doctest::Approx(3));
+    CHECK(bc.inletPressure().value() == doctest::Approx(4));
+    CHECK(bc.outletPressure().value() == doctest::Approx(5));
+    CHECK(bc.inletTemperature().value() == doctest::Approx(6));
+    CHECK(bc.outletTemperature().value() == doctest::Approx(7));
+
+    // active conditions are taken from the upper boundary conditions
+    for (arma::uword i = 0; i < 3; i++)
+    {
+        CHECK(bc.inlet(i).isActive() == upper.inlet(i).isActive());
+        CHECK(bc.outlet(i).isActive() == upper.outlet(i).isActive());
+    }
+
+    CHECK(arma::approx_equal(bc.inletComposition().vec(), Composition::defaultComposition.vec(), "absdiff", 1e-12));
+}
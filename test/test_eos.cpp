@@ -3,6 +3,8 @@
 #include "equationofstate/bwrs.hpp"
 #include "equationofstate/gerg04.hpp"
 #include "equationofstate/idealgas.hpp"
+#include "equationofstate/mixturecache.hpp"
+#include "equationofstate/tabulatedeos.hpp"
 #include "composition.hpp"
 
 using namespace arma;
@@ -91,4 +93,160 @@ TEST_CASE("Check that 10 components work")
     }
 }
 
+TEST_CASE("evaluateBatch agrees with evaluate")
+{
+    const Composition c = Composition({85, 7, 3, 1, 1, 1, 1, 0.5, 0.5, 0.5}).normalize();
+    const vec p = {5e6, 10e6, 15e6};
+    const vec T = {263.15, 273.15, 293.15};
+
+    // one column per state, the last one different from the others
+    mat composition = repmat(c.vec(), 1, 3);
+    composition.col(2) = Composition::defaultComposition;
+
+    auto check = [&](EquationOfStateBase& eos)
+    {
+        mat output;
+        eos.evaluateBatch(p, T, composition, output);
+        REQUIRE(output.n_rows == 3);
+        REQUIRE(output.n_cols == 7);
+
+        for (uword i = 0; i < 3; i++)
+        {
+            const vec expected = eos.evaluate(p(i), T(i), composition.col(i));
+            for (uword j = 0; j < 6; j++)
+            {
+                CHECK(output(i, j) == doctest::Approx(expected(j)));
+            }
+            CHECK(output(i, 6) == doctest::Approx(eos.getMolarMassOfMixture()));
+        }
+
+        CHECK_THROWS_AS(eos.evaluateBatch(p, vec(2), composition, output), std::invalid_argument);
+    };
+
+    SUBCASE("BWRS")
+    {
+        BWRS eos(c);
+        check(eos);
+    }
+
+    SUBCASE("GERG04")
+    {
+        GERG04 eos(c);
+        check(eos);
+    }
+
+    SUBCASE("IdealGas")
+    {
+        IdealGas eos(c);
+        check(eos);
+    }
+
+    SUBCASE("TabulatedEOS")
+    {
+        TabulatedEOS eos("BWRS", c);
+        check(eos);
+    }
+}
+
+TEST_CASE("DensityState")
+{
+    const Composition c = Composition({85, 7, 3, 1, 1, 1, 1, 0.5, 0.5, 0.5}).normalize();
+    const double p0 = 8e6;
+    const double T0 = 283.15;
+    const double p1 = p0*1.01;
+    const double T1 = T0 + 0.5;
+
+    EquationOfStateBase::DensityState empty;
+    CHECK_FALSE(empty.valid());
+    CHECK(empty.extrapolate(p0, T0) == 0);
+
+    auto check = [&](const EquationOfStateBase& eos, auto findDensity)
+    {
+        EquationOfStateBase::DensityState state;
+        eos.evaluate(p0, T0, state);
+        REQUIRE(state.valid());
+        CHECK(state.density == doctest::Approx(findDensity(p0, T0)).epsilon(1e-4));
+
+        // the extrapolated guess is accurate to first order
+        CHECK(state.extrapolate(p1, T1) == doctest::Approx(findDensity(p1, T1)).epsilon(1e-3));
+
+        // and gives the same result as starting from an ideal gas
+        const vec warm = eos.evaluate(p1, T1, state);
+        const vec cold = eos.evaluate(p1, T1);
+        for (uword i = 0; i < 6; i++)
+        {
+            CHECK(warm(i) == doctest::Approx(cold(i)).epsilon(1e-3));
+        }
+        CHECK(state.pressure == p1);
+        CHECK(state.temperature == T1);
+    };
+
+    SUBCASE("BWRS")
+    {
+        BWRS eos(c);
+        check(eos, [&](double p, double T) { return eos.findDensity(p, T, 1e-10); });
+    }
+
+    SUBCASE("GERG04")
+    {
+        GERG04 eos(c);
+        check(eos, [&](double p, double T) { return eos.findDensity(p, T); });
+    }
+}
+
+TEST_CASE("MixtureCache")
+{
+    const vec c = Composition({85, 7, 3, 1, 1, 1, 1, 0.5, 0.5, 0.5}).normalize().vec();
+
+    SUBCASE("calculated once per composition and tag")
+    {
+        MixtureCache<double>::clear();
+        uword calls = 0;
+        auto calculate = [&calls](const vec& x) { calls++; return x(0); };
+
+        CHECK(*MixtureCache<double>::get("a", c, calculate) == c(0));
+        CHECK(*MixtureCache<double>::get("a", c, calculate) == c(0));
+        CHECK(calls == 1);
+
+        // round-off does not matter
+        vec perturbed = c;
+        perturbed(0) += 1e-16;
+        MixtureCache<double>::get("a", perturbed, calculate);
+        CHECK(calls == 1);
+
+        // other tags and compositions are different entries
+        MixtureCache<double>::get("b", c, calculate);
+        CHECK(calls == 2);
+        MixtureCache<double>::get("a", vec(Composition::defaultComposition), calculate);
+        CHECK(calls == 3);
+        CHECK(MixtureCache<double>::size() == 3);
+
+        MixtureCache<double>::clear();
+        CHECK(MixtureCache<double>::size() == 0);
+    }
+
+    SUBCASE("shared coefficients give the same result")
+    {
+        // compare instances that change composition (using the cache) with
+        // instances constructed with that composition
+        BWRS bwrs1, bwrs2;
+        GERG04 gerg1, gerg2;
+        for (EquationOfStateBase* eos : {
+                 static_cast<EquationOfStateBase*>(&bwrs1),
+                 static_cast<EquationOfStateBase*>(&bwrs2),
+                 static_cast<EquationOfStateBase*>(&gerg1),
+                 static_cast<EquationOfStateBase*>(&gerg2)})
+        {
+            eos->setComposition(c);
+        }
+
+        const vec bwrs = BWRS(c).evaluate(10e6, 273.15);
+        const vec gerg = GERG04(c).evaluate(10e6, 273.15);
+        CHECK(arma::approx_equal(bwrs1.evaluate(10e6, 273.15), bwrs, "absdiff", 0));
+        CHECK(arma::approx_equal(bwrs2.evaluate(10e6, 273.15), bwrs, "absdiff", 0));
+        CHECK(arma::approx_equal(gerg1.evaluate(10e6, 273.15), gerg, "absdiff", 0));
+        CHECK(arma::approx_equal(gerg2.evaluate(10e6, 273.15), gerg, "absdiff", 0));
+    }
+}
+
 TEST_SUITE_END();
@@ -75,4 +75,20 @@ TEST_CASE("BWRS vs. SIM with no C1")
 //GERG: D 333,9 kg/m³, Z 0,5616
 }
 
+TEST_CASE("Parameters are loaded once and shared")
+{
+    BWRS a;
+    BWRS b(Composition::defaultComposition, "Calsep");
+    BWRS c(Composition::defaultComposition, "Starling");
+    CHECK(&a.parameters() == &b.parameters());
+    CHECK(&a.parameters() != &c.parameters());
+    CHECK(a.parameters().binaryInteraction.n_rows == 10);
+    CHECK(a.parameters().binaryInteraction.n_cols == 10);
+
+    // the default files are the same as the "Calsep" parameter set
+    BWRS d = BWRS::fromFilePaths();
+    CHECK(&a.parameters() == &d.parameters());
+    CHECK(arma::approx_equal(a.evaluate(10e6, 273.15), d.evaluate(10e6, 273.15), "absdiff", 0));
+}
+
 TEST_SUITE_END();
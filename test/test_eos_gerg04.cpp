@@ -1,7 +1,10 @@
 #include "debug.hpp"
 #include "equationofstate/gerg04.hpp"
 #include "equationofstate/bwrs.hpp"
+#include "equationofstate/gerg04coefficients.hpp"
+#include "utilities/utilities.hpp"
 #include "composition.hpp"
+#include <filesystem>
 #include <iostream>
 #include <iomanip>
 #include <string>
@@ -41,6 +44,9 @@ TEST_CASE("GERG 2004")
             // allow 0.1 % error, since we have fixed some bugs in JFH implementation
             CHECK(Z(i) == doctest::Approx(Z_JFH(i)).epsilon(0.001));
         }
+
+        // evaluated from the same residual sums
+        CHECK(eos.findSpeedOfSound(temperature, Z(13)) == doctest::Approx(Z(11)));
     }
 }
 
@@ -71,6 +77,103 @@ TEST_CASE("GERG04 and zeroed components")
     }
 }
 
+namespace
+{
+
+// compare a compiled-in table to its resource file
+template <std::size_t Rows, std::size_t Cols>
+void checkTable(const std::string& path, const std::string& name, const gerg04::Table2<Rows, Cols>& table)
+{
+    INFO(name);
+    const mat expected = utils::loadMatFromFile(path + name + ".h5", hdf5_binary);
+    REQUIRE(expected.n_rows == Rows);
+    REQUIRE(expected.n_cols == Cols);
+    uword nDifferent = 0;
+    for (uword i = 0; i < Rows; i++)
+        for (uword k = 0; k < Cols; k++)
+            nDifferent += table(i, k) != expected(i, k);
+    CHECK(nDifferent == 0);
+}
+
+template <std::size_t Rows, std::size_t Cols, std::size_t Slices>
+void checkTable(const std::string& path, const std::string& name, const gerg04::Table3<Rows, Cols, Slices>& table)
+{
+    INFO(name);
+    const cube expected = utils::loadCubeFromFile(path + name + ".h5", hdf5_binary);
+    REQUIRE(expected.n_rows == Rows);
+    REQUIRE(expected.n_cols == Cols);
+    REQUIRE(expected.n_slices == Slices);
+    uword nDifferent = 0;
+    for (uword i = 0; i < Rows; i++)
+        for (uword j = 0; j < Cols; j++)
+            for (uword k = 0; k < Slices; k++)
+                nDifferent += table(i, j, k) != expected(i, j, k);
+    CHECK(nDifferent == 0);
+}
+
+} // end anonymous namespace
+
+TEST_CASE("GERG04 coefficient tables match resource files")
+{
+    const std::string path = std::string(TRANSFLOW_RESOURCE_PATH) + "/equationofstate/gerg04/";
+
+    // every table in gerg04coefficients.hpp, one per resource file
+    checkTable(path, "betav", gerg04::betav);
+    checkTable(path, "betat", gerg04::betat);
+    checkTable(path, "gammav", gerg04::gammav);
+    checkTable(path, "gammat", gerg04::gammat);
+    checkTable(path, "noipol", gerg04::noipol);
+    checkTable(path, "doipol", gerg04::doipol);
+    checkTable(path, "toipol", gerg04::toipol);
+    checkTable(path, "noiexp", gerg04::noiexp);
+    checkTable(path, "doiexp", gerg04::doiexp);
+    checkTable(path, "coiexp", gerg04::coiexp);
+    checkTable(path, "toiexp", gerg04::toiexp);
+    checkTable(path, "Fij", gerg04::Fij);
+    checkTable(path, "nijpol", gerg04::nijpol);
+    checkTable(path, "dijpol", gerg04::dijpol);
+    checkTable(path, "tijpol", gerg04::tijpol);
+    checkTable(path, "nijexp", gerg04::nijexp);
+    checkTable(path, "dijexp", gerg04::dijexp);
+    checkTable(path, "tijexp", gerg04::tijexp);
+    checkTable(path, "nuijexp", gerg04::nuijexp);
+    checkTable(path, "epijexp", gerg04::epijexp);
+    checkTable(path, "beijexp", gerg04::beijexp);
+    checkTable(path, "gaijexp", gerg04::gaijexp);
+    checkTable(path, "noik", gerg04::noik);
+    checkTable(path, "voik", gerg04::voik);
+
+    // no resource file without a compiled-in table
+    uword nFiles = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(path))
+        nFiles += entry.path().extension() == ".h5";
+    CHECK(nFiles == 24);
+}
+
+
+TEST_CASE("GERG04 PowerLadder")
+{
+    // integer exponents in [0, maxExponent] are looked up
+    CHECK(GERG04::PowerLadder::index(0) == 0);
+    CHECK(GERG04::PowerLadder::index(1) == 1);
+    CHECK(GERG04::PowerLadder::index(8) == 8);
+    CHECK(GERG04::PowerLadder::maxExponent == 8);
+
+    // everything else falls back to std::pow
+    CHECK(GERG04::PowerLadder::index(9) == -1);
+    CHECK(GERG04::PowerLadder::index(-1) == -1);
+    CHECK(GERG04::PowerLadder::index(0.5) == -1);
+    CHECK(GERG04::PowerLadder::index(7.999999) == -1);
+
+    const double x = 0.7;
+    const GERG04::PowerLadder powers(x);
+    for (int d = 0; d <= GERG04::PowerLadder::maxExponent; d++)
+    {
+        CHECK(powers(GERG04::PowerLadder::index(d), d) == doctest::Approx(std::pow(x, d)).epsilon(1e-15));
+    }
+    CHECK(powers(GERG04::PowerLadder::index(9), 9) == std::pow(x, 9));
+    CHECK(powers(GERG04::PowerLadder::index(2.5), 2.5) == std::pow(x, 2.5));
+}
 
 TEST_CASE("GERG vs. SIM with no C1")
 {
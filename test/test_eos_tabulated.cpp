@@ -0,0 +1,187 @@
+#include "debug.hpp"
+#include "equationofstate/tabulatedeos.hpp"
+#include "equationofstate/bwrs.hpp"
+#include "equationofstate/equationofstate.hpp"
+#include "config.hpp"
+#include "pipeline.hpp"
+#include <filesystem>
+
+using namespace arma;
+
+namespace
+{
+
+TabulatedEOS::Grid testGrid()
+{
+    TabulatedEOS::Grid grid;
+    grid.minPressure = 1e6;
+    grid.maxPressure = 10e6;
+    grid.pressurePoints = 37;
+    grid.minTemperature = 263.15;
+    grid.maxTemperature = 313.15;
+    grid.temperaturePoints = 26;
+
+    return grid;
+}
+
+} // end anonymous namespace
+
+TEST_CASE("TabulatedEOS")
+{
+    const Composition c = Composition({85, 7, 3, 1, 1, 1, 1, 0.5, 0.5, 0.5}).normalize();
+    const TabulatedEOS::Grid grid = testGrid();
+    TabulatedEOS eos("BWRS", c, grid);
+    BWRS bwrs(c);
+
+    SUBCASE("interpolation agrees with the underlying equation of state")
+    {
+        for (const double p : {1.1e6, 3.33e6, 5e6, 7.77e6, 9.9e6})
+        {
+            for (const double T : {264.0, 278.3, 290.0, 312.5})
+            {
+                REQUIRE(eos.contains(p, T));
+                const vec out = eos.evaluate(p, T);
+                const vec expected = bwrs.evaluate(p, T);
+                CHECK(out(0) == doctest::Approx(expected(0)).epsilon(1e-5));
+                for (uword k = 1; k < 6; k++)
+                {
+                    CHECK(out(k) == doctest::Approx(expected(k)).epsilon(1e-2));
+                }
+                CHECK(eos.calculateCompressibility(p, T) == doctest::Approx(out(0)));
+            }
+        }
+
+        // exact at the nodes
+        const vec out = eos.evaluate(grid.minPressure, grid.maxTemperature);
+        const vec expected = bwrs.evaluate(grid.minPressure, grid.maxTemperature);
+        for (uword k = 0; k < 6; k++)
+        {
+            CHECK(out(k) == doctest::Approx(expected(k)));
+        }
+
+        REQUIRE(eos.errorEstimate().n_elem == 6);
+        CHECK(eos.errorEstimate()(0) < 1e-5);
+        CHECK(eos.errorEstimate().max() < 1e-2);
+    }
+
+    SUBCASE("outside the table the underlying equation of state is used")
+    {
+        const double p = 12e6;
+        const double T = 273.15;
+        CHECK_FALSE(eos.contains(p, T));
+        const vec out = eos.evaluate(p, T);
+        const vec expected = bwrs.evaluate(p, T);
+        for (uword k = 0; k < 6; k++)
+        {
+            CHECK(out(k) == doctest::Approx(expected(k)));
+        }
+    }
+
+    SUBCASE("invalid input")
+    {
+        TabulatedEOS::Grid invalid = grid;
+        invalid.pressurePoints = 2;
+        CHECK_THROWS_AS(TabulatedEOS("BWRS", c, invalid), std::invalid_argument);
+        CHECK_THROWS_AS(TabulatedEOS("IdealGas", c, grid), std::invalid_argument);
+    }
+}
+
+TEST_CASE("TabulatedEOS tables are saved and loaded")
+{
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() / "transflow_test_eos_tables";
+    std::filesystem::remove_all(directory);
+
+    const Composition c = Composition({80, 10, 4, 1, 1, 1, 1, 0.5, 1, 0.5}).normalize();
+    const TabulatedEOS::Grid grid = testGrid();
+    const vec first = TabulatedEOS("BWRS", c, grid, directory.string()).evaluate(5.5e6, 280);
+
+    REQUIRE(std::filesystem::is_directory(directory));
+    CHECK(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()) == 1);
+
+    // mark the saved table with an error estimate a rebuilt table can't have
+    const std::filesystem::path fileName = std::filesystem::directory_iterator(directory)->path();
+    arma::field<mat> fields;
+    REQUIRE(fields.load(fileName.string(), arma::arma_binary));
+    REQUIRE(fields.n_elem == 3);
+    fields(2).fill(0.125);
+    REQUIRE(fields.save(fileName.string(), arma::arma_binary));
+    const auto modified = std::filesystem::last_write_time(fileName);
+
+    // load from file instead of from memory
+    TabulatedEOS::clearTables();
+    const TabulatedEOS loaded("BWRS", c, grid, directory.string());
+    const vec second = loaded.evaluate(5.5e6, 280);
+    for (uword k = 0; k < 6; k++)
+    {
+        CHECK(second(k) == first(k));
+    }
+    CHECK(arma::all(loaded.errorEstimate() == 0.125));
+
+    // nothing was written
+    CHECK(std::filesystem::last_write_time(fileName) == modified);
+    CHECK(std::distance(std::filesystem::directory_iterator(directory), std::filesystem::directory_iterator()) == 1);
+
+    std::filesystem::remove_all(directory);
+}
+
+TEST_CASE("TabulatedEOS build limit")
+{
+    TabulatedEOS::clearTables();
+    const uword limit = TabulatedEOS::tableBuildLimit();
+    TabulatedEOS::setTableBuildLimit(1);
+
+    const TabulatedEOS::Grid grid = testGrid();
+    const Composition c1 = Composition({80, 10, 4, 1, 1, 1, 1, 0.5, 1, 0.5}).normalize();
+    const Composition c2 = Composition({90, 5, 1, 1, 0, 1, 0, 0, 1, 1}).normalize();
+
+    const TabulatedEOS first("BWRS", c1, grid);
+    CHECK(TabulatedEOS::builtTables() == 1);
+    CHECK(first.contains(5.5e6, 280));
+
+    // over the limit: no table, the underlying equation of state is used
+    TabulatedEOS second("BWRS", c2, grid);
+    CHECK(TabulatedEOS::builtTables() == 1);
+    CHECK_FALSE(second.contains(5.5e6, 280));
+    CHECK(second.errorEstimate().is_empty());
+    const vec expected = BWRS(c2).evaluate(5.5e6, 280);
+    const vec Z_factor = second.evaluate(5.5e6, 280);
+    for (uword k = 0; k < 6; k++)
+    {
+        CHECK(Z_factor(k) == expected(k));
+    }
+
+    // compositions with a table keep it
+    second.setComposition(c1);
+    CHECK(second.contains(5.5e6, 280));
+    CHECK(TabulatedEOS::builtTables() == 1);
+
+    TabulatedEOS::setTableBuildLimit(limit);
+    TabulatedEOS::clearTables();
+    CHECK(TabulatedEOS::builtTables() == 0);
+}
+
+TEST_CASE("TabulatedEOS from Config")
+{
+    Pipeline pipeline(5);
+    pipeline.pressure() = arma::linspace(6e6, 5e6, pipeline.size());
+    pipeline.temperature().fill(283.15);
+
+    Config config;
+    config.equationOfState = "BWRS-Table";
+    config.eosTablePressureRange = {1e6, 10e6};
+    config.eosTableTemperatureRange = {263.15, 313.15};
+    config.eosTablePressurePoints = 37;
+    config.eosTableTemperaturePoints = 26;
+
+    EquationOfState tabulated(pipeline, config);
+    EquationOfState exact(pipeline, "BWRS");
+    const mat out = tabulated.evaluate(pipeline);
+    const mat expected = exact.evaluate(pipeline);
+    for (uword i = 0; i < pipeline.size(); i++)
+    {
+        CHECK(out(i, 0) == doctest::Approx(expected(i, 0)).epsilon(1e-5));
+    }
+
+    config.equationOfState = "IdealGas-Table";
+    CHECK_THROWS_AS(EquationOfState(pipeline, config), std::invalid_argument);
+}
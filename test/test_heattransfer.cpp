@@ -13,6 +13,9 @@
 #include "heattransfer/pipewall.hpp"
 #include "heattransfer/burialmedium.hpp"
 #include "heattransfer/ambientfluid.hpp"
+#include "heattransfer/heattransfer.hpp"
+#include "heattransfer/heattransferstatematrix.hpp"
+#include "pipeline.hpp"
 
 using doctest::Approx;
 using namespace std;
@@ -42,6 +45,57 @@ TEST_CASE("Heat transfer state")
     CHECK(HeatTransferState(2.5).heatFlux() == 2.5);
 }
 
+TEST_CASE("Heat transfer state matrix")
+{
+    HeatTransferStateMatrix states(4);
+    CHECK(states.size() == 4);
+    CHECK(states.layers() == 0);
+    CHECK(states.at(2).hasTemperature() == false);
+    CHECK_THROWS(states.at(2).temperature());
+    CHECK_THROWS(states.at(4));
+
+    states.at(1) = HeatTransferState(3, {1, 2, 3});
+    CHECK(states.layers() == 3);
+    CHECK(states.isUniform() == false);
+    CHECK(states.at(1).heatFlux() == 3);
+    CHECK(states.at(1).hasTemperature() == true);
+    CHECK(arma::all(states.at(1).temperature() == vec({1, 2, 3})));
+
+    // fewer layers than the other grid points
+    states.back().setTemperature({4, 5});
+    CHECK(states.layers() == 3);
+    CHECK(states.layers(3) == 2);
+    CHECK(arma::all(states.back().temperature() == vec({4, 5})));
+
+    // conversion and copy between grid points
+    const HeatTransferState copy = states.at(1);
+    CHECK(copy.heatFlux() == 3);
+    CHECK(arma::all(copy.temperature() == vec({1, 2, 3})));
+    states.front() = states.at(1);
+    CHECK(states.front().heatFlux() == 3);
+    CHECK(arma::all(states.front().temperature() == vec({1, 2, 3})));
+    states.front() = HeatTransferState(1);
+    CHECK(states.front().hasTemperature() == false);
+
+    // from vector of states, and copies don't share memory
+    const HeatTransferStateMatrix fromVector({HeatTransferState(1, {1, 1}), HeatTransferState(2, {2, 2})});
+    CHECK(fromVector.isUniform());
+    CHECK(fromVector.layers() == 2);
+    CHECK(arma::all(fromVector.heatFlux() == vec({1, 2})));
+    CHECK(arma::all(arma::vectorise(fromVector.temperature()) == vec({1, 1, 2, 2})));
+
+    HeatTransferStateMatrix other = fromVector;
+    other.at(0).setTemperature({7, 7});
+    CHECK(fromVector.at(0).temperature()(0) == 1);
+
+    other.set({5, 6}, mat({{1, 2}, {3, 4}, {5, 6}}));
+    CHECK(other.layers() == 3);
+    CHECK(other.isUniform());
+    CHECK(other.at(1).heatFlux() == 6);
+    CHECK(arma::all(other.at(1).temperature() == vec({2, 4, 6})));
+    CHECK_THROWS(other.set({5}, mat({{1, 2}})));
+}
+
 TEST_CASE("makeState")
 {
     FixedQValue heat(1.0);
@@ -171,3 +225,123 @@ TEST_CASE("compare steady and unsteady heat")
 
     CHECK(out1.heatFlux() == doctest::Approx(out2.heatFlux()));
 }
+
+TEST_CASE("HeatTransfer evaluates Unsteady for all grid points together")
+{
+    const uword n = 7;
+    Pipeline pipeline(n);
+    pipeline.burialDepth() = linspace(0.5, 2.0, n);
+    pipeline.pressure() = linspace(8e6, 6e6, n);
+    pipeline.temperature() = linspace(300, 280, n);
+    pipeline.ambientTemperature().fill(277);
+    pipeline.reynoldsNumber() = linspace(1e5, 1e7, n);
+    pipeline.heatCapacityConstantPressure().fill(2200);
+    pipeline.viscosity().fill(1.1e-5);
+
+    const HeatTransfer heat(pipeline, "Unsteady");
+    for (uword i = 0; i < n; i++)
+    {
+        pipeline.heatTransferState().at(i) = heat.at(i).makeState(0, pipeline.temperature()(i), 277);
+    }
+    pipeline.heatTransferIsInitialized() = true;
+
+    const HeatTransferStateMatrix current = pipeline.heatTransferState();
+    for (const double dt : {60.0, 3600.0})
+    {
+        heat.evaluate(current, dt, pipeline);
+        for (uword i = 0; i < n; i++)
+        {
+            const HeatTransferState expected = heat.at(i).evaluate(
+                        current.at(i), dt, pipeline.ambientTemperature()(i),
+                        pipeline.pressure()(i), pipeline.temperature()(i),
+                        pipeline.reynoldsNumber()(i), pipeline.heatCapacityConstantPressure()(i),
+                        pipeline.viscosity()(i));
+
+            CHECK(pipeline.heatFlow()(i) == expected.heatFlux());
+            CHECK(pipeline.heatTransferState().at(i).heatFlux() == expected.heatFlux());
+            CHECK(arma::all(pipeline.heatTransferState().at(i).temperature() == expected.temperature()));
+
+            // the instances refer to their row of the batch, which must hold
+            // the same coefficients as an instance on its own
+            const UnsteadyHeatTransfer standalone(
+                        pipeline.diameter()(i), pipeline.pipeWall().at(i), pipeline.burialDepth()(i),
+                        pipeline.burialMedium().at(i), pipeline.ambientFluid().at(i));
+            const HeatTransferState own = standalone.evaluate(
+                        current.at(i), dt, pipeline.ambientTemperature()(i),
+                        pipeline.pressure()(i), pipeline.temperature()(i),
+                        pipeline.reynoldsNumber()(i), pipeline.heatCapacityConstantPressure()(i),
+                        pipeline.viscosity()(i));
+
+            CHECK(own.heatFlux() == expected.heatFlux());
+            CHECK(arma::all(own.temperature() == expected.temperature()));
+        }
+    }
+}
+
+TEST_CASE("HeatTransfer thermalize")
+{
+    const uword n = 6;
+    Pipeline pipeline(n);
+    pipeline.pressure().fill(7e6);
+    pipeline.temperature() = linspace(295, 285, n);
+    pipeline.ambientTemperature().fill(279);
+    pipeline.reynoldsNumber().fill(1e6);
+    pipeline.heatCapacityConstantPressure().fill(2100);
+    pipeline.viscosity().fill(1.2e-5);
+
+    SUBCASE("Unsteady")
+    {
+        // all grid points buried, or only some of them so the number of layers differs
+        for (const vec& burialDepth : {vec(zeros<vec>(n) + 1.0), vec({0, 0, 1, 1, 2, 2})})
+        {
+            pipeline.burialDepth() = burialDepth;
+            const HeatTransfer heat(pipeline, "Unsteady");
+            REQUIRE(heat.size() == n);
+
+            for (uword i = 0; i < n; i++)
+            {
+                pipeline.heatTransferState().at(i) = heat.at(i).makeState(0);
+            }
+            pipeline.heatTransferIsInitialized() = true;
+
+            heat.thermalize(pipeline);
+            for (uword i = 0; i < n; i++)
+            {
+                const auto& unsteady = dynamic_cast<const UnsteadyHeatTransfer&>(heat.at(i));
+                const HeatTransferState expected = unsteady.thermalizeToSteadyState(
+                            pipeline.ambientTemperature()(i), pipeline.pressure()(i),
+                            pipeline.temperature()(i), pipeline.reynoldsNumber()(i),
+                            pipeline.heatCapacityConstantPressure()(i), pipeline.viscosity()(i));
+
+                CHECK(pipeline.heatFlow()(i) == expected.heatFlux());
+                CHECK(pipeline.heatTransferState().at(i).heatFlux() == expected.heatFlux());
+                CHECK(arma::all(pipeline.heatTransferState().at(i).temperature() == expected.temperature()));
+            }
+
+            // a state with fewer layers than the model is rejected before any
+            // grid point is evaluated
+            HeatTransferStateMatrix wrong = pipeline.heatTransferState();
+            wrong.at(n - 1) = HeatTransferState(0, zeros<vec>(1));
+            const vec heatFlux = pipeline.heatTransferState().heatFlux();
+            CHECK_THROWS_AS(heat.evaluate(wrong, 60, pipeline), std::runtime_error);
+            CHECK(arma::all(pipeline.heatTransferState().heatFlux() == heatFlux));
+        }
+    }
+
+    SUBCASE("SteadyState")
+    {
+        const HeatTransfer heat(pipeline, "SteadyState");
+        CHECK(dynamic_cast<const SteadyStateHeatTransfer*>(&heat.at(n - 1)));
+        CHECK_THROWS(heat.at(n));
+
+        for (uword i = 0; i < n; i++)
+        {
+            pipeline.heatTransferState().at(i) = HeatTransferState(double(i));
+        }
+        pipeline.heatTransferIsInitialized() = true;
+
+        heat.thermalize(pipeline);
+        CHECK(arma::all(pipeline.heatFlow() == regspace(0, n - 1)));
+        CHECK(pipeline.heatTransferState().at(2).heatFlux() == 2);
+    }
+}
@@ -8,6 +8,7 @@ using arma::zeros;
 using arma::cube;
 using arma::endr;
 using arma::mat;
+using std::string;
 
 TEST_CASE("MatrixEquation::fillMatrixAndVector")
 {
@@ -38,6 +39,80 @@ TEST_CASE("MatrixEquation::fillMatrixAndVector")
     CHECK(s.constants().n_rows == 3*nGridPoints - 3);
 }
 
+TEST_CASE("MatrixEquation banded solver")
+{
+    CHECK_THROWS_AS(MatrixEquation("Unknown"), std::invalid_argument);
+
+    const uword nGridPoints = 20;
+    const uword N = 3;
+    arma::arma_rng::set_seed(1);
+    const cube term_i = arma::randu<cube>(nGridPoints - 1, N, N) + 1;
+    const cube term_ipp = arma::randu<cube>(nGridPoints - 1, N, N) - 2;
+    const mat boundaryTerms = arma::randu<mat>(nGridPoints - 1, N);
+
+    for (const string m : {"inlet", "outlet"})
+    {
+        for (const string p : {"inlet", "outlet"})
+        {
+            for (const string T : {"inlet", "outlet"})
+            {
+                BoundaryConditions bc(1.0, 2.0, 3.0, 4.0, 5.0, 6.0);
+                bc.setBoundarySettings({m, p, T});
+
+                MatrixEquation superlu("SuperLU");
+                MatrixEquation banded("Banded");
+                superlu.fillCoefficientMatrixAndConstantsVector(nGridPoints, N, bc, term_i, term_ipp, boundaryTerms);
+                banded.fillCoefficientMatrixAndConstantsVector(nGridPoints, N, bc, term_i, term_ipp, boundaryTerms);
+
+                const mat x1 = superlu.solve(nGridPoints, N, bc);
+                const mat x2 = banded.solve(nGridPoints, N, bc);
+
+                CHECK(equal(x1, x2, 1e-9));
+            }
+        }
+    }
+}
+
+TEST_CASE("MatrixEquation refill with cached sparsity pattern")
+{
+    const uword nGridPoints = 10;
+    const uword N = 3;
+    arma::arma_rng::set_seed(2);
+    const mat boundaryTerms = arma::randu<mat>(nGridPoints - 1, N);
+
+    BoundaryConditions bc(1.0, 2.0, 3.0, 4.0, 5.0, 6.0);
+
+    MatrixEquation reused;
+    MatrixEquation reusedBanded("Banded");
+    for (const auto& settings : {
+         std::vector<string>{"inlet", "outlet", "inlet"},
+         std::vector<string>{"inlet", "outlet", "inlet"}, // same pattern as above
+         std::vector<string>{"outlet", "inlet", "inlet"}, // new pattern
+         std::vector<string>{"inlet", "outlet", "both"}, // over-determined
+         std::vector<string>{"inlet", "outlet", "inlet"}})
+    {
+        bc.setBoundarySettings(settings);
+        const cube term_i = arma::randu<cube>(nGridPoints - 1, N, N) + 1;
+        const cube term_ipp = arma::randu<cube>(nGridPoints - 1, N, N) - 2;
+
+        MatrixEquation fresh;
+        fresh.fillCoefficientMatrixAndConstantsVector(nGridPoints, N, bc, term_i, term_ipp, boundaryTerms);
+        reused.fillCoefficientMatrixAndConstantsVector(nGridPoints, N, bc, term_i, term_ipp, boundaryTerms);
+
+        CHECK(reused.coefficients().n_rows == fresh.coefficients().n_rows);
+        CHECK(reused.coefficients().n_cols == fresh.coefficients().n_cols);
+        CHECK(equal(mat(reused.coefficients()), mat(fresh.coefficients())));
+        CHECK(equal(reused.constants(), fresh.constants()));
+        // element access goes through the element cache of sp_mat
+        CHECK(reused.coefficients()(0, 0) == fresh.coefficients()(0, 0));
+        CHECK(reused.coefficients()(N, 1) == fresh.coefficients()(N, 1));
+
+        // banded factorization reuses the band structure between solves
+        reusedBanded.fillCoefficientMatrixAndConstantsVector(nGridPoints, N, bc, term_i, term_ipp, boundaryTerms);
+        CHECK(equal(reusedBanded.solve(nGridPoints, N, bc), fresh.solve(nGridPoints, N, bc)));
+    }
+}
+
 // don't think it's my place to test the armadillo implementation
 //TEST_CASE("MatrixEquation test Ax = b solver")
 //{
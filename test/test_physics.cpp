@@ -120,6 +120,147 @@ TEST_CASE("update derived props")
     CHECK(arma::all(pipeline.frictionFactor() > 0));
 }
 
+TEST_CASE("EOS cache")
+{
+    Pipeline pipeline(10);
+    pipeline.pressure() = arma::linspace(10e6, 8e6, pipeline.size());
+    pipeline.temperature().fill(283.15);
+
+    Config config;
+    config.eosCacheTolerance = 1e-3;
+    Physics physics(pipeline, config);
+    const EquationOfState& eos = physics.equationOfState();
+    CHECK(eos.cacheTolerance() == 1e-3);
+
+    Pipeline reference(pipeline);
+    Physics(reference).updateDerivedProperties(reference);
+
+    // first evaluation evaluates all grid points
+    physics.updateDerivedProperties(pipeline);
+    CHECK(eos.cacheLookups() == 10);
+    CHECK(eos.cacheHits() == 0);
+    CHECK(arma::approx_equal(pipeline.compressibilityFactor(), reference.compressibilityFactor(), "absdiff", 0));
+
+    // change half the grid points below the tolerance, and the rest above
+    pipeline.pressure().head(5) *= 1 + 1e-4;
+    pipeline.pressure().tail(5) *= 1 + 1e-2;
+    reference.pressure() = pipeline.pressure();
+    Physics(reference).updateDerivedProperties(reference);
+
+    physics.updateDerivedProperties(pipeline);
+    CHECK(eos.cacheLookups() == 20);
+    CHECK(eos.cacheHits() == 5);
+    CHECK(eos.cacheHitRate() == doctest::Approx(0.25));
+
+    // reused grid points are corrected to first order
+    for (uword i = 0; i < pipeline.size(); i++)
+    {
+        CHECK(pipeline.compressibilityFactor()(i) == doctest::Approx(reference.compressibilityFactor()(i)).epsilon(1e-6));
+        CHECK(pipeline.heatCapacityConstantPressure()(i) == doctest::Approx(reference.heatCapacityConstantPressure()(i)).epsilon(1e-3));
+    }
+
+    // a change in composition is never reused
+    pipeline.updateComposition(Composition({85, 7, 3, 1, 1, 1, 1, 0.5, 0.5, 0.5}).normalize());
+    physics.updateDerivedProperties(pipeline);
+    CHECK(eos.cacheLookups() == 30);
+    CHECK(eos.cacheHits() == 5);
+
+    physics.updateDerivedProperties(pipeline);
+    CHECK(eos.cacheHits() == 15);
+
+    config.eosCacheTolerance = -1;
+    CHECK_THROWS_AS(Physics(pipeline, config), std::invalid_argument);
+}
+
+TEST_CASE("threads")
+{
+    Pipeline pipeline(50);
+    pipeline.pressure() = arma::linspace(10e6, 8e6, pipeline.size());
+    pipeline.temperature() = arma::linspace(293.15, 278.15, pipeline.size());
+    pipeline.flow().fill(300);
+    pipeline.roughness().fill(1e-5);
+
+    // different compositions, so each grid point is evaluated separately also
+    // when using a single thread
+    const Composition other = Composition({85, 7, 3, 1, 1, 1, 1, 0.5, 0.5, 0.5}).normalize();
+    vector<Composition> composition = pipeline.composition();
+    for (uword i = 0; i < pipeline.size(); i += 2)
+    {
+        composition.at(i) = other;
+    }
+    pipeline.updateComposition(composition);
+
+    for (const string eos : {"BWRS", "GERG04"})
+    {
+        Config config;
+        config.equationOfState = eos;
+        Pipeline serial(pipeline);
+        Physics(serial, config).updateDerivedProperties(serial);
+
+        config.threads = 4;
+        Physics physics(pipeline, config);
+        CHECK(physics.threads() == 4);
+        Pipeline parallel(pipeline);
+        physics.updateDerivedProperties(parallel);
+
+        CHECK(arma::approx_equal(parallel.compressibilityFactor(), serial.compressibilityFactor(), "reldiff", 1e-10));
+        CHECK(arma::approx_equal(parallel.heatCapacityConstantPressure(), serial.heatCapacityConstantPressure(), "reldiff", 1e-10));
+        CHECK(arma::approx_equal(parallel.molarMass(), serial.molarMass(), "absdiff", 0));
+        CHECK(arma::approx_equal(parallel.frictionFactor(), serial.frictionFactor(), "absdiff", 0));
+
+        // uniform composition
+        parallel.updateComposition(other);
+        serial.updateComposition(other);
+        physics.updateDerivedProperties(parallel);
+        Physics(serial, eos).updateDerivedProperties(serial);
+        CHECK(arma::approx_equal(parallel.compressibilityFactor(), serial.compressibilityFactor(), "reldiff", 1e-5));
+    }
+}
+
+TEST_CASE("threads heat transfer")
+{
+    Pipeline pipeline(50);
+    pipeline.pressure() = arma::linspace(10e6, 8e6, pipeline.size());
+    pipeline.temperature() = arma::linspace(293.15, 278.15, pipeline.size());
+    pipeline.ambientTemperature().fill(277.15);
+    pipeline.flow().fill(300);
+
+    // buried everywhere (batched unsteady evaluation), or only partly buried
+    // so the number of layers differs (each grid point evaluated separately)
+    for (const vec& burialDepth : {vec(zeros<vec>(pipeline.size()) + 1.0), vec(arma::linspace(-0.5, 1.0, pipeline.size()))})
+    {
+        pipeline.burialDepth() = burialDepth;
+        for (const string heat : {"Unsteady", "SteadyState"})
+        {
+            Config config;
+            config.equationOfState = "BWRS";
+            config.heatTransfer = heat;
+
+            Physics serialPhysics(pipeline, config);
+            config.threads = 4;
+            Physics parallelPhysics(pipeline, config);
+
+            // same derived properties for both, so the heat transfer should be identical
+            serialPhysics.updateDerivedProperties(pipeline);
+            Pipeline serial(pipeline);
+            Pipeline parallel(pipeline);
+
+            for (auto [physics, state] : {make_pair(&serialPhysics, &serial), make_pair(&parallelPhysics, &parallel)})
+            {
+                physics->initializeHeatTransferState(*state);
+                physics->thermalizeHeatTransfer(*state);
+                const Pipeline current(*state);
+                state->temperature() += 2;
+                physics->heatTransfer().evaluate(current.heatTransferState(), 60, *state);
+            }
+
+            CHECK(arma::approx_equal(parallel.heatFlow(), serial.heatFlow(), "absdiff", 0));
+            CHECK(arma::approx_equal(parallel.heatTransferState().heatFlux(), serial.heatTransferState().heatFlux(), "absdiff", 0));
+            CHECK(arma::approx_equal(parallel.heatTransferState().temperature(), serial.heatTransferState().temperature(), "absdiff", 0));
+        }
+    }
+}
+
 //TEST_CASE("Simulator simulate")
 //{
 //    auto state = std::make_shared<Pipeline>(10);
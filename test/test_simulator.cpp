@@ -128,4 +128,36 @@ TEST_CASE("New simulator simulate")
     CHECK(sim.state().temperature()(0) == pipeline.temperature()(0));
 }
 
+TEST_CASE("Simulator adaptive time step")
+{
+    Pipeline pipeline;
+    pipeline.flow().fill(100);
+    pipeline.pressure() = arma::linspace(10e6, 9.9e6, pipeline.size());
+    pipeline.temperature().fill(273.15 + 5);
+    pipeline.roughness().fill(5e-7);
+    pipeline.ambientTemperature().fill(273.15 + 5);
+
+    Config config;
+    config.adaptiveTimeStep = true;
+    config.minTimeStep = 60;
+    config.maxTimeStep = 3600;
+    Simulator sim(pipeline, config);
+
+    // constant boundary conditions, so the steps should be merged
+    const arma::uword dt = 60;
+    const arma::uword nSteps = 600;
+    TimeSeries ts(pipeline, nSteps, dt);
+    const vec nIterations = sim.simulate(ts);
+
+    CHECK(sim.pipeline().timestamp() == (nSteps - 1)*dt);
+    CHECK(arma::accu(nIterations > 0) < nSteps/10);
+
+    CHECK(sim.state().flow()(0) == doctest::Approx(pipeline.flow()(0)));
+    CHECK(sim.state().pressure().tail(1)(0) == doctest::Approx(pipeline.pressure().tail(1)(0)));
+    CHECK(sim.state().temperature()(0) == doctest::Approx(pipeline.temperature()(0)));
+
+    CHECK_THROWS_AS(sim.enableAdaptiveTimeStep(0, 10, 1e-3), std::invalid_argument);
+    CHECK_THROWS_AS(sim.enableAdaptiveTimeStep(100, 10, 1e-3), std::invalid_argument);
+}
+
 TEST_SUITE_END();
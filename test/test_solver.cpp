@@ -34,10 +34,31 @@ TEST_CASE("Constructors")
         CHECK(solver.tolerances()(2) == 0.003);
 
         CHECK(solver.toleranceType() == "absolute");
+        CHECK(solver.nonlinearSolver() == "Picard");
 
         CHECK(dynamic_cast<const GoverningEquationSolver<EnthalpyDiscretizer>*>(&solver.governingEquationSolver()));
         CHECK_FALSE(dynamic_cast<const GoverningEquationSolver<InternalEnergyDiscretizer>*>(&solver.governingEquationSolver()));
     }
+
+    SUBCASE("Nonlinear solver")
+    {
+        Config config;
+        config.nonlinearSolver = "Newton";
+        Solver solver(10, config);
+        CHECK(solver.nonlinearSolver() == "Newton");
+
+        config.andersonDepth = 3;
+        CHECK(Solver(10, config).andersonDepth() == 3);
+
+        config.predictorOrder = 2;
+        CHECK(Solver(10, config).predictorOrder() == 2);
+        config.predictorOrder = 3;
+        CHECK_THROWS_AS(Solver(10, config), std::invalid_argument);
+        config.predictorOrder = 0;
+
+        config.nonlinearSolver = "Secant";
+        CHECK_THROWS_AS(Solver(10, config), std::invalid_argument);
+    }
 }
 
 TEST_CASE("batch tracking evaluation correctly implemented")
@@ -246,6 +267,200 @@ TEST_CASE("Uniform test")
     CHECK(output.pressure()(0) == doctest::Approx(output.pressure().tail(1)(0)));
 }
 
+TEST_CASE("Newton agrees with Picard")
+{
+    const uword nGridPoints = 10;
+
+    Pipeline gas(nGridPoints);
+    gas.pressure().fill(1e6);
+    gas.temperature().fill(273.15);
+    gas.flow().fill(100);
+    gas.roughness().fill(0); // disable friction
+    gas.height().fill(0); // disable elevation changes
+    gas.diameter().fill(1); // uniform diameter
+
+    Physics physics(gas, "BWRS", "FixedQValue"); // no heat transfer
+    physics.updateDerivedProperties(gas); // initialize all derived properties
+    physics.initializeHeatTransferState(gas);
+
+    // step the inlet flow and outlet pressure so the solution is not uniform
+    const BoundaryConditions boundaryConditions(120, 100, 1e6, 0.98e6, 273.15, 273.15);
+    const arma::uword dt = 600;
+
+    Solver picard(nGridPoints);
+    Solver newton(nGridPoints);
+    newton.setNonlinearSolver("Newton");
+
+    const Pipeline expected = picard.solveWithIterations(dt, gas, boundaryConditions, physics);
+    const Pipeline output = newton.solveWithIterations(dt, gas, boundaryConditions, physics);
+
+    CHECK(newton.nIterations() <= picard.nIterations());
+    for (uword i = 0; i < nGridPoints; i++)
+    {
+        CHECK(output.flow()(i) == doctest::Approx(expected.flow()(i)).epsilon(1e-3));
+        CHECK(output.pressure()(i) == doctest::Approx(expected.pressure()(i)).epsilon(1e-4));
+        CHECK(output.temperature()(i) == doctest::Approx(expected.temperature()(i)).epsilon(1e-4));
+    }
+}
+
+TEST_CASE("Newton converges to the Picard solution with friction and heat transfer")
+{
+    // the heat capacity, friction factor and heat flux are not part of the
+    // (quasi-Newton) Jacobian, but the converged state should still be the
+    // same
+    const uword nGridPoints = 10;
+
+    Pipeline gas(nGridPoints);
+    gas.pressure().fill(5e6);
+    gas.temperature().fill(283.15);
+    gas.ambientTemperature().fill(278.15);
+    gas.flow().fill(200);
+    gas.roughness().fill(1e-5);
+    gas.height().fill(0); // disable elevation changes
+
+    Physics physics(gas, "BWRS", "SteadyState");
+    physics.updateDerivedProperties(gas); // initialize all derived properties
+    physics.initializeHeatTransferState(gas);
+
+    const BoundaryConditions boundaryConditions(220, 200, 5e6, 4.9e6, 288.15, 283.15);
+    const arma::uword dt = 600;
+
+    Solver picard(nGridPoints);
+    Solver newton(nGridPoints);
+    newton.setNonlinearSolver("Newton");
+
+    const Pipeline expected = picard.solveWithIterations(dt, gas, boundaryConditions, physics);
+    const Pipeline output = newton.solveWithIterations(dt, gas, boundaryConditions, physics);
+
+    for (uword i = 0; i < nGridPoints; i++)
+    {
+        CHECK(output.flow()(i) == doctest::Approx(expected.flow()(i)).epsilon(1e-3));
+        CHECK(output.pressure()(i) == doctest::Approx(expected.pressure()(i)).epsilon(1e-4));
+        CHECK(output.temperature()(i) == doctest::Approx(expected.temperature()(i)).epsilon(1e-4));
+        CHECK(output.heatFlow()(i) == doctest::Approx(expected.heatFlow()(i)).epsilon(1e-2));
+    }
+}
+
+TEST_CASE("Anderson acceleration agrees with Picard")
+{
+    const uword nGridPoints = 10;
+
+    Pipeline gas(nGridPoints);
+    gas.pressure().fill(1e6);
+    gas.temperature().fill(273.15);
+    gas.flow().fill(100);
+    gas.height().fill(0); // disable elevation changes
+
+    Physics physics(gas, "BWRS", "SteadyState");
+    physics.updateDerivedProperties(gas); // initialize all derived properties
+    physics.initializeHeatTransferState(gas);
+
+    const BoundaryConditions boundaryConditions(120, 100, 1e6, 0.98e6, 280, 273.15);
+    const arma::uword dt = 600;
+
+    Solver picard(nGridPoints);
+    Solver anderson(nGridPoints);
+    anderson.setAndersonDepth(3);
+
+    const Pipeline expected = picard.solveWithIterations(dt, gas, boundaryConditions, physics);
+    const Pipeline output = anderson.solveWithIterations(dt, gas, boundaryConditions, physics);
+
+    CHECK(anderson.nIterations() <= picard.nIterations());
+    for (uword i = 0; i < nGridPoints; i++)
+    {
+        CHECK(output.flow()(i) == doctest::Approx(expected.flow()(i)).epsilon(1e-2));
+        CHECK(output.pressure()(i) == doctest::Approx(expected.pressure()(i)).epsilon(1e-3));
+        CHECK(output.temperature()(i) == doctest::Approx(expected.temperature()(i)).epsilon(1e-3));
+    }
+}
+
+TEST_CASE("Predictor")
+{
+    const uword nGridPoints = 10;
+
+    Pipeline gas(nGridPoints);
+    gas.pressure().fill(1e6);
+    gas.temperature().fill(273.15);
+    gas.flow().fill(100);
+    gas.height().fill(0); // disable elevation changes
+
+    Physics physics(gas, "BWRS", "SteadyState");
+    physics.updateDerivedProperties(gas); // initialize all derived properties
+    physics.initializeHeatTransferState(gas);
+
+    Solver solver(nGridPoints);
+    Solver predictor(nGridPoints);
+    predictor.setPredictorOrder(2);
+
+    // smooth ramp of the inlet flow
+    const arma::uword dt = 600;
+    Pipeline expected = gas;
+    Pipeline output = gas;
+    arma::uword nIterations = 0;
+    arma::uword nIterationsPredictor = 0;
+    for (uword step = 1; step <= 10; step++)
+    {
+        const BoundaryConditions boundaryConditions(100 + 5*step, 100, 1e6, 0.98e6, 273.15, 273.15);
+
+        expected = solver.solve(dt, expected, boundaryConditions, physics);
+        nIterations += solver.nIterations();
+
+        output = predictor.solve(dt, output, boundaryConditions, physics);
+        nIterationsPredictor += predictor.nIterations();
+    }
+
+    CHECK(nIterationsPredictor <= nIterations);
+    for (uword i = 0; i < nGridPoints; i++)
+    {
+        CHECK(output.flow()(i) == doctest::Approx(expected.flow()(i)).epsilon(1e-2));
+        CHECK(output.pressure()(i) == doctest::Approx(expected.pressure()(i)).epsilon(1e-3));
+        CHECK(output.temperature()(i) == doctest::Approx(expected.temperature()(i)).epsilon(1e-3));
+    }
+}
+
+TEST_CASE("Predictor history after rejected step")
+{
+    const uword nGridPoints = 10;
+
+    Pipeline gas(nGridPoints);
+    gas.pressure().fill(1e6);
+    gas.temperature().fill(273.15);
+    gas.flow().fill(100);
+    gas.height().fill(0); // disable elevation changes
+
+    Physics physics(gas, "BWRS", "SteadyState");
+    physics.updateDerivedProperties(gas); // initialize all derived properties
+    physics.initializeHeatTransferState(gas);
+
+    Solver reference(nGridPoints);
+    Solver rejecting(nGridPoints);
+    reference.setPredictorOrder(2);
+    rejecting.setPredictorOrder(2);
+
+    const arma::uword dt = 600;
+    Pipeline state = gas;
+    for (uword step = 1; step <= 3; step++)
+    {
+        const BoundaryConditions boundaryConditions(100 + 5*step, 100, 1e6, 0.98e6, 273.15, 273.15);
+        rejecting.solveWithIterations(dt, state, boundaryConditions, physics);
+        state = reference.solveWithIterations(dt, state, boundaryConditions, physics);
+    }
+
+    // a longer trial step that is rejected should not affect the next step
+    const BoundaryConditions boundaryConditions(120, 100, 1e6, 0.98e6, 273.15, 273.15);
+    rejecting.solveWithIterations(2*dt, state, boundaryConditions, physics);
+    rejecting.rejectLastState();
+    rejecting.rejectLastState(); // no effect
+
+    const Pipeline expected = reference.solveWithIterations(dt, state, boundaryConditions, physics);
+    const Pipeline output = rejecting.solveWithIterations(dt, state, boundaryConditions, physics);
+
+    CHECK(rejecting.nIterations() == reference.nIterations());
+    CHECK(arma::approx_equal(output.flow(), expected.flow(), "absdiff", 0));
+    CHECK(arma::approx_equal(output.pressure(), expected.pressure(), "absdiff", 0));
+    CHECK(arma::approx_equal(output.temperature(), expected.temperature(), "absdiff", 0));
+}
+
 TEST_CASE("No flow, heat transfer test")
 {
 //    const uword nGridPoints = 10;
@@ -1,6 +1,7 @@
 #include "debug.hpp"
 #include "utilities/utilities.hpp"
 #include "utilities/numerics.hpp"
+#include "utilities/threadpool.hpp"
 
 using arma::zeros;
 using arma::uword;
@@ -99,6 +100,115 @@ TEST_CASE("numerics")
             CHECK(x1(i) == doctest::Approx(x2(i)));
         }
     }
+
+    SUBCASE("bandec and banbks")
+    {
+        // one subdiagonal and two superdiagonals, and a zero on the diagonal
+        // to force pivoting
+        arma::mat A;
+        A << 0 << 2 << 1 << 0 << 0 << arma::endr
+          << 3 << 1 << 4 << 1 << 0 << arma::endr
+          << 0 << 2 << 6 << 2 << 7 << arma::endr
+          << 0 << 0 << 1 << 5 << 3 << arma::endr
+          << 0 << 0 << 0 << 4 << 2;
+
+        arma::vec r{5, 7, 8, 1, 2};
+
+        const uword m1 = 1;
+        const uword m2 = 2;
+        arma::mat band = zeros<arma::mat>(m1 + m2 + 1, A.n_rows);
+        for (uword i = 0; i < A.n_rows; i++)
+        {
+            for (uword j = 0; j < A.n_cols; j++)
+            {
+                if (A(i, j) != 0)
+                    band(m1 + j - i, i) = A(i, j);
+            }
+        }
+
+        arma::mat al;
+        arma::uvec indx;
+        utils::bandec(band, m1, m2, al, indx);
+
+        arma::vec x1 = r;
+        utils::banbks(band, m1, m2, al, indx, x1);
+
+        arma::vec x2 = arma::solve(A, r);
+
+        for (uword i = 0; i < x1.n_elem; i++)
+        {
+            CHECK(x1(i) == doctest::Approx(x2(i)));
+        }
+    }
+
+    SUBCASE("banlsq")
+    {
+        // over-determined, 6 equations and 5 unknowns
+        arma::mat A;
+        A << 1 << 2 << 1 << 0 << 0 << arma::endr
+          << 3 << 1 << 4 << 1 << 0 << arma::endr
+          << 0 << 2 << 6 << 2 << 7 << arma::endr
+          << 0 << 0 << 1 << 5 << 3 << arma::endr
+          << 0 << 0 << 0 << 4 << 2 << arma::endr
+          << 0 << 0 << 0 << 0 << 9;
+
+        arma::vec r{5, 7, 8, 1, 2, 3};
+
+        const uword m1 = 1;
+        const uword m2 = 2;
+        arma::mat band = zeros<arma::mat>(m1 + m2 + 1, A.n_rows);
+        for (uword i = 0; i < A.n_rows; i++)
+        {
+            for (uword j = 0; j < A.n_cols; j++)
+            {
+                if (A(i, j) != 0)
+                    band(m1 + j - i, i) = A(i, j);
+            }
+        }
+
+        arma::vec x1 = utils::banlsq(band, m1, m2, A.n_cols, r);
+        arma::vec x2 = arma::solve(A, r); // least squares solution
+
+        for (uword i = 0; i < x1.n_elem; i++)
+        {
+            CHECK(x1(i) == doctest::Approx(x2(i)));
+        }
+    }
+}
+
+TEST_CASE("ThreadPool")
+{
+    for (const uword threads : {1, 3, 4})
+    {
+        utils::ThreadPool pool(threads);
+        CHECK(pool.size() == threads);
+
+        // repeated calls reuse the same threads
+        for (const uword n : {0, 1, 2, 5, 100})
+        {
+            arma::uvec count = zeros<arma::uvec>(n);
+            pool.parallelFor(n, [&](const uword begin, const uword end)
+            {
+                for (uword i = begin; i < end; i++)
+                    count(i)++;
+            });
+            CHECK(arma::all(count == 1));
+        }
+
+        // exceptions are rethrown on the calling thread, and the pool can be
+        // used afterwards
+        CHECK_THROWS_AS(pool.parallelFor(100, [](const uword, const uword end)
+        {
+            if (end == 100)
+                throw std::runtime_error("last range");
+        }), std::runtime_error);
+
+        arma::uvec count = zeros<arma::uvec>(10);
+        pool.parallelFor(10, [&](const uword begin, const uword end) { count.subvec(begin, end - 1) += 1; });
+        CHECK(arma::all(count == 1));
+    }
+
+    CHECK(utils::ThreadPool(0).size() >= 1);
 }
 
 TEST_SUITE_END();
@@ -0,0 +1,182 @@
+"""Generate src/equationofstate/gerg04coefficients.hpp from the GERG-2004
+coefficient tables in res/equationofstate/gerg04/*.h5.
+
+The tables are compiled into GERG04 as constexpr data, so the resource files
+are only needed to regenerate the header (which should not be necessary unless
+the coefficients change). Run from the repository root:
+
+    python3 tools/generate_gerg04_coefficients.py
+
+Only the standard library is used. The .h5 files are read with a minimal
+parser that supports exactly what Armadillo writes (a single contiguous,
+little-endian float64 dataset), and fails loudly on anything else.
+"""
+
+import os.path
+import struct
+
+SOURCE = "res/equationofstate/gerg04"
+TARGET = "src/equationofstate/gerg04coefficients.hpp"
+
+# name, description (doxygen)
+TABLES = [
+    ("betav", r"\f$\beta_{v, ij}\f$ density interaction coefficient, from table A3.8"),
+    ("betat", r"\f$\beta_{T, ij}\f$ temperature coefficient, from table A3.8"),
+    ("gammav", r"\f$\gamma_{v, ij}\f$ density interaction coefficient, from table A3.8"),
+    ("gammat", r"\f$\gamma_{T, ij}\f$ temperature interaction coefficient, from table A3.8"),
+    ("noipol", r"\f$n_{oi, k}\f$, from Table A3.2 in TM15, used in the first sum of alpha^r_{oi}"),
+    ("doipol", r"\f$d_{oi, k}\f$, from Table A3.2 in TM15, used in the first sum of alpha^r_{oi}"),
+    ("toipol", r"\f$t_{oi, k}\f$, from Table A3.2 in TM15, used in the first sum of alpha^r_{oi}"),
+    ("noiexp", r"\f$n_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}"),
+    ("doiexp", r"\f$d_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}"),
+    ("coiexp", r"\f$c_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}"),
+    ("toiexp", r"\f$t_{oi, k}\f$, from Table A3.3 in TM15, used in the second sum of alpha^r_{oi}"),
+    ("Fij", r"\f$F_{ij}\f$ interaction coefficient"),
+    ("nijpol", r"\f$n_{ij, k}\f$, from Table A3.7 in TM15, used in the first sum of alpha^r_{ij}"),
+    ("dijpol", r"\f$d_{ij, k}\f$, from Table A3.7 in TM15, used in the first sum of alpha^r_{ij}"),
+    ("tijpol", r"\f$t_{ij, k}\f$, from Table A3.7 in TM15, used in the first sum of alpha^r_{ij}"),
+    ("nijexp", r"\f$n_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}"),
+    ("dijexp", r"\f$d_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}"),
+    ("tijexp", r"\f$t_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}"),
+    ("nuijexp", r"\f$\nu_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}"),
+    ("epijexp", r"\f$\epsilon_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}"),
+    ("beijexp", r"\f$\beta_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}"),
+    ("gaijexp", r"\f$\gamma_{ij, k}\f$, from Table A3.7 in TM15, used in the second sum of alpha^r_{ij}"),
+    ("noik", r"\f$n^o_{oi, k}\f$, from Table A3.1 in TM15, used in alpha^o_{oi}"),
+    ("voik", r"\f$v^o_{oi, k}\f$, from Table A3.1 in TM15, used in alpha^o_{oi}"),
+]
+
+
+def find_unique(candidates, what, filename):
+    if len(candidates) != 1:
+        raise RuntimeError("{}: found {} {} candidates, expected 1".format(filename, len(candidates), what))
+    return candidates[0]
+
+
+def load_h5(filename):
+    """Return (shape, values) of the Armadillo dataset in filename.
+
+    shape is in Armadillo order (n_rows, n_cols[, n_slices]), and values are
+    in Armadillo (column-major) memory order.
+    """
+    with open(filename, "rb") as f:
+        data = f.read()
+
+    if data[:8] != b"\x89HDF\r\n\x1a\n":
+        raise RuntimeError("{}: not a HDF5 file".format(filename))
+
+    # dataspace message (version 1): version, rank, flags, 5 reserved bytes, dims
+    dataspaces = []
+    for offset in range(len(data) - 32):
+        rank = data[offset + 1]
+        if data[offset] == 1 and rank in (2, 3) and data[offset + 2] in (0, 1) and data[offset + 3:offset + 8] == b"\0" * 5:
+            dims = struct.unpack("<%dQ" % rank, data[offset + 8:offset + 8 + 8*rank])
+            if all(0 < d < 1000 for d in dims):
+                dataspaces.append(dims)
+    dims = find_unique(dataspaces, "dataspace", filename)
+
+    # contiguous data layout message (version 3): version, class, address, size
+    n = 1
+    for d in dims:
+        n *= d
+    layouts = []
+    for offset in range(len(data) - 18):
+        if data[offset] == 3 and data[offset + 1] == 1:
+            address, size = struct.unpack("<QQ", data[offset + 2:offset + 18])
+            if size == 8*n and address + size <= len(data):
+                layouts.append(address)
+    address = find_unique(layouts, "data layout", filename)
+
+    values = struct.unpack("<%dd" % n, data[address:address + 8*n])
+
+    # HDF5 dims are in row-major order, which is the reverse of Armadillo's
+    return tuple(reversed(dims)), values
+
+
+def format_value(x):
+    return "0" if x == 0 else repr(x)
+
+
+def format_table(name, description, shape, values):
+    lines = ["//! " + description]
+    if len(shape) == 2:
+        rows, cols = shape
+        lines.append("inline constexpr Table2<{}, {}> {} = {{{{".format(rows, cols, name))
+        for i in range(rows):
+            row = [format_value(values[i + rows*k]) for k in range(cols)]
+            lines.append("    {" + ", ".join(row) + "},")
+    else:
+        rows, cols, slices = shape
+        lines.append("inline constexpr Table3<{}, {}, {}> {} = {{{{".format(rows, cols, slices, name))
+        for i in range(rows):
+            lines.append("    {")
+            for j in range(cols):
+                row = [format_value(values[i + rows*j + rows*cols*k]) for k in range(slices)]
+                lines.append("        {" + ", ".join(row) + "},")
+            lines.append("    },")
+    lines.append("}};")
+    return "\n".join(lines)
+
+
+HEADER = """#pragma once
+
+// Generated by tools/generate_gerg04_coefficients.py from
+// res/equationofstate/gerg04/*.h5. Do not edit by hand.
+
+#include <cstddef>
+
+/*!
+ * \\brief Coefficient tables of the GERG 2004 equation of state, used by
+ * GERG04.
+ *
+ * The tables are fixed-size arrays with compile-time sizes, so the loops over
+ * the terms (k < 24 and k < 20) in GERG04 have constant trip counts and
+ * contiguous data, and no files are read at start-up.
+ *
+ * Component indices are in the GERG04 order (CH4, N2, CO2, C2H6, C3H8, nC4H10,
+ * iC4H10, nC5H12, iC5H12, nC6H14).
+ */
+namespace gerg04
+{
+
+//! Two-dimensional table indexed as table(i, k)
+template <std::size_t Rows, std::size_t Cols>
+struct Table2
+{
+    double data[Rows][Cols]; //!< Row-major values
+
+    //! Element (i, k)
+    constexpr double operator()(const std::size_t i, const std::size_t k) const { return data[i][k]; }
+};
+
+//! Three-dimensional table indexed as table(i, j, k), contiguous in k
+template <std::size_t Rows, std::size_t Cols, std::size_t Slices>
+struct Table3
+{
+    double data[Rows][Cols][Slices]; //!< Values, contiguous in the last index
+
+    //! Element (i, j, k)
+    constexpr double operator()(const std::size_t i, const std::size_t j, const std::size_t k) const { return data[i][j][k]; }
+};
+"""
+
+FOOTER = """
+} // namespace gerg04
+"""
+
+
+def main():
+    tables = []
+    for name, description in TABLES:
+        shape, values = load_h5(os.path.join(SOURCE, name + ".h5"))
+        tables.append(format_table(name, description, shape, values))
+
+    with open(TARGET, "w") as f:
+        f.write(HEADER)
+        for table in tables:
+            f.write("\n" + table + "\n")
+        f.write(FOOTER)
+
+
+if __name__ == "__main__":
+    main()